@@ -0,0 +1,223 @@
+#include "BindlessHeap.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+//Wanted sizes, the device limits may lower them
+static const uint32_t BINDLESS_TEXTURES = 4096;
+static const uint32_t BINDLESS_BUFFERS = 1024;
+static const uint32_t BINDLESS_SAMPLERS = 64;
+
+static const VkDescriptorType bindlessTypes[BINDLESS_KIND_COUNT] = {
+	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	VK_DESCRIPTOR_TYPE_SAMPLER,
+};
+
+static const char *bindlessNames[BINDLESS_KIND_COUNT] = { "textures", "buffers", "samplers" };
+
+void createBindlessHeap(BindlessHeap *heap, VkDevice device, const DeviceCapabilities &capabilities) {
+
+	heap->device = device;
+
+	const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &limits = capabilities.descriptorIndexingProperties;
+	uint32_t capacities[BINDLESS_KIND_COUNT] = {
+		std::min({ BINDLESS_TEXTURES, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages }),
+		std::min({ BINDLESS_BUFFERS, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers }),
+		std::min({ BINDLESS_SAMPLERS, limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers }),
+	};
+	//The per stage total applies to the three arrays together, textures give way first
+	uint32_t others = capacities[BINDLESS_BUFFER] + capacities[BINDLESS_SAMPLER];
+	if (capacities[BINDLESS_TEXTURE] + others > limits.maxPerStageUpdateAfterBindResources) {
+		capacities[BINDLESS_TEXTURE] = limits.maxPerStageUpdateAfterBindResources > others ? limits.maxPerStageUpdateAfterBindResources - others : 0;
+	}
+
+	VkDescriptorSetLayoutBinding bindings[BINDLESS_KIND_COUNT] = {};
+	VkDescriptorBindingFlagsEXT bindingFlags[BINDLESS_KIND_COUNT] = {};
+	VkDescriptorPoolSize poolSizes[BINDLESS_KIND_COUNT] = {};
+
+	for (uint32_t kind = 0; kind < BINDLESS_KIND_COUNT; kind++) {
+		if (capacities[kind] == 0) {
+			throw std::runtime_error("failed to create bindless heap, no room for " + std::string(bindlessNames[kind]) + "!");
+		}
+		heap->slots[kind] = BindlessSlots();
+		heap->slots[kind].capacity = capacities[kind];
+
+		bindings[kind].binding = kind;
+		bindings[kind].descriptorType = bindlessTypes[kind];
+		bindings[kind].descriptorCount = capacities[kind];
+		bindings[kind].stageFlags = VK_SHADER_STAGE_ALL;
+
+		//Unused slots hold no descriptor, slots are written while command buffers using others are pending
+		bindingFlags[kind] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+			| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+		poolSizes[kind].type = bindlessTypes[kind];
+		poolSizes[kind].descriptorCount = capacities[kind];
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo = {};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flagsInfo.bindingCount = BINDLESS_KIND_COUNT;
+	flagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = BINDLESS_KIND_COUNT;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, vulkanAllocator(), &heap->layout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = BINDLESS_KIND_COUNT;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, vulkanAllocator(), &heap->pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = heap->pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &heap->layout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &heap->set) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate bindless descriptor set!");
+	}
+
+	std::cout << "Bindless heap: " << capacities[BINDLESS_TEXTURE] << " textures, " << capacities[BINDLESS_BUFFER]
+		<< " buffers, " << capacities[BINDLESS_SAMPLER] << " samplers" << std::endl;
+}
+
+void destroyBindlessHeap(BindlessHeap *heap) {
+
+	if (heap->device == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//Destroying the pool frees the set
+	vkDestroyDescriptorPool(heap->device, heap->pool, vulkanAllocator());
+	vkDestroyDescriptorSetLayout(heap->device, heap->layout, vulkanAllocator());
+	heap->pool = VK_NULL_HANDLE;
+	heap->layout = VK_NULL_HANDLE;
+	heap->set = VK_NULL_HANDLE;
+	heap->device = VK_NULL_HANDLE;
+}
+
+VkPushConstantRange bindlessPushConstantRange() {
+
+	VkPushConstantRange range = {};
+	range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	range.offset = 0;
+	range.size = sizeof(BindlessDrawConstants);
+	return range;
+}
+
+//Most recently freed first: its descriptor is the likeliest to still be in cache
+static uint32_t takeSlot(BindlessHeap *heap, BindlessKind kind) {
+
+	std::lock_guard<std::mutex> lock(heap->mutex);
+	BindlessSlots &slots = heap->slots[kind];
+
+	uint32_t slot = BINDLESS_INVALID_SLOT;
+	if (!slots.freeSlots.empty()) {
+		slot = slots.freeSlots.back();
+		slots.freeSlots.pop_back();
+	}
+	else if (slots.next < slots.capacity) {
+		slot = slots.next++;
+	}
+
+	if (slot != BINDLESS_INVALID_SLOT) {
+		slots.live++;
+	}
+	return slot;
+}
+
+static void writeSlot(BindlessHeap *heap, BindlessKind kind, uint32_t slot, const VkDescriptorImageInfo *image, const VkDescriptorBufferInfo *buffer) {
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = heap->set;
+	write.dstBinding = kind;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = bindlessTypes[kind];
+	write.pImageInfo = image;
+	write.pBufferInfo = buffer;
+
+	vkUpdateDescriptorSets(heap->device, 1, &write, 0, nullptr);
+}
+
+uint32_t allocateTextureSlot(BindlessHeap *heap, VkImageView view, VkImageLayout layout) {
+
+	uint32_t slot = takeSlot(heap, BINDLESS_TEXTURE);
+	if (slot != BINDLESS_INVALID_SLOT) {
+		VkDescriptorImageInfo image = {};
+		image.imageView = view;
+		image.imageLayout = layout;
+		writeSlot(heap, BINDLESS_TEXTURE, slot, &image, nullptr);
+	}
+	return slot;
+}
+
+uint32_t allocateBufferSlot(BindlessHeap *heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+
+	uint32_t slot = takeSlot(heap, BINDLESS_BUFFER);
+	if (slot != BINDLESS_INVALID_SLOT) {
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = buffer;
+		bufferInfo.offset = offset;
+		bufferInfo.range = range;
+		writeSlot(heap, BINDLESS_BUFFER, slot, nullptr, &bufferInfo);
+	}
+	return slot;
+}
+
+uint32_t allocateSamplerSlot(BindlessHeap *heap, VkSampler sampler) {
+
+	uint32_t slot = takeSlot(heap, BINDLESS_SAMPLER);
+	if (slot != BINDLESS_INVALID_SLOT) {
+		VkDescriptorImageInfo image = {};
+		image.sampler = sampler;
+		writeSlot(heap, BINDLESS_SAMPLER, slot, &image, nullptr);
+	}
+	return slot;
+}
+
+void freeBindlessSlot(BindlessHeap *heap, FrameSync *sync, BindlessKind kind, uint32_t slot) {
+
+	//Frames already submitted may index the slot, it is left as is until they completed.
+	//A stale descriptor is harmless: partially bound slots are only read when a draw names them.
+	releaseAfter(sync, sync->lastSubmitted, [heap, kind, slot]() {
+		std::lock_guard<std::mutex> lock(heap->mutex);
+		heap->slots[kind].freeSlots.push_back(slot);
+		heap->slots[kind].live--;
+	});
+}
+
+void bindBindlessHeap(const BindlessHeap &heap, VkCommandBuffer commandBuffer, VkPipelineLayout layout) {
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &heap.set, 0, nullptr);
+}
+
+void printBindlessReport(BindlessHeap *heap) {
+
+	std::lock_guard<std::mutex> lock(heap->mutex);
+	std::cout << "Bindless heap:";
+	for (uint32_t kind = 0; kind < BINDLESS_KIND_COUNT; kind++) {
+		const BindlessSlots &slots = heap->slots[kind];
+		std::cout << " " << bindlessNames[kind] << " " << slots.live << " live, " << slots.next << "/" << slots.capacity << " ever used"
+			<< (kind + 1 < BINDLESS_KIND_COUNT ? "," : "");
+	}
+	std::cout << std::endl;
+}
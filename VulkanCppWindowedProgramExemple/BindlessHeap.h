@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "DeviceCapabilities.h"
+#include "FrameSync.h"
+
+//Global descriptor heap on VK_EXT_descriptor_indexing: one partially bound, update-after-bind
+//descriptor array per resource kind, all in a single set bound once per command buffer.
+//Draws select their resources by slot index through push constants, nothing is bound per draw.
+//shaders/bindless.glsl declares the same set and push constant block for the shaders.
+enum BindlessKind {
+	BINDLESS_TEXTURE, //binding 0, sampled images
+	BINDLESS_BUFFER,  //binding 1, storage buffers
+	BINDLESS_SAMPLER, //binding 2, samplers
+	BINDLESS_KIND_COUNT
+};
+
+static const uint32_t BINDLESS_INVALID_SLOT = UINT32_MAX;
+
+//Push constants of a bindless draw, DrawIndices in bindless.glsl
+struct BindlessDrawConstants {
+	uint32_t textureIndex = 0;
+	uint32_t samplerIndex = 0;
+	uint32_t bufferIndex = 0;
+	uint32_t instanceIndex = 0; //first element of the draw in its buffer
+};
+
+//Slots of one array: never used slots are handed out from next, freed ones come back through
+//freeSlots once every frame that could still read them completed
+struct BindlessSlots {
+	uint32_t capacity = 0;
+	uint32_t next = 0;
+	std::vector<uint32_t> freeSlots;
+	uint32_t live = 0;
+};
+
+struct BindlessHeap {
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	//Allocation may come from recording workers, frees from the frame loop's releases
+	std::mutex mutex;
+	BindlessSlots slots[BINDLESS_KIND_COUNT];
+};
+
+//Capacities clamped to the device's update-after-bind limits
+void createBindlessHeap(BindlessHeap *heap, VkDevice device, const DeviceCapabilities &capabilities);
+//After the frame sync released the last deferred frees
+void destroyBindlessHeap(BindlessHeap *heap);
+
+//Push constant range to add to pipeline layouts using the heap
+VkPushConstantRange bindlessPushConstantRange();
+
+//Slot written with the resource, BINDLESS_INVALID_SLOT when the array is full.
+//The descriptor is written right away: a slot is never in use by pending work when handed out.
+uint32_t allocateTextureSlot(BindlessHeap *heap, VkImageView view, VkImageLayout layout);
+uint32_t allocateBufferSlot(BindlessHeap *heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+uint32_t allocateSamplerSlot(BindlessHeap *heap, VkSampler sampler);
+//Frame loop thread: the slot is reused once the last submitted frame completed
+void freeBindlessSlot(BindlessHeap *heap, FrameSync *sync, BindlessKind kind, uint32_t slot);
+
+//Binds the heap as set 0, once per command buffer
+void bindBindlessHeap(const BindlessHeap &heap, VkCommandBuffer commandBuffer, VkPipelineLayout layout);
+void printBindlessReport(BindlessHeap *heap);
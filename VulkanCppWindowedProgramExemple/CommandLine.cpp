@@ -0,0 +1,33 @@
+#include "CommandLine.h"
+#include <set>
+#include <stdexcept>
+
+//Every argument some parser recognized, single threaded: parsing is done before any thread starts
+static std::set<std::string> claimedArguments;
+
+bool matchOption(const std::string &arg, const std::string &name, std::string *value) {
+	if (arg.compare(0, name.size(), name) != 0 || arg.size() <= name.size() || arg[name.size()] != '=') {
+		return false;
+	}
+	*value = arg.substr(name.size() + 1);
+	claimedArguments.insert(arg);
+	return true;
+}
+
+bool matchFlag(const std::string &arg, const std::string &name) {
+	if (arg != name) {
+		return false;
+	}
+	claimedArguments.insert(arg);
+	return true;
+}
+
+void rejectUnclaimedOptions(int argc, char *argv[]) {
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.compare(0, 2, "--") == 0 && claimedArguments.count(arg) == 0) {
+			throw std::runtime_error("unknown option: " + arg + "!");
+		}
+	}
+}
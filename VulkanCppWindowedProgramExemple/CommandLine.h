@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+//Shared by the option parsers of every module. A match claims the argument, so that after every
+//parser has run, whatever is left over is a typo or a flag this build does not have
+
+//"--name=value": true and the value when arg is this option
+bool matchOption(const std::string &arg, const std::string &name, std::string *value);
+
+//"--name" alone, for the switches without a value
+bool matchFlag(const std::string &arg, const std::string &name);
+
+//Throws on the first "--" argument no parser claimed, call once every parser has seen the command line
+void rejectUnclaimedOptions(int argc, char *argv[]);
@@ -0,0 +1,323 @@
+#include "DebugMessages.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> splitList(const std::string &value) {
+
+	std::vector<std::string> items;
+	size_t start = 0;
+	while (start <= value.size()) {
+		size_t comma = value.find(',', start);
+		if (comma == std::string::npos) {
+			comma = value.size();
+		}
+		if (comma > start) {
+			items.push_back(value.substr(start, comma - start));
+		}
+		start = comma + 1;
+	}
+	return items;
+}
+
+DebugMessageOptions parseDebugMessageOptions(int argc, char *argv[]) {
+
+	DebugMessageOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--debug-severity", &value)) {
+			options.severities = 0;
+			for (const std::string &item : splitList(value)) {
+				if (item == "verbose") options.severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+				else if (item == "info") options.severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+				else if (item == "warning") options.severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+				else if (item == "error") options.severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+				else throw std::runtime_error("unknown debug message severity: " + item);
+			}
+		}
+		else if (matchOption(arg, "--debug-types", &value)) {
+			options.types = 0;
+			for (const std::string &item : splitList(value)) {
+				if (item == "general") options.types |= VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+				else if (item == "validation") options.types |= VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+				else if (item == "performance") options.types |= VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+				else throw std::runtime_error("unknown debug message type: " + item);
+			}
+		}
+		else if (matchOption(arg, "--debug-repeat", &value)) {
+			options.repeatLimit = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchOption(arg, "--debug-rate", &value)) {
+			options.rateLimit = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchFlag(arg, "--debug-sync")) {
+			options.synchronous = true;
+		}
+	}
+
+	return options;
+}
+
+static const char *severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+
+	switch (severity) {
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "verbose";
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "info";
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+	default: return "error";
+	}
+}
+
+static void appendMessage(std::string *out, const DebugMessageEntry &entry) {
+
+	out->append("validation layer [");
+	out->append(severityName(entry.severity));
+	if (entry.types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) {
+		out->append(", performance");
+	}
+	out->append("]: ");
+	out->append(entry.text);
+	if (entry.lastPrinted) {
+		out->append(" (printed ").append(std::to_string(entry.occurrence)).append(" times, further repeats are only counted)");
+	}
+	out->push_back('\n');
+}
+
+//Writes one batch per wake: a burst of messages costs one write, not one flush per line
+static void drainRing(DebugMessenger *messenger, std::string *batch, DebugMessageEntry *entry) {
+
+	batch->clear();
+	uint64_t count = 0;
+	while (messenger->ring.tryPop(entry)) {
+		appendMessage(batch, *entry);
+		count++;
+	}
+	if (count > 0) {
+		std::cerr.write(batch->data(), static_cast<std::streamsize>(batch->size()));
+		std::cerr.flush();
+		messenger->printed.fetch_add(count, std::memory_order_relaxed);
+	}
+}
+
+static void runLogger(DebugMessenger *messenger) {
+
+	std::string batch;
+	batch.reserve(64 * 1024);
+	std::unique_ptr<DebugMessageEntry> entry(new DebugMessageEntry());
+
+	//Polls: waking the logger from the callback would need a lock or a syscall on the driver's thread
+	while (!messenger->stopping.load(std::memory_order_acquire)) {
+		drainRing(messenger, &batch, entry.get());
+		std::this_thread::sleep_for(std::chrono::milliseconds(DEBUG_LOGGER_POLL_MS));
+	}
+	drainRing(messenger, &batch, entry.get());
+}
+
+void startDebugMessenger(DebugMessenger *messenger, const DebugMessageOptions &options) {
+
+	messenger->options = options;
+	setDebugMessageFilter(messenger, options.severities, options.types);
+	messenger->stopping.store(false);
+	if (!options.synchronous) {
+		messenger->logger = std::thread(runLogger, messenger);
+	}
+}
+
+void stopDebugMessenger(DebugMessenger *messenger) {
+
+	if (!messenger->logger.joinable()) {
+		return;
+	}
+	messenger->stopping.store(true, std::memory_order_release);
+	messenger->logger.join();
+}
+
+VkDebugUtilsMessageSeverityFlagsEXT debugMessageSubscription(const DebugMessenger &messenger) {
+	return messenger.options.severities | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+}
+
+void setDebugMessageFilter(DebugMessenger *messenger, VkDebugUtilsMessageSeverityFlagsEXT severities, VkDebugUtilsMessageTypeFlagsEXT types) {
+	messenger->severities.store(severities, std::memory_order_relaxed);
+	messenger->types.store(types, std::memory_order_relaxed);
+}
+
+//The layers' message ID; messages without one (loader, general) are told apart by a hash of their name or text
+static uint32_t messageKey(const VkDebugUtilsMessengerCallbackDataEXT *data) {
+
+	if (data->messageIdNumber != 0) {
+		return static_cast<uint32_t>(data->messageIdNumber);
+	}
+	const char *text = data->pMessageIdName != nullptr && data->pMessageIdName[0] != '\0' ? data->pMessageIdName : data->pMessage;
+	uint32_t hash = 2166136261u;
+	for (const char *c = text; c != nullptr && *c != '\0'; c++) {
+		hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+	}
+	return hash;
+}
+
+//Open addressing with linear probing, slots are never freed: nullptr once every slot holds another ID
+static DebugMessageCounter *findCounter(DebugMessenger *messenger, uint32_t id, const char *name) {
+
+	uint64_t key = (uint64_t(1) << 32) | id;
+	size_t start = (id * 2654435761u) & (DEBUG_MESSAGE_IDS - 1);
+
+	for (size_t probe = 0; probe < DEBUG_MESSAGE_IDS; probe++) {
+		DebugMessageCounter &counter = messenger->counters[(start + probe) & (DEBUG_MESSAGE_IDS - 1)];
+		uint64_t current = counter.key.load(std::memory_order_acquire);
+		if (current == 0) {
+			if (counter.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+				std::strncpy(counter.name, name != nullptr ? name : "", DEBUG_MESSAGE_NAME_SIZE - 1);
+				counter.name[DEBUG_MESSAGE_NAME_SIZE - 1] = '\0';
+				counter.named.store(true, std::memory_order_release);
+				return &counter;
+			}
+			//Lost the slot, current now holds the winner's key
+		}
+		if (current == key) {
+			return &counter;
+		}
+	}
+	return nullptr;
+}
+
+//One second windows, approximate at the window boundary where racing callbacks may reset the count twice
+static bool withinRate(DebugMessenger *messenger) {
+
+	if (messenger->options.rateLimit == 0) {
+		return true;
+	}
+	int64_t second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t window = messenger->rateWindow.load(std::memory_order_relaxed);
+	if (window != second && messenger->rateWindow.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+		messenger->rateCount.store(0, std::memory_order_relaxed);
+	}
+	return messenger->rateCount.fetch_add(1, std::memory_order_relaxed) < messenger->options.rateLimit;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL debugMessageCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+	VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData) {
+
+	DebugMessenger *messenger = static_cast<DebugMessenger*>(pUserData);
+	messenger->received.fetch_add(1, std::memory_order_relaxed);
+
+	bool performance = (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) != 0;
+	bool shown = (messageSeverity & messenger->severities.load(std::memory_order_relaxed)) != 0
+		&& (messageType & messenger->types.load(std::memory_order_relaxed)) != 0;
+
+	//Filtered before any other work, unless it is a performance warning to count
+	if (!shown && !performance) {
+		messenger->filtered.fetch_add(1, std::memory_order_relaxed);
+		return VK_FALSE;
+	}
+
+	DebugMessageCounter *counter = findCounter(messenger, messageKey(pCallbackData), pCallbackData->pMessageIdName);
+	if (counter == nullptr) {
+		messenger->untracked.fetch_add(1, std::memory_order_relaxed);
+	}
+	else if (performance) {
+		counter->performanceCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!shown) {
+		messenger->filtered.fetch_add(1, std::memory_order_relaxed);
+		return VK_FALSE;
+	}
+
+	uint32_t occurrence = 1;
+	if (counter != nullptr) {
+		occurrence = counter->count.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (messenger->options.repeatLimit != 0 && occurrence > messenger->options.repeatLimit) {
+			messenger->repeatsSuppressed.fetch_add(1, std::memory_order_relaxed);
+			return VK_FALSE;
+		}
+	}
+
+	if (!withinRate(messenger)) {
+		messenger->rateLimited.fetch_add(1, std::memory_order_relaxed);
+		return VK_FALSE;
+	}
+
+	DebugMessageEntry entry;
+	entry.severity = messageSeverity;
+	entry.types = messageType;
+	entry.occurrence = occurrence;
+	entry.lastPrinted = counter != nullptr && occurrence == messenger->options.repeatLimit;
+	const char *text = pCallbackData->pMessage != nullptr ? pCallbackData->pMessage : "";
+	size_t length = std::min(std::strlen(text), DEBUG_MESSAGE_TEXT_SIZE - 1);
+	std::memcpy(entry.text, text, length);
+	entry.text[length] = '\0';
+
+	if (messenger->options.synchronous) {
+		std::string line;
+		appendMessage(&line, entry);
+		std::cerr << line;
+		messenger->printed.fetch_add(1, std::memory_order_relaxed);
+		return VK_FALSE;
+	}
+
+	//Never waits for the logger: a full ring drops the message
+	if (!messenger->ring.tryPush(entry)) {
+		messenger->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return VK_FALSE;
+}
+
+void printDebugMessageReport(const DebugMessenger &messenger, uint64_t framesPresented) {
+
+	uint64_t received = messenger.received.load();
+	if (received == 0) {
+		return;
+	}
+
+	std::cout << "Validation messages: " << received << " received, " << messenger.printed.load() << " printed, "
+		<< messenger.filtered.load() << " filtered, " << messenger.repeatsSuppressed.load() << " repeats suppressed, "
+		<< messenger.rateLimited.load() << " rate limited, " << messenger.dropped.load() << " dropped (ring full)";
+	if (messenger.untracked.load() > 0) {
+		std::cout << ", " << messenger.untracked.load() << " beyond the " << DEBUG_MESSAGE_IDS << " tracked IDs";
+	}
+	std::cout << std::endl;
+
+	std::vector<const DebugMessageCounter*> performance;
+	uint64_t performanceTotal = 0;
+	for (const DebugMessageCounter &counter : messenger.counters) {
+		uint32_t count = counter.performanceCount.load();
+		if (count > 0) {
+			performance.push_back(&counter);
+			performanceTotal += count;
+		}
+	}
+	if (performance.empty()) {
+		return;
+	}
+
+	std::sort(performance.begin(), performance.end(), [](const DebugMessageCounter *a, const DebugMessageCounter *b) {
+		return a->performanceCount.load() > b->performanceCount.load();
+	});
+
+	double frames = static_cast<double>(std::max<uint64_t>(framesPresented, 1));
+	std::cout << "Performance warnings: " << performanceTotal << " (" << performanceTotal / frames << " per frame), "
+		<< performance.size() << " message IDs" << std::endl;
+	const size_t listed = 10;
+	for (size_t i = 0; i < performance.size() && i < listed; i++) {
+		const DebugMessageCounter &counter = *performance[i];
+		uint32_t count = counter.performanceCount.load();
+		std::cout << "  ";
+		if (counter.named.load(std::memory_order_acquire) && counter.name[0] != '\0') {
+			std::cout << counter.name << " ";
+		}
+		std::cout << "0x" << std::hex << static_cast<uint32_t>(counter.key.load()) << std::dec;
+		std::cout << ": " << count << " (" << count / frames << " per frame)" << std::endl;
+	}
+	if (performance.size() > listed) {
+		std::cout << "  ... " << performance.size() - listed << " more" << std::endl;
+	}
+}
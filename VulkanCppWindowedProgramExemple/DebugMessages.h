@@ -0,0 +1,97 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "MpscQueue.h"
+
+//Validation layer messages, set from the command line (debug builds, where the layers are enabled):
+//  --debug-severity=LIST  severities printed, comma separated: verbose, info, warning, error.
+//                         warning,error by default
+//  --debug-types=LIST     types printed: general, validation, performance. general,validation by default;
+//                         performance warnings are counted per message ID either way and reported at exit
+//  --debug-repeat=N       each message ID is printed N times, later repeats are only counted; 3 by default, 0 for no limit
+//  --debug-rate=N         at most N messages printed per second, 50 by default, 0 for no limit
+//  --debug-sync           print from the callback on the calling thread, nothing is lost when the process crashes
+struct DebugMessageOptions {
+	VkDebugUtilsMessageSeverityFlagsEXT severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	VkDebugUtilsMessageTypeFlagsEXT types = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+	uint32_t repeatLimit = 3;
+	uint32_t rateLimit = 50;
+	bool synchronous = false;
+};
+
+DebugMessageOptions parseDebugMessageOptions(int argc, char *argv[]);
+
+const size_t DEBUG_MESSAGE_TEXT_SIZE = 2048;
+const size_t DEBUG_MESSAGE_NAME_SIZE = 64;
+const size_t DEBUG_MESSAGE_RING_SIZE = 128;
+const size_t DEBUG_MESSAGE_IDS = 1024;
+//Between two polls the ring only overflows beyond 12800 printed messages per second
+const uint32_t DEBUG_LOGGER_POLL_MS = 10;
+
+//A message copied out of the callback, truncated to the fixed sizes
+struct DebugMessageEntry {
+	VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+	VkDebugUtilsMessageTypeFlagsEXT types;
+	uint32_t occurrence; //1 for the first message with this ID
+	bool lastPrinted; //repeats of this ID are only counted from now on
+	char text[DEBUG_MESSAGE_TEXT_SIZE];
+};
+
+//One message ID: claimed with a CAS on the key, counted with atomic adds
+struct DebugMessageCounter {
+	std::atomic<uint64_t> key{ 0 }; //0 free, otherwise the ID with bit 32 set
+	std::atomic<uint32_t> count{ 0 }; //messages that passed the filters
+	std::atomic<uint32_t> performanceCount{ 0 };
+	std::atomic<bool> named{ false }; //name written by the claiming thread
+	char name[DEBUG_MESSAGE_NAME_SIZE];
+};
+
+//The layers call back on whichever thread made the Vulkan call: the render thread, workers compiling
+//pipelines, the main thread. Unless --debug-sync, the callback never locks, allocates nor writes: it filters on two atomics,
+//counts by ID in a fixed table, rate limits, and copies the text into a lock-free ring. A logger thread
+//polls the ring and writes whole batches to std::cerr. A full ring drops the message and counts it.
+struct DebugMessenger {
+	DebugMessageOptions options;
+
+	//Filters, changed at any time with setDebugMessageFilter
+	std::atomic<VkDebugUtilsMessageSeverityFlagsEXT> severities{ 0 };
+	std::atomic<VkDebugUtilsMessageTypeFlagsEXT> types{ 0 };
+
+	std::array<DebugMessageCounter, DEBUG_MESSAGE_IDS> counters;
+
+	std::atomic<uint64_t> received{ 0 };
+	std::atomic<uint64_t> filtered{ 0 };
+	std::atomic<uint64_t> repeatsSuppressed{ 0 };
+	std::atomic<uint64_t> rateLimited{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+	std::atomic<uint64_t> untracked{ 0 }; //IDs beyond the table, never deduplicated
+	std::atomic<uint64_t> printed{ 0 };
+
+	//Messages printed in the current one second window
+	std::atomic<int64_t> rateWindow{ 0 };
+	std::atomic<uint32_t> rateCount{ 0 };
+
+	MpscQueue<DebugMessageEntry, DEBUG_MESSAGE_RING_SIZE> ring;
+	std::atomic<bool> stopping{ false };
+	std::thread logger;
+};
+
+//Starts the logger thread, before the instance is created so its creation messages are handled too
+void startDebugMessenger(DebugMessenger *messenger, const DebugMessageOptions &options);
+//After the instance was destroyed: prints what is left in the ring and joins the logger
+void stopDebugMessenger(DebugMessenger *messenger);
+
+//Severities to subscribe to: the printed ones plus warnings and errors, which are always counted.
+//Runtime filter changes take effect within these.
+VkDebugUtilsMessageSeverityFlagsEXT debugMessageSubscription(const DebugMessenger &messenger);
+void setDebugMessageFilter(DebugMessenger *messenger, VkDebugUtilsMessageSeverityFlagsEXT severities, VkDebugUtilsMessageTypeFlagsEXT types);
+
+//pfnUserCallback, pUserData is the DebugMessenger
+VKAPI_ATTR VkBool32 VKAPI_CALL debugMessageCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+	VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData);
+
+//Message counts and the performance warnings by ID, per presented frame
+void printDebugMessageReport(const DebugMessenger &messenger, uint64_t framesPresented);
@@ -0,0 +1,124 @@
+#include "DeviceCapabilities.h"
+#include <cstring>
+
+bool DeviceCapabilities::hasExtension(const char *name) const {
+
+	for (const auto &extension : extensions) {
+		if (strcmp(extension.extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void probeDeviceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, DeviceCapabilities *capabilities) {
+
+	capabilities->physicalDevice = physicalDevice;
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	capabilities->extensions.resize(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, capabilities->extensions.data());
+
+	bool descriptorIndexing = capabilities->hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+	VkPhysicalDeviceIDProperties idProperties = {};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT &indexingProperties = capabilities->descriptorIndexingProperties;
+	indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties2 = {};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &idProperties;
+	if (descriptorIndexing) {
+		idProperties.pNext = &indexingProperties;
+	}
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+	idProperties.pNext = nullptr;
+	indexingProperties.pNext = nullptr;
+
+	capabilities->properties = properties2.properties;
+	memcpy(capabilities->deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &capabilities->memoryProperties);
+
+	//Optional features are chained only when their extension is present
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+	VkPhysicalDeviceFeatures2 features2 = {};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	if (capabilities->hasExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+		timelineFeatures.pNext = features2.pNext;
+		features2.pNext = &timelineFeatures;
+	}
+	//The instance is 1.1: the extension's 1.2 dependencies must be enabled with it
+	bool dynamicRenderingExtensions = capabilities->hasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)
+		&& capabilities->hasExtension(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME)
+		&& capabilities->hasExtension(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+	if (dynamicRenderingExtensions) {
+		dynamicRenderingFeatures.pNext = features2.pNext;
+		features2.pNext = &dynamicRenderingFeatures;
+	}
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (descriptorIndexing) {
+		indexingFeatures.pNext = features2.pNext;
+		features2.pNext = &indexingFeatures;
+	}
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+	capabilities->features = features2.features;
+	//Sampled images and storage buffers indexed from push constants, updated while the set is bound
+	capabilities->bindless = indexingFeatures.shaderSampledImageArrayNonUniformIndexing
+		&& indexingFeatures.shaderStorageBufferArrayNonUniformIndexing
+		&& indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+		&& indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind
+		&& indexingFeatures.descriptorBindingUpdateUnusedWhilePending
+		&& indexingFeatures.descriptorBindingPartiallyBound
+		&& indexingFeatures.runtimeDescriptorArray;
+	capabilities->timelineSemaphore = timelineFeatures.timelineSemaphore == VK_TRUE;
+	capabilities->dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+	capabilities->incrementalPresent = capabilities->hasExtension(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+
+	capabilities->queueFamilies = findQueueFamilies(physicalDevice, surface);
+
+	//Offscreen the renderer makes its own images, there is no surface to ask
+	if (surface == VK_NULL_HANDLE) {
+		capabilities->swapChainAdequate = true;
+		return;
+	}
+	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice, surface);
+	capabilities->swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentsModes.empty();
+}
+
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	SwapChainSupportDetails details;
+
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+	uint32_t formatCount;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+
+	if (formatCount != 0) {
+		details.formats.resize(formatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+
+	}
+
+	uint32_t presentModeCount;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+	if (presentModeCount != 0) {
+		details.presentsModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentsModes.data());
+	}
+
+	return  details;
+}
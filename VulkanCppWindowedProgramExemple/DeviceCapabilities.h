@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "QueueFamilies.h"
+
+struct SwapChainSupportDetails {
+	VkSurfaceCapabilitiesKHR capabilities;
+	std::vector<VkSurfaceFormatKHR> formats;
+	std::vector<VkPresentModeKHR>presentsModes;
+};
+
+//Everything init needs to know about a physical device, gathered once and never changing.
+//Surface capabilities, formats and present modes are cached per window by the renderer.
+struct DeviceCapabilities {
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceFeatures features;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	uint8_t deviceUUID[VK_UUID_SIZE];
+	std::vector<VkExtensionProperties> extensions;
+	QueueFamilyIndices queueFamilies;
+	bool timelineSemaphore = false;
+	bool dynamicRendering = false; //VK_KHR_dynamic_rendering and the extensions it depends on
+	bool bindless = false; //VK_EXT_descriptor_indexing with the features BindlessHeap needs
+	bool incrementalPresent = false; //VK_KHR_incremental_present, no feature to query
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties = {};
+
+	bool swapChainAdequate = false; //the probed surface has at least one format and present mode, always true offscreen
+
+	bool hasExtension(const char *name) const;
+};
+
+//surface is VK_NULL_HANDLE offscreen
+void probeDeviceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, DeviceCapabilities *capabilities);
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
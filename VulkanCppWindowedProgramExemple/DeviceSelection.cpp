@@ -0,0 +1,192 @@
+#include "DeviceSelection.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static bool parseUuid(const std::string &value, uint8_t uuid[VK_UUID_SIZE]) {
+
+	std::string digits;
+	for (char c : value) {
+		if (c == '-') {
+			continue;
+		}
+		if (!std::isxdigit(static_cast<unsigned char>(c))) {
+			return false;
+		}
+		digits.push_back(c);
+	}
+	if (digits.size() != 2 * VK_UUID_SIZE) {
+		return false;
+	}
+
+	for (size_t i = 0; i < VK_UUID_SIZE; i++) {
+		uuid[i] = static_cast<uint8_t>(std::stoul(digits.substr(2 * i, 2), nullptr, 16));
+	}
+	return true;
+}
+
+static std::string toLower(std::string value) {
+	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return value;
+}
+
+DeviceOverride parseDeviceOverride(int argc, char *argv[]) {
+
+	std::string value;
+
+	const char *environment = std::getenv("VK_DEVICE");
+	if (environment != nullptr) {
+		value = environment;
+	}
+
+	//Command line wins over the environment
+	for (int i = 1; i < argc; i++) {
+		matchOption(argv[i], "--device", &value);
+	}
+
+	DeviceOverride deviceOverride;
+	if (value.empty()) {
+		return deviceOverride;
+	}
+
+	if (std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+		deviceOverride.kind = DeviceOverride::INDEX;
+		deviceOverride.index = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (parseUuid(value, deviceOverride.uuid)) {
+		deviceOverride.kind = DeviceOverride::UUID;
+	}
+	else {
+		deviceOverride.kind = DeviceOverride::NAME;
+		deviceOverride.name = toLower(value);
+	}
+
+	return deviceOverride;
+}
+
+DeviceScore scoreDevice(const DeviceCapabilities &capabilities, uint32_t index, bool suitable) {
+
+	DeviceScore score;
+	score.device = capabilities.physicalDevice;
+	score.index = index;
+	score.suitable = suitable;
+
+	const VkPhysicalDeviceProperties &properties = capabilities.properties;
+	score.name = properties.deviceName;
+	memcpy(score.uuid, capabilities.deviceUUID, VK_UUID_SIZE);
+
+	auto add = [&score](int64_t points, const std::string &reason) {
+		score.score += points;
+		std::stringstream text;
+		text << reason << " " << (points >= 0 ? "+" : "") << points;
+		score.reasons.push_back(text.str());
+	};
+
+	//Device type dominates: a discrete GPU beats an integrated one whatever its memory
+	switch (properties.deviceType) {
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		add(100000, "discrete GPU");
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		add(50000, "integrated GPU");
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		add(20000, "virtual GPU");
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		add(0, "software rasterizer");
+		break;
+	default:
+		add(10000, "other device type");
+		break;
+	}
+
+	//Device local memory, 1 point per 16 MiB
+	const VkPhysicalDeviceMemoryProperties &memoryProperties = capabilities.memoryProperties;
+
+	VkDeviceSize deviceLocal = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			deviceLocal += memoryProperties.memoryHeaps[i].size;
+		}
+	}
+	add(static_cast<int64_t>(deviceLocal / (16 * 1024 * 1024)), std::to_string(deviceLocal / (1024 * 1024)) + " MiB VRAM");
+
+	//Queue families: graphics+present on one family, async compute and dedicated transfer
+	const QueueFamilyIndices &queueFamilies = capabilities.queueFamilies;
+
+	bool graphicsPresent = queueFamilies.isComplete() && !queueFamilies.separatePresent();
+	bool asyncCompute = queueFamilies.computeFamily.has_value() && queueFamilies.computeFamily != queueFamilies.graphicsFamily;
+	bool dedicatedTransfer = queueFamilies.transferFamily.has_value() && !queueFamilies.families[queueFamilies.transferFamily.value()].compute;
+	bool timestamps = queueFamilies.graphicsFamily.has_value() && queueFamilies.families[queueFamilies.graphicsFamily.value()].timestampValidBits > 0;
+	if (graphicsPresent) {
+		add(500, "graphics+present family");
+	}
+	if (asyncCompute) {
+		add(300, "async compute family");
+	}
+	if (dedicatedTransfer) {
+		add(300, "dedicated transfer family");
+	}
+	if (timestamps) {
+		add(100, "graphics timestamps");
+	}
+
+	//Features and limits
+	if (capabilities.features.samplerAnisotropy) {
+		add(50, "samplerAnisotropy");
+	}
+	if (capabilities.timelineSemaphore) {
+		add(200, "timeline semaphore");
+	}
+	add(properties.limits.maxImageDimension2D / 1024, "maxImageDimension2D " + std::to_string(properties.limits.maxImageDimension2D));
+
+	if (!suitable) {
+		score.reasons.push_back("not suitable (queues, swap chain extension or surface formats)");
+	}
+
+	return score;
+}
+
+bool matchesOverride(const DeviceScore &score, const DeviceOverride &deviceOverride) {
+
+	switch (deviceOverride.kind) {
+	case DeviceOverride::INDEX:
+		return score.index == deviceOverride.index;
+	case DeviceOverride::UUID:
+		return memcmp(score.uuid, deviceOverride.uuid, VK_UUID_SIZE) == 0;
+	case DeviceOverride::NAME:
+		return toLower(score.name).find(deviceOverride.name) != std::string::npos;
+	default:
+		return false;
+	}
+}
+
+std::string formatUuid(const uint8_t uuid[VK_UUID_SIZE]) {
+
+	static const char hex[] = "0123456789abcdef";
+
+	std::string text;
+	for (size_t i = 0; i < VK_UUID_SIZE; i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			text.push_back('-');
+		}
+		text.push_back(hex[uuid[i] >> 4]);
+		text.push_back(hex[uuid[i] & 0xf]);
+	}
+	return text;
+}
+
+std::string formatDeviceScore(const DeviceScore &score) {
+
+	std::stringstream text;
+	text << "GPU " << score.index << ": " << score.name << " (" << formatUuid(score.uuid) << ") score " << score.score << " [";
+	for (size_t i = 0; i < score.reasons.size(); i++) {
+		text << (i > 0 ? ", " : "") << score.reasons[i];
+	}
+	text << "]";
+	return text.str();
+}
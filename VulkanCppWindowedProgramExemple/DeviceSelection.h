@@ -0,0 +1,34 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DeviceCapabilities.h"
+
+//Physical device override, from --device=<value> or the VK_DEVICE environment variable.
+//The value is a device index, a device UUID (32 hex digits, dashes allowed) or part of the device name.
+struct DeviceOverride {
+	enum Kind { NONE, INDEX, UUID, NAME };
+
+	Kind kind = NONE;
+	uint32_t index = 0;
+	uint8_t uuid[VK_UUID_SIZE] = {};
+	std::string name;
+};
+
+//Ranking of one physical device, the highest suitable score is picked
+struct DeviceScore {
+	VkPhysicalDevice device = VK_NULL_HANDLE;
+	uint32_t index = 0;
+	std::string name;
+	uint8_t uuid[VK_UUID_SIZE] = {};
+	bool suitable = false;
+	int64_t score = 0;
+	std::vector<std::string> reasons;
+};
+
+DeviceOverride parseDeviceOverride(int argc, char *argv[]);
+DeviceScore scoreDevice(const DeviceCapabilities &capabilities, uint32_t index, bool suitable);
+bool matchesOverride(const DeviceScore &score, const DeviceOverride &deviceOverride);
+std::string formatDeviceScore(const DeviceScore &score);
+std::string formatUuid(const uint8_t uuid[VK_UUID_SIZE]);
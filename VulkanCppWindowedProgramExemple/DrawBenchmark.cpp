@@ -0,0 +1,180 @@
+#include "DrawBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static double elapsedMs(BenchmarkClock::time_point start) {
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+//Scene shape: a few pipelines, many materials sharing them, meshes drawn at random depths
+static const uint32_t BENCH_PIPELINES = 16;
+static const uint32_t BENCH_MATERIALS = 1024;
+static const uint32_t BENCH_VERTEX_BUFFERS = 64;
+
+static uint64_t nextRandom(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+}
+
+//Recorded commands go nowhere, only the calls are counted so the compiler keeps them
+static uint64_t benchCommands = 0;
+
+static void VKAPI_CALL countBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline) {
+	benchCommands++;
+}
+static void VKAPI_CALL countBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t, const VkDescriptorSet*, uint32_t, const uint32_t*) {
+	benchCommands++;
+}
+static void VKAPI_CALL countBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, const VkBuffer*, const VkDeviceSize*) {
+	benchCommands++;
+}
+static void VKAPI_CALL countBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType) {
+	benchCommands++;
+}
+static void VKAPI_CALL countPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, const void*) {
+	benchCommands++;
+}
+static void VKAPI_CALL countDraw(VkCommandBuffer, uint32_t, uint32_t, uint32_t, uint32_t) {
+	benchCommands++;
+}
+static void VKAPI_CALL countDrawIndexed(VkCommandBuffer, uint32_t, uint32_t, uint32_t, int32_t, uint32_t) {
+	benchCommands++;
+}
+
+//Fake but distinct handles: recording only compares them
+template <typename Handle>
+static Handle fakeHandle(uint64_t value) {
+	return (Handle)static_cast<uintptr_t>(value + 1);
+}
+
+static void fillQueue(DrawQueue *queue, uint32_t packetCount, uint64_t seed) {
+
+	clearDrawQueue(queue);
+	uint64_t state = seed;
+
+	for (uint32_t i = 0; i < packetCount; i++) {
+		uint32_t material = static_cast<uint32_t>(nextRandom(&state) % BENCH_MATERIALS);
+		uint32_t depth = static_cast<uint32_t>(nextRandom(&state) & 0xFFFFFF);
+
+		//Each material has one pipeline, descriptor set and vertex buffer
+		DrawPacket packet;
+		packet.pipelineIndex = material % BENCH_PIPELINES;
+		packet.descriptorSet = fakeHandle<VkDescriptorSet>(material);
+		packet.vertexBuffer = fakeHandle<VkBuffer>(material % BENCH_VERTEX_BUFFERS);
+		packet.constants.textureIndex = material;
+		packet.vertexCount = 36;
+
+		pushDraw(queue, packet, 0, material, depth);
+	}
+}
+
+struct DrawBenchmarkResult {
+	double fillMs;
+	double radixMs;
+	double stdSortMs;
+	double recordSortedMs;
+	double recordUnsortedMs;
+	DrawBindStats sortedStats;
+	DrawBindStats unsortedStats;
+};
+
+static DrawBenchmarkResult benchmarkPackets(uint32_t packetCount) {
+
+	//Best of a few runs, the first ones also fault the pages in
+	const uint32_t runs = 5;
+
+	DrawRecorder recorder;
+	recorder.bindPipeline = countBindPipeline;
+	recorder.bindDescriptorSets = countBindDescriptorSets;
+	recorder.bindVertexBuffers = countBindVertexBuffers;
+	recorder.bindIndexBuffer = countBindIndexBuffer;
+	recorder.pushConstants = countPushConstants;
+	recorder.draw = countDraw;
+	recorder.drawIndexed = countDrawIndexed;
+
+	VkPipeline pipelines[BENCH_PIPELINES];
+	for (uint32_t i = 0; i < BENCH_PIPELINES; i++) {
+		pipelines[i] = fakeHandle<VkPipeline>(i);
+	}
+
+	DrawRecordTarget target;
+	target.pipelines = pipelines;
+	target.descriptorSetIndex = 1;
+	target.constantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+	DrawQueue queue;
+	DrawBenchmarkResult result = {};
+	result.fillMs = result.radixMs = result.stdSortMs = result.recordSortedMs = result.recordUnsortedMs = 1.0e30;
+
+	for (uint32_t run = 0; run < runs; run++) {
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		fillQueue(&queue, packetCount, 0x9E3779B97F4A7C15ull + run);
+		result.fillMs = std::min(result.fillMs, elapsedMs(start));
+
+		//Submission order, what recording without the sort would see
+		start = BenchmarkClock::now();
+		recordDrawQueue(recorder, queue, commandBuffer, target, &result.unsortedStats);
+		result.recordUnsortedMs = std::min(result.recordUnsortedMs, elapsedMs(start));
+
+		std::vector<DrawSortEntry> reference = queue.order;
+		start = BenchmarkClock::now();
+		std::sort(reference.begin(), reference.end(), [](const DrawSortEntry &a, const DrawSortEntry &b) { return a.key < b.key; });
+		result.stdSortMs = std::min(result.stdSortMs, elapsedMs(start));
+
+		start = BenchmarkClock::now();
+		sortDrawQueue(&queue);
+		result.radixMs = std::min(result.radixMs, elapsedMs(start));
+
+		for (size_t i = 0; i < reference.size(); i++) {
+			if (reference[i].key != queue.order[i].key) {
+				throw std::runtime_error("radix sort disagrees with std::sort!");
+			}
+		}
+
+		start = BenchmarkClock::now();
+		recordDrawQueue(recorder, queue, commandBuffer, target, &result.sortedStats);
+		result.recordSortedMs = std::min(result.recordSortedMs, elapsedMs(start));
+	}
+
+	return result;
+}
+
+static uint64_t bindsIssued(const DrawBindStats &stats) {
+	return stats.pipelineBinds + stats.descriptorBinds + stats.vertexBinds + stats.indexBinds + stats.constantPushes;
+}
+
+void runDrawQueueBenchmarks() {
+
+	const uint32_t packetCounts[] = { 10000, 100000, 1000000 };
+
+	std::cout << "Draw queue benchmark, " << BENCH_PIPELINES << " pipelines, " << BENCH_MATERIALS << " materials, "
+		<< BENCH_VERTEX_BUFFERS << " vertex buffers, random depth; best of 5 runs" << std::endl;
+	std::cout << std::setw(9) << "packets" << std::setw(10) << "fill ms" << std::setw(10) << "radix ms" << std::setw(13) << "std::sort ms"
+		<< std::setw(13) << "record ms" << std::setw(15) << "ns/packet" << std::setw(14) << "binds sorted" << std::setw(16) << "binds unsorted"
+		<< std::setw(18) << "unsorted rec. ms" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(2);
+	for (uint32_t packetCount : packetCounts) {
+		DrawBenchmarkResult result = benchmarkPackets(packetCount);
+
+		double perPacketNs = (result.radixMs + result.recordSortedMs) * 1.0e6 / packetCount;
+		std::cout << std::setw(9) << packetCount << std::setw(10) << result.fillMs << std::setw(10) << result.radixMs
+			<< std::setw(13) << result.stdSortMs << std::setw(13) << result.recordSortedMs << std::setw(15) << perPacketNs
+			<< std::setw(14) << bindsIssued(result.sortedStats) << std::setw(16) << bindsIssued(result.unsortedStats)
+			<< std::setw(18) << result.recordUnsortedMs << std::endl;
+	}
+	std::cout << std::defaultfloat;
+	std::cout << "(" << benchCommands << " commands counted)" << std::endl;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "DrawQueue.h"
+
+//Benchmarks of the draw queue at 10k, 100k and 1M packets, without a device: queue fill, radix sort
+//against std::sort, and recording through commands that only count, from sorted and submission order
+void runDrawQueueBenchmarks();
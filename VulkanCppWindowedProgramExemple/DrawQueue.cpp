@@ -0,0 +1,242 @@
+#include "DrawQueue.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+DrawQueueOptions parseDrawQueueOptions(int argc, char *argv[]) {
+
+	DrawQueueOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (matchFlag(arg, "--bench-draws")) {
+			options.benchmark = true;
+		}
+	}
+
+	return options;
+}
+
+static uint64_t clampField(uint32_t value, uint32_t bits) {
+	uint64_t maxValue = (uint64_t(1) << bits) - 1;
+	return std::min<uint64_t>(value, maxValue);
+}
+
+uint64_t makeDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth) {
+
+	uint64_t key = clampField(pass, DRAW_KEY_PASS_BITS);
+	key = (key << DRAW_KEY_PIPELINE_BITS) | clampField(pipeline, DRAW_KEY_PIPELINE_BITS);
+	key = (key << DRAW_KEY_MATERIAL_BITS) | clampField(material, DRAW_KEY_MATERIAL_BITS);
+	key = (key << DRAW_KEY_DEPTH_BITS) | clampField(depth, DRAW_KEY_DEPTH_BITS);
+	return key;
+}
+
+void clearDrawQueue(DrawQueue *queue) {
+
+	queue->packets.clear();
+	queue->order.clear();
+}
+
+void pushDraw(DrawQueue *queue, const DrawPacket &packet, uint32_t pass, uint32_t material, uint32_t depth) {
+
+	DrawSortEntry entry;
+	entry.key = makeDrawKey(pass, packet.pipelineIndex, material, depth);
+	entry.packet = static_cast<uint32_t>(queue->packets.size());
+
+	queue->packets.push_back(packet);
+	queue->order.push_back(entry);
+}
+
+void sortDrawQueue(DrawQueue *queue) {
+
+	const uint32_t DIGITS = 8;
+	size_t count = queue->order.size();
+	if (count < 2) {
+		return;
+	}
+	queue->scratch.resize(count);
+
+	//Every digit's histogram in one read of the keys
+	uint32_t histograms[DIGITS][256] = {};
+	for (const DrawSortEntry &entry : queue->order) {
+		for (uint32_t digit = 0; digit < DIGITS; digit++) {
+			histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	DrawSortEntry *source = queue->order.data();
+	DrawSortEntry *destination = queue->scratch.data();
+
+	for (uint32_t digit = 0; digit < DIGITS; digit++) {
+		uint32_t *histogram = histograms[digit];
+
+		//Keys built from few passes, pipelines and materials share most digits: nothing to move
+		uint32_t firstKeyBucket = (source[0].key >> (digit * 8)) & 0xFF;
+		if (histogram[firstKeyBucket] == count) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < 256; bucket++) {
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			uint32_t bucket = (source[i].key >> (digit * 8)) & 0xFF;
+			destination[histogram[bucket]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+
+	//An odd number of scatters left the result in the scratch buffer
+	if (source != queue->order.data()) {
+		queue->order.swap(queue->scratch);
+	}
+}
+
+void addBindStats(DrawBindStats *total, const DrawBindStats &stats) {
+
+	total->draws += stats.draws;
+	total->pipelineBinds += stats.pipelineBinds;
+	total->pipelineElided += stats.pipelineElided;
+	total->descriptorBinds += stats.descriptorBinds;
+	total->descriptorElided += stats.descriptorElided;
+	total->vertexBinds += stats.vertexBinds;
+	total->vertexElided += stats.vertexElided;
+	total->indexBinds += stats.indexBinds;
+	total->indexElided += stats.indexElided;
+	total->constantPushes += stats.constantPushes;
+	total->constantElided += stats.constantElided;
+}
+
+static void printBindLine(const char *name, uint64_t issued, uint64_t elided, double frames) {
+	uint64_t requested = issued + elided;
+	std::cout << "  " << name << ": " << issued / frames << " issued, " << elided / frames << " elided per frame ("
+		<< (requested > 0 ? 100.0 * elided / requested : 0.0) << "% elided)" << std::endl;
+}
+
+void printBindReport(const DrawBindStats &total, uint64_t frames) {
+
+	if (frames == 0) {
+		return;
+	}
+
+	double frameCount = static_cast<double>(frames);
+	std::cout << "Draw binds over " << frames << " frames, " << total.draws / frameCount << " draws per frame:" << std::endl;
+	printBindLine("pipeline", total.pipelineBinds, total.pipelineElided, frameCount);
+	printBindLine("descriptor set", total.descriptorBinds, total.descriptorElided, frameCount);
+	printBindLine("vertex buffer", total.vertexBinds, total.vertexElided, frameCount);
+	printBindLine("index buffer", total.indexBinds, total.indexElided, frameCount);
+	printBindLine("push constants", total.constantPushes, total.constantElided, frameCount);
+}
+
+void loadDrawRecorder(VkDevice device, DrawRecorder *recorder) {
+
+	recorder->bindPipeline = (PFN_vkCmdBindPipeline)vkGetDeviceProcAddr(device, "vkCmdBindPipeline");
+	recorder->bindDescriptorSets = (PFN_vkCmdBindDescriptorSets)vkGetDeviceProcAddr(device, "vkCmdBindDescriptorSets");
+	recorder->bindVertexBuffers = (PFN_vkCmdBindVertexBuffers)vkGetDeviceProcAddr(device, "vkCmdBindVertexBuffers");
+	recorder->bindIndexBuffer = (PFN_vkCmdBindIndexBuffer)vkGetDeviceProcAddr(device, "vkCmdBindIndexBuffer");
+	recorder->pushConstants = (PFN_vkCmdPushConstants)vkGetDeviceProcAddr(device, "vkCmdPushConstants");
+	recorder->draw = (PFN_vkCmdDraw)vkGetDeviceProcAddr(device, "vkCmdDraw");
+	recorder->drawIndexed = (PFN_vkCmdDrawIndexed)vkGetDeviceProcAddr(device, "vkCmdDrawIndexed");
+
+	if (recorder->bindPipeline == nullptr || recorder->bindDescriptorSets == nullptr || recorder->bindVertexBuffers == nullptr
+		|| recorder->bindIndexBuffer == nullptr || recorder->pushConstants == nullptr || recorder->draw == nullptr || recorder->drawIndexed == nullptr) {
+		throw std::runtime_error("failed to load draw commands!");
+	}
+}
+
+void recordDrawQueue(const DrawRecorder &recorder, const DrawQueue &queue, VkCommandBuffer commandBuffer,
+	const DrawRecordTarget &target, DrawBindStats *stats) {
+
+	DrawBindStats local;
+
+	//Nothing bound yet: the first packet's state always differs
+	bool first = true;
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkDescriptorSet boundSet = VK_NULL_HANDLE;
+	VkBuffer boundBuffer = VK_NULL_HANDLE;
+	VkDeviceSize boundOffset = 0;
+	VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize boundIndexOffset = 0;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+	const BindlessDrawConstants *pushedConstants = nullptr;
+
+	for (const DrawSortEntry &entry : queue.order) {
+		const DrawPacket &packet = queue.packets[entry.packet];
+
+		VkPipeline pipeline = target.pipelines[packet.pipelineIndex];
+		if (first || pipeline != boundPipeline) {
+			recorder.bindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			local.pipelineBinds++;
+		}
+		else {
+			local.pipelineElided++;
+		}
+
+		if (packet.descriptorSet != VK_NULL_HANDLE) {
+			if (packet.descriptorSet != boundSet) {
+				recorder.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.layout, target.descriptorSetIndex, 1, &packet.descriptorSet, 0, nullptr);
+				boundSet = packet.descriptorSet;
+				local.descriptorBinds++;
+			}
+			else {
+				local.descriptorElided++;
+			}
+		}
+
+		if (packet.vertexBuffer != VK_NULL_HANDLE) {
+			if (packet.vertexBuffer != boundBuffer || packet.vertexOffset != boundOffset) {
+				recorder.bindVertexBuffers(commandBuffer, 0, 1, &packet.vertexBuffer, &packet.vertexOffset);
+				boundBuffer = packet.vertexBuffer;
+				boundOffset = packet.vertexOffset;
+				local.vertexBinds++;
+			}
+			else {
+				local.vertexElided++;
+			}
+		}
+
+		if (packet.indexBuffer != VK_NULL_HANDLE) {
+			if (packet.indexBuffer != boundIndexBuffer || packet.indexOffset != boundIndexOffset || packet.indexType != boundIndexType) {
+				recorder.bindIndexBuffer(commandBuffer, packet.indexBuffer, packet.indexOffset, packet.indexType);
+				boundIndexBuffer = packet.indexBuffer;
+				boundIndexOffset = packet.indexOffset;
+				boundIndexType = packet.indexType;
+				local.indexBinds++;
+			}
+			else {
+				local.indexElided++;
+			}
+		}
+
+		if (target.constantStages != 0) {
+			if (pushedConstants == nullptr || std::memcmp(pushedConstants, &packet.constants, sizeof(BindlessDrawConstants)) != 0) {
+				recorder.pushConstants(commandBuffer, target.layout, target.constantStages, 0, sizeof(BindlessDrawConstants), &packet.constants);
+				pushedConstants = &packet.constants;
+				local.constantPushes++;
+			}
+			else {
+				local.constantElided++;
+			}
+		}
+
+		if (packet.indexBuffer != VK_NULL_HANDLE) {
+			recorder.drawIndexed(commandBuffer, packet.indexCount, packet.instanceCount, packet.firstIndex, packet.baseVertex, packet.firstInstance);
+		}
+		else {
+			recorder.draw(commandBuffer, packet.vertexCount, packet.instanceCount, packet.firstVertex, packet.firstInstance);
+		}
+		local.draws++;
+		first = false;
+	}
+
+	*stats = local;
+}
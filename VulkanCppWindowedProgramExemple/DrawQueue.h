@@ -0,0 +1,111 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "BindlessHeap.h"
+
+//Draw queue command line:
+//  --bench-draws       benchmark sorting and recording 10k to 1M draw packets and exit
+struct DrawQueueOptions {
+	bool benchmark = false;
+};
+
+DrawQueueOptions parseDrawQueueOptions(int argc, char *argv[]);
+
+//64-bit sort key, most significant field first: what is most expensive to change forms the longest runs.
+//  pass      4 bits   render pass / layer order
+//  pipeline 12 bits   index into the recording's pipeline table
+//  material 24 bits   descriptor set, vertex buffer and push constants of the draw
+//  depth    24 bits   front to back inside a material, larger values drawn later
+const uint32_t DRAW_KEY_PASS_BITS = 4;
+const uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+const uint32_t DRAW_KEY_MATERIAL_BITS = 24;
+const uint32_t DRAW_KEY_DEPTH_BITS = 24;
+
+//Fields wider than their bits are clamped, not wrapped
+uint64_t makeDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth);
+
+//One draw and everything its recording binds. Bind state is compared by handle: equal handles are
+//the same binding, so consecutive packets sharing them record a single bind.
+struct DrawPacket {
+	uint32_t pipelineIndex = 0;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE; //bound after the bindless heap, VK_NULL_HANDLE for none
+	VkBuffer vertexBuffer = VK_NULL_HANDLE; //binding 0, VK_NULL_HANDLE for vertex-less draws
+	VkDeviceSize vertexOffset = 0;
+	VkBuffer indexBuffer = VK_NULL_HANDLE; //indexed draw of indexCount indices when set, vertexCount otherwise
+	VkDeviceSize indexOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+	BindlessDrawConstants constants;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstVertex = 0;
+	uint32_t firstIndex = 0;
+	int32_t baseVertex = 0; //added to every index
+	uint32_t firstInstance = 0;
+};
+
+struct DrawSortEntry {
+	uint64_t key;
+	uint32_t packet;
+};
+
+//Packets are appended in any order and sorted once per rebuild. Only the 16 byte key/index pairs
+//move during the sort, the packets stay where they were pushed. Every vector keeps its capacity:
+//refilling a queue of the same size does not allocate.
+struct DrawQueue {
+	std::vector<DrawPacket> packets;
+	std::vector<DrawSortEntry> order; //sorted draw order once sortDrawQueue ran
+	std::vector<DrawSortEntry> scratch;
+};
+
+void clearDrawQueue(DrawQueue *queue);
+void pushDraw(DrawQueue *queue, const DrawPacket &packet, uint32_t pass, uint32_t material, uint32_t depth);
+//LSD radix sort on 8-bit digits, stable; digits equal in every key are skipped
+void sortDrawQueue(DrawQueue *queue);
+
+//Binds recorded and binds skipped because the previous packet already had them bound
+struct DrawBindStats {
+	uint64_t draws = 0;
+	uint64_t pipelineBinds = 0;
+	uint64_t pipelineElided = 0;
+	uint64_t descriptorBinds = 0;
+	uint64_t descriptorElided = 0;
+	uint64_t vertexBinds = 0;
+	uint64_t vertexElided = 0;
+	uint64_t indexBinds = 0;
+	uint64_t indexElided = 0;
+	uint64_t constantPushes = 0;
+	uint64_t constantElided = 0;
+};
+
+void addBindStats(DrawBindStats *total, const DrawBindStats &stats);
+//Per frame averages over the submitted command buffers
+void printBindReport(const DrawBindStats &total, uint64_t frames);
+
+//Command entry points fetched from the device: recording calls them directly instead of through the
+//loader's dispatch. The benchmark swaps in functions that only count.
+struct DrawRecorder {
+	PFN_vkCmdBindPipeline bindPipeline = nullptr;
+	PFN_vkCmdBindDescriptorSets bindDescriptorSets = nullptr;
+	PFN_vkCmdBindVertexBuffers bindVertexBuffers = nullptr;
+	PFN_vkCmdBindIndexBuffer bindIndexBuffer = nullptr;
+	PFN_vkCmdPushConstants pushConstants = nullptr;
+	PFN_vkCmdDraw draw = nullptr;
+	PFN_vkCmdDrawIndexed drawIndexed = nullptr;
+};
+
+void loadDrawRecorder(VkDevice device, DrawRecorder *recorder);
+
+//What the packets of one command buffer resolve against
+struct DrawRecordTarget {
+	const VkPipeline *pipelines = nullptr; //indexed by DrawPacket::pipelineIndex
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	uint32_t descriptorSetIndex = 0; //set the packets' descriptor sets are bound to
+	VkShaderStageFlags constantStages = 0; //0 when the layout has no push constants
+};
+
+//Records the sorted packets inside a begun render pass or rendering scope, with viewport and scissor set.
+//Bind state starts unknown, so the first packet binds everything it uses.
+void recordDrawQueue(const DrawRecorder &recorder, const DrawQueue &queue, VkCommandBuffer commandBuffer,
+	const DrawRecordTarget &target, DrawBindStats *stats);
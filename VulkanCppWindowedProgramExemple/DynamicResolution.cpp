@@ -0,0 +1,419 @@
+#include "DynamicResolution.h"
+#include "CommandLine.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+//Frames measured after a change before the next one: the smoothed time must reflect the new scale
+static const uint32_t SETTLE_FRAMES = 16;
+//Weight of the newest frame in the smoothed GPU time
+static const double SMOOTHING = 0.1;
+//Below this share of the target the scale grows, above the target it shrinks: the gap avoids oscillating
+static const double GROW_BELOW = 0.85;
+//Scales are multiples of 1/64, so tiny corrections do not re-record the command buffers
+static const double SCALE_STEP = 1.0 / 64.0;
+
+ResolutionOptions parseResolutionOptions(int argc, char *argv[]) {
+
+	ResolutionOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchFlag(arg, "--dynamic-resolution")) {
+			options.enabled = true;
+		}
+		else if (matchOption(arg, "--gpu-frame-ms", &value)) {
+			options.targetFrameMs = std::stod(value);
+		}
+		else if (matchOption(arg, "--min-scale", &value)) {
+			options.minScale = std::stod(value);
+		}
+		else if (matchOption(arg, "--max-scale", &value)) {
+			options.maxScale = std::stod(value);
+		}
+	}
+
+	options.minScale = std::max(SCALE_STEP, std::min(options.minScale, 2.0));
+	options.maxScale = std::max(options.minScale, std::min(options.maxScale, 2.0));
+
+	return options;
+}
+
+const char *dynamicResolutionUnsupportedReason(const DeviceCapabilities &capabilities, uint32_t graphicsFamily, VkFormat format, VkImageUsageFlags supportedUsage) {
+
+	if ((supportedUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+		return "swap chain images cannot be a transfer destination";
+	}
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(capabilities.physicalDevice, format, &formatProperties);
+	const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT
+		| VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((formatProperties.optimalTilingFeatures & needed) != needed) {
+		return "swap chain format cannot be blitted with linear filtering";
+	}
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &familyCount, families.data());
+	if (graphicsFamily >= familyCount || families[graphicsFamily].timestampValidBits == 0) {
+		return "graphics queue has no timestamps";
+	}
+
+	return nullptr;
+}
+
+void createDynamicResolution(DynamicResolution *resolution, VkDevice device, const DeviceCapabilities &capabilities, uint32_t graphicsFamily, double targetFrameRate) {
+
+	resolution->device = device;
+	resolution->memoryProperties = capabilities.memoryProperties;
+	resolution->timestampPeriod = capabilities.properties.limits.timestampPeriod;
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &familyCount, families.data());
+	uint32_t validBits = families[graphicsFamily].timestampValidBits;
+	resolution->timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+	if (resolution->options.targetFrameMs <= 0.0) {
+		resolution->options.targetFrameMs = 1000.0 / targetFrameRate;
+	}
+	//Start at the top, the controller only lowers the scale once the GPU proves too slow
+	resolution->scale = resolution->options.maxScale;
+	resolution->active = true;
+
+	std::cout << "Dynamic resolution: scale " << resolution->options.minScale << " to " << resolution->options.maxScale
+		<< ", holding " << resolution->options.targetFrameMs << " ms of GPU time" << std::endl;
+}
+
+void destroyDynamicResolution(DynamicResolution *resolution) {
+
+	if (!resolution->active) {
+		return;
+	}
+
+	std::cout << "Dynamic resolution: " << resolution->measuredFrames << " frames measured";
+	if (resolution->measuredFrames > 0) {
+		std::cout << ", mean scale " << resolution->scaleSum / resolution->measuredFrames << ", final scale " << resolution->scale
+			<< ", " << resolution->scaleChanges << " changes, GPU " << resolution->smoothedMs << " ms";
+	}
+	std::cout << std::endl;
+
+	resolution->active = false;
+}
+
+static uint32_t findDeviceMemoryType(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeBits) {
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+			return i;
+		}
+	}
+	//Integrated GPUs without a device local type still render from any type the image accepts
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if (typeBits & (1u << i)) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find memory for the scene target!");
+}
+
+//The swap chain render pass, except the attachment ends in TRANSFER_SRC ready for the blit.
+//Attachments stay compatible, so the pipelines built for the swap chain pass draw in this one.
+static void createSceneRenderPass(DynamicResolution *resolution, VkFormat format) {
+
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = format;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+
+	//The previous blit of this image read the target, the blit after the pass reads what it wrote
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
+
+	if (vkCreateRenderPass(resolution->device, &renderPassInfo, vulkanAllocator(), &resolution->renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create scene render pass!");
+	}
+}
+
+static void createSceneTarget(DynamicResolution *resolution, SceneTarget *target, VkFormat format) {
+
+	VkDevice device = resolution->device;
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { resolution->targetExtent.width, resolution->targetExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, vulkanAllocator(), &target->image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create scene target!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, target->image, &requirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findDeviceMemoryType(resolution->memoryProperties, requirements.memoryTypeBits);
+
+	if (vkAllocateMemory(device, &allocInfo, vulkanAllocator(), &target->memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate scene target memory!");
+	}
+	vkBindImageMemory(device, target->image, target->memory, 0);
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = target->image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, vulkanAllocator(), &target->view) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create scene target view!");
+	}
+
+	if (resolution->renderPass == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = resolution->renderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &target->view;
+	framebufferInfo.width = resolution->targetExtent.width;
+	framebufferInfo.height = resolution->targetExtent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(device, &framebufferInfo, vulkanAllocator(), &target->framebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create scene framebuffer!");
+	}
+}
+
+void createSceneTargets(DynamicResolution *resolution, size_t imageCount, VkFormat format, VkExtent2D swapExtent, bool dynamicRendering) {
+
+	if (!resolution->active) {
+		return;
+	}
+
+	resolution->targetExtent.width = std::max(1u, static_cast<uint32_t>(std::ceil(swapExtent.width * resolution->options.maxScale)));
+	resolution->targetExtent.height = std::max(1u, static_cast<uint32_t>(std::ceil(swapExtent.height * resolution->options.maxScale)));
+
+	if (!dynamicRendering) {
+		createSceneRenderPass(resolution, format);
+	}
+
+	resolution->targets.resize(imageCount);
+	for (size_t i = 0; i < imageCount; i++) {
+		createSceneTarget(resolution, &resolution->targets[i], format);
+	}
+
+	VkQueryPoolCreateInfo queryInfo = {};
+	queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = static_cast<uint32_t>(imageCount * 2);
+
+	if (vkCreateQueryPool(resolution->device, &queryInfo, vulkanAllocator(), &resolution->queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+	resolution->timestampsPending.assign(imageCount, false);
+}
+
+void destroySceneTargets(DynamicResolution *resolution) {
+
+	if (!resolution->active) {
+		return;
+	}
+
+	VkDevice device = resolution->device;
+
+	for (SceneTarget &target : resolution->targets) {
+		if (target.framebuffer != VK_NULL_HANDLE) {
+			vkDestroyFramebuffer(device, target.framebuffer, vulkanAllocator());
+		}
+		vkDestroyImageView(device, target.view, vulkanAllocator());
+		vkDestroyImage(device, target.image, vulkanAllocator());
+		vkFreeMemory(device, target.memory, vulkanAllocator());
+	}
+	resolution->targets.clear();
+
+	if (resolution->renderPass != VK_NULL_HANDLE) {
+		vkDestroyRenderPass(device, resolution->renderPass, vulkanAllocator());
+		resolution->renderPass = VK_NULL_HANDLE;
+	}
+
+	vkDestroyQueryPool(device, resolution->queryPool, vulkanAllocator());
+	resolution->queryPool = VK_NULL_HANDLE;
+	resolution->timestampsPending.clear();
+}
+
+VkExtent2D sceneExtent(const DynamicResolution &resolution, VkExtent2D swapExtent) {
+
+	VkExtent2D extent;
+	extent.width = static_cast<uint32_t>(std::lround(swapExtent.width * resolution.scale));
+	extent.height = static_cast<uint32_t>(std::lround(swapExtent.height * resolution.scale));
+	extent.width = std::max(1u, std::min(extent.width, resolution.targetExtent.width));
+	extent.height = std::max(1u, std::min(extent.height, resolution.targetExtent.height));
+	return extent;
+}
+
+void beginSceneTimer(const DynamicResolution &resolution, VkCommandBuffer commandBuffer, size_t imageIndex) {
+
+	uint32_t firstQuery = static_cast<uint32_t>(imageIndex * 2);
+	vkCmdResetQueryPool(commandBuffer, resolution.queryPool, firstQuery, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, resolution.queryPool, firstQuery);
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void recordUpscale(const DynamicResolution &resolution, VkCommandBuffer commandBuffer, size_t imageIndex, VkImage swapChainImage,
+	VkImageLayout finalLayout, VkExtent2D renderExtent, VkExtent2D swapExtent) {
+
+	//Whatever the swap chain image held is overwritten, the acquire semaphore wait covers the presentation engine
+	imageBarrier(commandBuffer, swapChainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	VkImageBlit region = {};
+	region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.srcSubresource.layerCount = 1;
+	region.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+	region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.dstSubresource.layerCount = 1;
+	region.dstOffsets[1] = { static_cast<int32_t>(swapExtent.width), static_cast<int32_t>(swapExtent.height), 1 };
+
+	vkCmdBlitImage(commandBuffer, resolution.targets[imageIndex].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+
+	//Present, the capture copy and the ownership release all expect the final layout
+	imageBarrier(commandBuffer, swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+		VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, resolution.queryPool, static_cast<uint32_t>(imageIndex * 2 + 1));
+}
+
+static double quantizeScale(double scale) {
+	return std::round(scale / SCALE_STEP) * SCALE_STEP;
+}
+
+//GPU time follows the pixel count, the square of the scale: the square root of the time ratio
+//gives the scale that would hit the target. Drops are taken at once, growth is limited per step.
+static void updateScale(DynamicResolution *resolution, double gpuMs) {
+
+	const ResolutionOptions &options = resolution->options;
+
+	resolution->smoothedMs = resolution->smoothedMs == 0.0 ? gpuMs : resolution->smoothedMs + SMOOTHING * (gpuMs - resolution->smoothedMs);
+	resolution->measuredFrames++;
+	resolution->scaleSum += resolution->scale;
+
+	if (++resolution->framesSinceChange < SETTLE_FRAMES) {
+		return;
+	}
+
+	double wanted = resolution->scale;
+	if (resolution->smoothedMs > options.targetFrameMs) {
+		wanted = resolution->scale * std::max(0.75, std::sqrt(options.targetFrameMs / resolution->smoothedMs));
+	}
+	else if (resolution->smoothedMs < options.targetFrameMs * GROW_BELOW) {
+		wanted = resolution->scale * std::min(1.1, std::sqrt(options.targetFrameMs * GROW_BELOW / std::max(resolution->smoothedMs, 0.001)));
+	}
+
+	wanted = std::max(options.minScale, std::min(options.maxScale, quantizeScale(wanted)));
+	if (wanted != resolution->scale) {
+		resolution->scale = wanted;
+		resolution->scaleChanges++;
+		//Times measured at the old scale say little about the new one
+		resolution->smoothedMs = 0.0;
+		resolution->framesSinceChange = 0;
+	}
+}
+
+void measureSceneTime(DynamicResolution *resolution, size_t imageIndex) {
+
+	if (!resolution->active) {
+		return;
+	}
+
+	if (resolution->timestampsPending[imageIndex]) {
+		uint64_t timestamps[2];
+		//The submission completed, the results are available without waiting
+		VkResult result = vkGetQueryPoolResults(resolution->device, resolution->queryPool, static_cast<uint32_t>(imageIndex * 2), 2,
+			sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS) {
+			uint64_t ticks = (timestamps[1] - timestamps[0]) & resolution->timestampMask;
+			updateScale(resolution, ticks * resolution->timestampPeriod / 1e6);
+		}
+	}
+
+	resolution->timestampsPending[imageIndex] = true;
+}
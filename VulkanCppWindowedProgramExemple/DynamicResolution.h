@@ -0,0 +1,82 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "DeviceCapabilities.h"
+
+//Dynamic resolution, set from the command line:
+//  --dynamic-resolution   draw the scene offscreen at a scale held to the GPU frame time, then blit it to the swap chain
+//  --gpu-frame-ms=MS      GPU time per frame to hold, 1000 / --target-fps by default
+//  --min-scale=F          lowest render scale per axis, 0.5 by default
+//  --max-scale=F          highest render scale per axis, 1.0 by default, up to 2 for supersampling
+struct ResolutionOptions {
+	bool enabled = false;
+	double targetFrameMs = 0.0; //0: from the frame policy's target frame rate
+	double minScale = 0.5;
+	double maxScale = 1.0;
+};
+
+//Offscreen color target of one swap chain image, sized for the largest scale
+struct SceneTarget {
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE; //render pass path only
+};
+
+//The targets are allocated with the swap chain at the largest scale: a scale change only moves the
+//render area, so it never reallocates, waits for the GPU nor rebuilds a pipeline (viewport and scissor
+//are dynamic). Each image's command buffer brackets its work with two timestamps, read back once
+//the image is waited for, and the controller moves the scale from their smoothed difference.
+struct DynamicResolution {
+	ResolutionOptions options;
+	bool active = false;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	double timestampPeriod = 1.0; //nanoseconds per tick
+	uint64_t timestampMask = 0;
+	VkQueryPool queryPool = VK_NULL_HANDLE; //two timestamps per swap chain image
+
+	//Render pass path: same attachment as the swap chain pass, but left in TRANSFER_SRC for the blit
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	std::vector<SceneTarget> targets;
+	VkExtent2D targetExtent = {};
+	std::vector<bool> timestampsPending; //per image, submitted and not read yet
+
+	//Controller
+	double scale = 1.0;
+	double smoothedMs = 0.0;
+	uint32_t framesSinceChange = 0;
+
+	uint64_t measuredFrames = 0;
+	double scaleSum = 0.0;
+	uint32_t scaleChanges = 0;
+};
+
+ResolutionOptions parseResolutionOptions(int argc, char *argv[]);
+
+//Why the swap chain cannot be the blit destination, nullptr when it can
+const char *dynamicResolutionUnsupportedReason(const DeviceCapabilities &capabilities, uint32_t graphicsFamily, VkFormat format, VkImageUsageFlags supportedUsage);
+
+void createDynamicResolution(DynamicResolution *resolution, VkDevice device, const DeviceCapabilities &capabilities, uint32_t graphicsFamily, double targetFrameRate);
+//Prints the scale statistics
+void destroyDynamicResolution(DynamicResolution *resolution);
+
+//With the swap chain: one target per image, the scene render pass and framebuffers unless rendering is dynamic
+void createSceneTargets(DynamicResolution *resolution, size_t imageCount, VkFormat format, VkExtent2D swapExtent, bool dynamicRendering);
+void destroySceneTargets(DynamicResolution *resolution);
+
+//Render area of the scene at the current scale
+VkExtent2D sceneExtent(const DynamicResolution &resolution, VkExtent2D swapExtent);
+
+//First commands of an image's command buffer: resets its queries and writes the start timestamp
+void beginSceneTimer(const DynamicResolution &resolution, VkCommandBuffer commandBuffer, size_t imageIndex);
+//After the scene, left in TRANSFER_SRC: scales it onto the swap chain image, leaves that in finalLayout
+//(PRESENT_SRC, TRANSFER_SRC offscreen) and writes the end timestamp
+void recordUpscale(const DynamicResolution &resolution, VkCommandBuffer commandBuffer, size_t imageIndex, VkImage swapChainImage,
+	VkImageLayout finalLayout, VkExtent2D renderExtent, VkExtent2D swapExtent);
+
+//Once the image's previous submission completed: reads its timestamps and updates the scale.
+//Then marks the coming submission's timestamps as pending.
+void measureSceneTime(DynamicResolution *resolution, size_t imageIndex);
@@ -0,0 +1,609 @@
+#include "FrameCapture.h"
+#include "CommandLine.h"
+#include "HostAllocator.h"
+#include "PngFile.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+CaptureOptions parseCaptureOptions(int argc, char *argv[]) {
+
+	CaptureOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--capture", &value)) {
+			if (value == "png") {
+				options.format = CaptureOptions::PNG;
+			}
+			else if (value == "y4m") {
+				options.format = CaptureOptions::Y4M;
+			}
+			else {
+				throw std::runtime_error("unknown capture format: " + value);
+			}
+		}
+		else if (matchOption(arg, "--capture-path", &value)) {
+			options.path = value;
+		}
+		else if (matchOption(arg, "--capture-every", &value)) {
+			options.every = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+		}
+		else if (matchOption(arg, "--capture-from", &value)) {
+			options.firstFrame = std::stoull(value);
+		}
+		else if (matchOption(arg, "--capture-count", &value)) {
+			options.frameCount = std::stoull(value);
+		}
+		else if (matchOption(arg, "--capture-ring", &value)) {
+			options.ringSize = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+		}
+		else if (matchOption(arg, "--capture-fps", &value)) {
+			options.frameRate = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+		}
+	}
+
+	return options;
+}
+
+//8 bit, 4 channels: the encoders only reorder and drop bytes
+static bool captureFormat(VkFormat format, bool *swapRedBlue) {
+
+	switch (format) {
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		*swapRedBlue = true;
+		return true;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		*swapRedBlue = false;
+		return true;
+	default:
+		return false;
+	}
+}
+
+const char *captureUnsupportedReason(VkFormat format, VkImageUsageFlags supportedUsage, bool separatePresentQueue) {
+
+	bool swapRedBlue;
+	if (!captureFormat(format, &swapRedBlue)) {
+		return "swap chain format is not 8 bit RGBA or BGRA";
+	}
+	if ((supportedUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0) {
+		return "swap chain images cannot be a transfer source";
+	}
+	//The draw command buffer already released the image to the present family
+	if (separatePresentQueue) {
+		return "present queue family differs from the graphics one";
+	}
+	return nullptr;
+}
+
+//Cached memory reads fast on the CPU, coherent only spares the invalidate
+static uint32_t findReadbackMemoryType(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeBits, bool *coherent) {
+
+	const VkMemoryPropertyFlags preferences[] = {
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+	};
+
+	for (VkMemoryPropertyFlags required : preferences) {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+			if ((typeBits & (1u << i)) && (flags & required) == required) {
+				*coherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+				return i;
+			}
+		}
+	}
+
+	throw std::runtime_error("failed to find host visible memory for capture!");
+}
+
+void createFrameCapture(FrameCapture *capture, VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t queueFamily, JobSystem *jobSystem) {
+
+	capture->device = device;
+	capture->jobSystem = jobSystem;
+	capture->memoryProperties = memoryProperties;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, vulkanAllocator(), &capture->commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create capture command pool!");
+	}
+
+	capture->active = true;
+}
+
+static double framesPerSecond(uint64_t intervals, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+	double seconds = std::chrono::duration<double>(end - start).count();
+	return seconds > 0.0 ? intervals / seconds : 0.0;
+}
+
+//Capturing costs a copy per frame and the encoders' CPU time: compared against the frames before --capture-from
+static void printCaptureThroughput(const FrameCapture &capture) {
+
+	const double targetPercent = 90.0;
+
+	if (capture.captureIntervals == 0) {
+		return;
+	}
+	double capturedFps = framesPerSecond(capture.captureIntervals, capture.captureStart, capture.captureEnd);
+	std::cout << "Capture throughput: " << std::fixed << std::setprecision(1) << capturedFps << " fps while capturing";
+
+	//The first frame compiles and warms up, the reference starts after it
+	uint64_t firstFrame = capture.options.firstFrame;
+	if (firstFrame < 3) {
+		std::cout << ", no uncaptured reference (--capture-from=N measures frames 1 to N-1 without capture)" << std::endl;
+	}
+	else {
+		double referenceFps = framesPerSecond(firstFrame - 1, capture.referenceStart, capture.captureStart);
+		double percent = referenceFps > 0.0 ? capturedFps * 100.0 / referenceFps : 0.0;
+		std::cout << ", " << referenceFps << " fps before, " << percent << "% of uncaptured, target " << targetPercent << "%: "
+			<< (percent >= targetPercent ? "met" : "MISSED") << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+void destroyFrameCapture(FrameCapture *capture) {
+
+	if (!capture->active) {
+		return;
+	}
+
+	vkDestroyCommandPool(capture->device, capture->commandPool, vulkanAllocator());
+	capture->commandPool = VK_NULL_HANDLE;
+	capture->active = false;
+
+	uint64_t captured = capture->captured.load();
+	std::cout << "Capture: " << captured << " frame(s)";
+	if (capture->options.format != CaptureOptions::NONE) {
+		std::cout << " to " << capture->options.path << (capture->options.format == CaptureOptions::PNG ? "_*.png" : "*.y4m");
+	}
+	std::cout << ", " << capture->dropped << " dropped with the ring full";
+	if (capture->options.format == CaptureOptions::Y4M) {
+		std::cout << " (" << capture->repeated << " repeated in the stream)";
+	}
+	std::cout << ", ring " << capture->largestRing << " of " << capture->options.ringSize;
+	if (captured > 0) {
+		std::cout << ", encode mean " << capture->encodeNanoseconds.load() / captured / 1e6 << " ms";
+	}
+	std::cout << std::endl;
+
+	printCaptureThroughput(*capture);
+}
+
+//Image (left in layout by the render pass or the dynamic resolution blit) to the slot's buffer, then back for present
+static void recordCopy(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout, VkBuffer buffer, VkExtent2D extent) {
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording capture command buffer!");
+	}
+
+	VkImageMemoryBarrier toTransfer = {};
+	toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	toTransfer.oldLayout = layout;
+	toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.image = image;
+	toTransfer.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	toTransfer.subresourceRange.levelCount = 1;
+	toTransfer.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { extent.width, extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+	VkImageMemoryBarrier toPresent = toTransfer;
+	toPresent.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	toPresent.dstAccessMask = 0;
+	toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	toPresent.newLayout = layout;
+
+	VkBufferMemoryBarrier toHost = {};
+	toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toHost.buffer = buffer;
+	toHost.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &toPresent);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &toHost, 0, nullptr);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record capture command buffer!");
+	}
+}
+
+static size_t chromaSize(VkExtent2D extent) {
+	return static_cast<size_t>((extent.width + 1) / 2) * ((extent.height + 1) / 2);
+}
+
+static void openStreamSegment(FrameCapture *capture) {
+
+	std::string name = capture->options.path;
+	if (capture->segment > 0) {
+		name += "_" + std::to_string(capture->segment);
+	}
+	name += ".y4m";
+	capture->segment++;
+
+	capture->stream = std::fopen(name.c_str(), "wb");
+	if (capture->stream == nullptr) {
+		std::cout << "Capture: could not open " << name << std::endl;
+		return;
+	}
+	std::fprintf(capture->stream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", capture->extent.width, capture->extent.height, capture->options.frameRate);
+}
+
+static size_t captureScratchSize(const FrameCapture &capture) {
+
+	if (capture.options.format == CaptureOptions::PNG) {
+		return PNG_BLOCK_SIZE + static_cast<size_t>(capture.extent.width) * 3;
+	}
+	if (capture.options.format == CaptureOptions::Y4M) {
+		return static_cast<size_t>(capture.extent.width) * capture.extent.height + 2 * chromaSize(capture.extent);
+	}
+	return 0;
+}
+
+//Buffer, mapping, scratch and one recorded copy per swap chain image
+static void createSlot(FrameCapture *capture, CaptureSlot *slot) {
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = static_cast<VkDeviceSize>(capture->extent.width) * capture->extent.height * 4;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(capture->device, &bufferInfo, vulkanAllocator(), &slot->buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create capture buffer!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(capture->device, slot->buffer, &requirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findReadbackMemoryType(capture->memoryProperties, requirements.memoryTypeBits, &capture->coherent);
+
+	if (vkAllocateMemory(capture->device, &allocInfo, vulkanAllocator(), &slot->memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate capture memory!");
+	}
+	vkBindBufferMemory(capture->device, slot->buffer, slot->memory, 0);
+
+	//Mapped for the lifetime of the slot, the workers read it in place
+	void *mapped;
+	if (vkMapMemory(capture->device, slot->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map capture memory!");
+	}
+	slot->mapped = static_cast<const uint8_t *>(mapped);
+
+	slot->copies.resize(capture->images.size());
+
+	VkCommandBufferAllocateInfo commandInfo = {};
+	commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandInfo.commandPool = capture->commandPool;
+	commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandInfo.commandBufferCount = static_cast<uint32_t>(slot->copies.size());
+
+	if (vkAllocateCommandBuffers(capture->device, &commandInfo, slot->copies.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate capture command buffers!");
+	}
+	for (size_t image = 0; image < capture->images.size(); image++) {
+		recordCopy(slot->copies[image], capture->images[image], capture->layout, slot->buffer, capture->extent);
+	}
+
+	slot->scratch.resize(captureScratchSize(*capture));
+	slot->state.store(CaptureSlot::FREE, std::memory_order_relaxed);
+}
+
+void createCaptureTargets(FrameCapture *capture, const std::vector<VkImage> &images, VkImageLayout layout, VkFormat format, VkExtent2D extent) {
+
+	if (!capture->active) {
+		return;
+	}
+	if (!captureFormat(format, &capture->swapRedBlue)) {
+		std::cout << "Capture paused: swap chain format is not 8 bit RGBA or BGRA" << std::endl;
+		return;
+	}
+
+	capture->extent = extent;
+	capture->images = images;
+	capture->layout = layout;
+	capture->slots.reset(new CaptureSlot[capture->options.ringSize]);
+	capture->pendingDrops = 0;
+
+	//Two cover a copy in flight while the previous frame encodes, the rest is added as the encoders need it
+	uint32_t initialSlots = std::min(capture->options.ringSize, 2u);
+	for (uint32_t i = 0; i < initialSlots; i++) {
+		createSlot(capture, &capture->slots[i]);
+	}
+	capture->slotCount.store(initialSlots, std::memory_order_release);
+	capture->largestRing = std::max(capture->largestRing, initialSlots);
+
+	if (capture->options.format == CaptureOptions::Y4M) {
+		capture->lastFrame.assign(captureScratchSize(*capture), 0);
+		openStreamSegment(capture);
+	}
+}
+
+//Frames dropped after the last one written, repeated under the stream mutex or once the workers are done
+static void writeRepeats(FrameCapture *capture, uint64_t count) {
+
+	size_t frameSize = captureScratchSize(*capture);
+	for (uint64_t i = 0; i < count; i++) {
+		if (capture->stream != nullptr) {
+			std::fputs("FRAME\n", capture->stream);
+			std::fwrite(capture->lastFrame.data(), 1, frameSize, capture->stream);
+		}
+		capture->repeated++;
+	}
+}
+
+void destroyCaptureTargets(FrameCapture *capture, uint64_t completedValue) {
+
+	if (!capture->active || capture->slotCount == 0) {
+		return;
+	}
+
+	collectCaptures(capture, completedValue);
+	waitForCounter(capture->jobSystem, &capture->encodes);
+
+	//Drops after the last captured frame still take their place in the stream
+	if (capture->options.format == CaptureOptions::Y4M) {
+		writeRepeats(capture, capture->pendingDrops);
+		capture->nextWrite += capture->pendingDrops;
+	}
+	capture->pendingDrops = 0;
+
+	for (uint32_t i = 0; i < capture->slotCount; i++) {
+		CaptureSlot &slot = capture->slots[i];
+		vkFreeCommandBuffers(capture->device, capture->commandPool, static_cast<uint32_t>(slot.copies.size()), slot.copies.data());
+		vkUnmapMemory(capture->device, slot.memory);
+		vkDestroyBuffer(capture->device, slot.buffer, vulkanAllocator());
+		vkFreeMemory(capture->device, slot.memory, vulkanAllocator());
+	}
+	capture->slots.reset();
+	capture->slotCount = 0;
+
+	if (capture->stream != nullptr) {
+		std::fclose(capture->stream);
+		capture->stream = nullptr;
+	}
+}
+
+VkCommandBuffer beginCapture(FrameCapture *capture, uint32_t imageIndex, uint64_t signalValue) {
+
+	const CaptureOptions &options = capture->options;
+	uint64_t frame = capture->frames++;
+	if (capture->slotCount == 0) {
+		return VK_NULL_HANDLE;
+	}
+
+	bool finished = options.frameCount != 0 && capture->nextSequence >= options.frameCount;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (frame == 1) {
+		capture->referenceStart = now;
+	}
+	if (frame == options.firstFrame) {
+		capture->captureStart = now;
+	}
+	else if (frame > options.firstFrame && !finished) {
+		capture->captureEnd = now;
+		capture->captureIntervals = frame - options.firstFrame;
+	}
+
+	if (frame < options.firstFrame || (frame - options.firstFrame) % options.every != 0 || finished) {
+		return VK_NULL_HANDLE;
+	}
+
+	CaptureSlot *slot = nullptr;
+	uint32_t slotCount = capture->slotCount.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < slotCount; i++) {
+		if (capture->slots[i].state.load(std::memory_order_acquire) == CaptureSlot::FREE) {
+			slot = &capture->slots[i];
+			break;
+		}
+	}
+
+	//Every slot waits on the encoders: one more covers their latency, up to the ring size
+	if (slot == nullptr && slotCount < options.ringSize) {
+		slot = &capture->slots[slotCount];
+		createSlot(capture, slot);
+		capture->slotCount.store(slotCount + 1, std::memory_order_release);
+		capture->largestRing = std::max(capture->largestRing, slotCount + 1);
+	}
+
+	//A full ring drops the frame, waiting would stall the frame loop on the encoders.
+	//It keeps its sequence number, the Y4M writer repeats the frame before it.
+	if (slot == nullptr) {
+		capture->nextSequence++;
+		capture->pendingDrops++;
+		capture->dropped++;
+		return VK_NULL_HANDLE;
+	}
+
+	slot->state.store(CaptureSlot::PENDING, std::memory_order_relaxed);
+	slot->value = signalValue;
+	slot->sequence = capture->nextSequence++;
+	slot->droppedBefore = capture->pendingDrops;
+	capture->pendingDrops = 0;
+	return slot->copies[imageIndex];
+}
+
+static bool writePng(const FrameCapture &capture, CaptureSlot *slot) {
+
+	uint32_t width = capture.extent.width;
+	uint8_t *row = slot->scratch.data() + PNG_BLOCK_SIZE;
+	int red = capture.swapRedBlue ? 2 : 0;
+	int blue = capture.swapRedBlue ? 0 : 2;
+
+	PngWriter writer;
+	if (!beginPng(&writer, capture.options.path + "_" + std::to_string(slot->sequence) + ".png", width, capture.extent.height, slot->scratch.data())) {
+		return false;
+	}
+
+	for (uint32_t y = 0; y < capture.extent.height; y++) {
+		const uint8_t *pixel = slot->mapped + static_cast<size_t>(y) * width * 4;
+		uint8_t *out = row;
+		for (uint32_t x = 0; x < width; x++, pixel += 4, out += 3) {
+			out[0] = pixel[red];
+			out[1] = pixel[1];
+			out[2] = pixel[blue];
+		}
+		writePngRow(&writer, row);
+	}
+
+	return endPng(&writer);
+}
+
+//Full range BT.601 (JPEG) 4:2:0, chroma averaged over each 2x2 block. One pass over row pairs: each
+//pixel is read once for both planes. An odd last column or row repeats its pixels, which keeps the average.
+static void convertYuv(const FrameCapture &capture, CaptureSlot *slot) {
+
+	uint32_t width = capture.extent.width;
+	uint32_t height = capture.extent.height;
+	uint32_t chromaWidth = (width + 1) / 2;
+	uint32_t chromaHeight = (height + 1) / 2;
+
+	uint8_t *planeY = slot->scratch.data();
+	uint8_t *planeU = planeY + static_cast<size_t>(width) * height;
+	uint8_t *planeV = planeU + chromaSize(capture.extent);
+
+	int red = capture.swapRedBlue ? 2 : 0;
+	int blue = capture.swapRedBlue ? 0 : 2;
+
+	for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+		uint32_t y0 = cy * 2;
+		uint32_t y1 = std::min(y0 + 1, height - 1);
+		const uint8_t *rows[2] = { slot->mapped + static_cast<size_t>(y0) * width * 4, slot->mapped + static_cast<size_t>(y1) * width * 4 };
+		uint8_t *lumaRows[2] = { planeY + static_cast<size_t>(y0) * width, planeY + static_cast<size_t>(y1) * width };
+		uint8_t *outU = planeU + static_cast<size_t>(cy) * chromaWidth;
+		uint8_t *outV = planeV + static_cast<size_t>(cy) * chromaWidth;
+
+		for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+			uint32_t columns[2] = { cx * 2, std::min(cx * 2 + 1, width - 1) };
+			int r = 0, g = 0, b = 0;
+			for (int row = 0; row < 2; row++) {
+				for (int column = 0; column < 2; column++) {
+					const uint8_t *pixel = rows[row] + columns[column] * 4;
+					lumaRows[row][columns[column]] = static_cast<uint8_t>((77 * pixel[red] + 150 * pixel[1] + 29 * pixel[blue] + 128) >> 8);
+					r += pixel[red];
+					g += pixel[1];
+					b += pixel[blue];
+				}
+			}
+			r >>= 2;
+			g >>= 2;
+			b >>= 2;
+
+			outU[cx] = static_cast<uint8_t>(std::min(255, (-43 * r - 85 * g + 128 * b + 32896) >> 8));
+			outV[cx] = static_cast<uint8_t>(std::min(255, (128 * r - 107 * g - 21 * b + 32896) >> 8));
+		}
+	}
+}
+
+//Frames may finish converting out of order, each worker writes every ready frame that is next in line.
+//Frames dropped before it repeat the last written one, the stream keeps one frame per sequence number.
+static void writeReadyFrames(FrameCapture *capture) {
+
+	std::lock_guard<std::mutex> lock(capture->streamMutex);
+
+	size_t frameSize = captureScratchSize(*capture);
+	uint32_t slotCount = capture->slotCount.load(std::memory_order_acquire);
+
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (uint32_t i = 0; i < slotCount; i++) {
+			CaptureSlot &slot = capture->slots[i];
+			if (slot.state.load(std::memory_order_acquire) != CaptureSlot::READY || slot.sequence - slot.droppedBefore != capture->nextWrite) {
+				continue;
+			}
+
+			writeRepeats(capture, slot.droppedBefore);
+			if (capture->stream != nullptr) {
+				std::fputs("FRAME\n", capture->stream);
+				std::fwrite(slot.scratch.data(), 1, frameSize, capture->stream);
+			}
+			//The written frame is kept for the next repeats, its old buffer becomes the slot's scratch
+			capture->lastFrame.swap(slot.scratch);
+			capture->nextWrite = slot.sequence + 1;
+			slot.state.store(CaptureSlot::FREE, std::memory_order_release);
+			progress = true;
+		}
+	}
+}
+
+static void encodeSlot(FrameCapture *capture, CaptureSlot *slot) {
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if (capture->inspect) {
+		capture->inspect({ slot->mapped, capture->extent, capture->swapRedBlue, slot->sequence });
+	}
+
+	if (capture->options.format == CaptureOptions::NONE) {
+		slot->state.store(CaptureSlot::FREE, std::memory_order_release);
+	}
+	else if (capture->options.format == CaptureOptions::PNG) {
+		if (!writePng(*capture, slot)) {
+			std::cout << "Capture: could not write frame " << slot->sequence << std::endl;
+		}
+		slot->state.store(CaptureSlot::FREE, std::memory_order_release);
+	}
+	else {
+		convertYuv(*capture, slot);
+		slot->state.store(CaptureSlot::READY, std::memory_order_release);
+		writeReadyFrames(capture);
+	}
+
+	capture->captured.fetch_add(1, std::memory_order_relaxed);
+	capture->encodeNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+}
+
+void collectCaptures(FrameCapture *capture, uint64_t completedValue) {
+
+	for (uint32_t i = 0; i < capture->slotCount; i++) {
+		CaptureSlot *slot = &capture->slots[i];
+		if (slot->state.load(std::memory_order_relaxed) != CaptureSlot::PENDING || slot->value > completedValue) {
+			continue;
+		}
+
+		if (!capture->coherent) {
+			VkMappedMemoryRange range = {};
+			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range.memory = slot->memory;
+			range.size = VK_WHOLE_SIZE;
+			vkInvalidateMappedMemoryRanges(capture->device, 1, &range);
+		}
+
+		//The worker reads the mapped buffer in place and frees the slot when done
+		slot->state.store(CaptureSlot::ENCODING, std::memory_order_release);
+		spawnJob(capture->jobSystem, &capture->encodes, [capture, slot]() { encodeSlot(capture, slot); });
+	}
+}
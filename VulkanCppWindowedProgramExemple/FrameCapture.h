@@ -0,0 +1,129 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+//Capture of presented frames, set from the command line:
+//  --capture=png|y4m      one PNG per frame, or one raw YUV 4:2:0 stream (a new file per swap chain size)
+//  --capture-path=PREFIX  output file prefix, "capture" by default
+//  --capture-every=N      capture one frame out of N
+//  --capture-from=N       first presented frame captured, counting from 0
+//  --capture-count=N      stop after N captured frames, 0 for no limit
+//  --capture-ring=N       most readback buffers, 8 by default: the ring starts at 2 and grows while the encoders
+//                         lag behind, a frame is dropped rather than waited for once all of them are busy
+//  --capture-fps=N        frame rate written in the Y4M header
+//A dropped frame keeps its number: the Y4M stream repeats the frame before it so playback keeps the
+//header's rate, PNG numbering skips it. Frames before --capture-from are the uncaptured reference
+//of the throughput report, which targets 90% of their frame rate while capturing.
+struct CaptureOptions {
+	enum Format { NONE, PNG, Y4M };
+
+	Format format = NONE;
+	std::string path = "capture";
+	uint32_t every = 1;
+	uint64_t firstFrame = 0;
+	uint64_t frameCount = 0;
+	uint32_t ringSize = 8;
+	uint32_t frameRate = 60;
+};
+
+//One host visible readback buffer. The copy is submitted with the frame and the buffer is handed
+//to a worker once the frame's timeline value completed, the worker encodes from the mapped memory.
+struct CaptureSlot {
+	enum State { FREE, PENDING, ENCODING, READY };
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	const uint8_t *mapped = nullptr;
+	std::vector<VkCommandBuffer> copies; //one per swap chain image
+
+	std::atomic<int> state{ FREE };
+	uint64_t value = 0; //timeline value of the frame the copy was submitted with
+	uint64_t sequence = 0;
+	uint64_t droppedBefore = 0; //sequence numbers right before this one that were dropped
+
+	//Encoder scratch, sized with the targets so encoding does not allocate
+	std::vector<uint8_t> scratch;
+};
+
+//A captured frame as read back, 4 bytes per pixel, only valid during the inspect call
+struct CapturedFrame {
+	const uint8_t *pixels;
+	VkExtent2D extent;
+	bool swapRedBlue; //BGRA rather than RGBA
+	uint64_t sequence;
+};
+
+struct FrameCapture {
+	CaptureOptions options;
+	//Called on a worker for every captured frame before it is encoded, capture runs with
+	//format NONE when only the hook is set
+	std::function<void(const CapturedFrame &)> inspect;
+	bool active = false;
+
+	VkDevice device = VK_NULL_HANDLE;
+	JobSystem *jobSystem = nullptr;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+
+	//Targets, recreated with the swap chain. options.ringSize slots are allocated up front,
+	//slotCount of them have buffers: the ring grows by one when a frame finds them all busy.
+	VkExtent2D extent = {};
+	bool swapRedBlue = false;
+	bool coherent = false;
+	std::vector<VkImage> images;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	std::unique_ptr<CaptureSlot[]> slots;
+	std::atomic<uint32_t> slotCount{ 0 };
+	uint32_t largestRing = 0;
+
+	uint64_t frames = 0;
+	uint64_t nextSequence = 0;
+	uint64_t pendingDrops = 0; //dropped since the last captured frame
+	JobCounter encodes;
+
+	//Y4M frames are written in capture order whatever worker finished first
+	std::mutex streamMutex;
+	FILE *stream = nullptr;
+	uint64_t nextWrite = 0;
+	uint32_t segment = 0;
+	std::vector<uint8_t> lastFrame; //the last written frame, swapped with the slot's scratch
+
+	//Frame loop times: the reference before options.firstFrame, then while capturing
+	std::chrono::steady_clock::time_point referenceStart;
+	std::chrono::steady_clock::time_point captureStart;
+	std::chrono::steady_clock::time_point captureEnd;
+	uint64_t captureIntervals = 0;
+
+	std::atomic<uint64_t> captured{ 0 };
+	std::atomic<uint64_t> encodeNanoseconds{ 0 };
+	uint64_t dropped = 0;
+	uint64_t repeated = 0;
+};
+
+CaptureOptions parseCaptureOptions(int argc, char *argv[]);
+
+//Why the swap chain cannot be captured, nullptr when it can
+const char *captureUnsupportedReason(VkFormat format, VkImageUsageFlags supportedUsage, bool separatePresentQueue);
+
+void createFrameCapture(FrameCapture *capture, VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t queueFamily, JobSystem *jobSystem);
+void destroyFrameCapture(FrameCapture *capture);
+
+//Readback buffers and copy command buffers for the swap chain images, which need TRANSFER_SRC usage.
+//layout is the one drawing leaves the images in, each copy restores it.
+void createCaptureTargets(FrameCapture *capture, const std::vector<VkImage> &images, VkImageLayout layout, VkFormat format, VkExtent2D extent);
+//The device must be idle: hands over the last copies and waits for every encode
+void destroyCaptureTargets(FrameCapture *capture, uint64_t completedValue);
+
+//Copy to submit after the frame's draw, VK_NULL_HANDLE when this frame is not captured or the ring is full
+VkCommandBuffer beginCapture(FrameCapture *capture, uint32_t imageIndex, uint64_t signalValue);
+//Hands the slots whose copy completed to the workers, never waits on the GPU
+void collectCaptures(FrameCapture *capture, uint64_t completedValue);
@@ -0,0 +1,156 @@
+#include "FramePolicy.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+FramePolicy parseFramePolicy(int argc, char *argv[]) {
+
+	FramePolicy policy;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--frames-in-flight", &value)) {
+			int frames = std::stoi(value);
+			if (frames < 1 || frames > static_cast<int>(MAX_FRAMES_IN_FLIGHT)) {
+				throw std::runtime_error("--frames-in-flight must be between 1 and 4");
+			}
+			policy.framesInFlight = static_cast<uint32_t>(frames);
+		}
+		else if (matchOption(arg, "--swapchain-images", &value)) {
+			policy.swapChainImageCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchOption(arg, "--present-mode", &value)) {
+			policy.presentModes.clear();
+
+			std::stringstream modes(value);
+			std::string name;
+			while (std::getline(modes, name, ',')) {
+				VkPresentModeKHR presentMode;
+				if (!parsePresentMode(name, &presentMode)) {
+					throw std::runtime_error("unknown present mode: " + name);
+				}
+				policy.presentModes.push_back(presentMode);
+			}
+		}
+		else if (matchOption(arg, "--target-fps", &value)) {
+			policy.targetFrameRate = std::stod(value);
+		}
+		else if (matchFlag(arg, "--latency-sweep")) {
+			policy.latencySweep = true;
+		}
+		else if (matchFlag(arg, "--single-thread")) {
+			policy.renderThread = false;
+		}
+		else if (matchOption(arg, "--frames", &value)) {
+			policy.frameLimit = std::stoull(value);
+		}
+		else if (matchFlag(arg, "--headless")) {
+			policy.headless = true;
+		}
+		else if (matchFlag(arg, "--offscreen")) {
+			policy.offscreen = true;
+		}
+		else if (matchFlag(arg, "--render-pass")) {
+			policy.renderPassFallback = true;
+		}
+		else if (matchFlag(arg, "--on-demand")) {
+			policy.onDemand = true;
+		}
+		else if (matchOption(arg, "--idle-wake-ms", &value)) {
+			policy.idleWakeMs = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+		}
+		else if (matchOption(arg, "--seconds", &value)) {
+			policy.runSeconds = std::stod(value);
+		}
+		else if (matchOption(arg, "--windows", &value)) {
+			int windows = std::stoi(value);
+			if (windows < 1 || windows > static_cast<int>(MAX_WINDOWS)) {
+				throw std::runtime_error("--windows must be between 1 and 8");
+			}
+			policy.windowCount = static_cast<uint32_t>(windows);
+		}
+	}
+
+	return policy;
+}
+
+std::string describeFramePolicy(const FramePolicy &policy) {
+
+	std::stringstream description;
+	description << "frames in flight " << policy.framesInFlight << ", swap chain images ";
+	if (policy.swapChainImageCount == 0) {
+		description << "min+1";
+	}
+	else {
+		description << policy.swapChainImageCount;
+	}
+	description << ", present mode";
+	for (VkPresentModeKHR presentMode : policy.presentModes) {
+		description << " " << presentModeName(presentMode);
+	}
+	description << (policy.renderThread ? ", render thread" : ", single thread");
+	if (policy.onDemand) {
+		description << ", on demand";
+	}
+	if (policy.windowCount > 1) {
+		description << ", " << policy.windowCount << " windows";
+	}
+	if (policy.offscreen) {
+		description << ", offscreen";
+	}
+	return description.str();
+}
+
+VkPresentModeKHR choosePresentMode(const FramePolicy &policy, const std::vector<VkPresentModeKHR> &availablePresentModes) {
+
+	for (VkPresentModeKHR preferred : policy.presentModes) {
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) != availablePresentModes.end()) {
+			return preferred;
+		}
+	}
+
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t chooseImageCount(const FramePolicy &policy, const VkSurfaceCapabilitiesKHR &capabilities) {
+
+	uint32_t imageCount = policy.swapChainImageCount == 0 ? capabilities.minImageCount + 1 : policy.swapChainImageCount;
+
+	imageCount = std::max(imageCount, capabilities.minImageCount);
+	if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+		imageCount = capabilities.maxImageCount;
+	}
+
+	return imageCount;
+}
+
+const char *presentModeName(VkPresentModeKHR presentMode) {
+	switch (presentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "fifo_relaxed";
+	default:
+		return "unknown";
+	}
+}
+
+bool parsePresentMode(const std::string &name, VkPresentModeKHR *presentMode) {
+
+	const VkPresentModeKHR modes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+
+	for (VkPresentModeKHR mode : modes) {
+		if (name == presentModeName(mode)) {
+			*presentMode = mode;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+const uint32_t MAX_WINDOWS = 8;
+
+//Runtime frame pacing policy, set from the command line:
+//  --frames-in-flight=N       frames the CPU may record ahead of the GPU (1-4)
+//  --swapchain-images=N       requested swap chain images, 0 for minImageCount + 1
+//  --present-mode=a,b,...     preference order among fifo, fifo_relaxed, mailbox, immediate
+//  --target-fps=N             frame rate a configuration must sustain in the latency sweep
+//  --latency-sweep            measure every configuration and keep the lowest latency one
+//  --single-thread            poll SDL events between frames instead of on a separate thread from rendering
+//  --frames=N                 quit after N presented frames, 0 runs until the window is closed
+//  --headless                 hidden window, for long unattended runs such as the allocation check;
+//                             renders offscreen when there is no display to create the window on
+//  --offscreen                no window nor surface: every window renders into images of its own, read back
+//                             by the capture, for runs on a software rasterizer without a display
+//  --render-pass              render pass and framebuffer objects even where dynamic rendering is supported
+//  --on-demand                present only when the scene or the window changed, sleep in between
+//  --idle-wake-ms=N           longest sleep on demand, pending pipeline compiles are picked up at this rate
+//  --seconds=N                quit after N seconds, 0 for no limit: compares usage with and without --on-demand
+//  --windows=N                windows rendered from the one device, submitted and presented together (1-8)
+struct FramePolicy {
+	uint32_t framesInFlight = 2;
+	uint32_t swapChainImageCount = 0;
+	std::vector<VkPresentModeKHR> presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+	double targetFrameRate = 60.0;
+	bool latencySweep = false;
+	bool renderThread = true;
+	uint64_t frameLimit = 0;
+	bool headless = false;
+	bool offscreen = false;
+	bool renderPassFallback = false;
+	bool onDemand = false;
+	uint32_t idleWakeMs = 100;
+	double runSeconds = 0.0;
+	uint32_t windowCount = 1;
+};
+
+FramePolicy parseFramePolicy(int argc, char *argv[]);
+std::string describeFramePolicy(const FramePolicy &policy);
+
+//First supported mode of the preference order, FIFO is always available
+VkPresentModeKHR choosePresentMode(const FramePolicy &policy, const std::vector<VkPresentModeKHR> &availablePresentModes);
+uint32_t chooseImageCount(const FramePolicy &policy, const VkSurfaceCapabilitiesKHR &capabilities);
+
+const char *presentModeName(VkPresentModeKHR presentMode);
+bool parsePresentMode(const std::string &name, VkPresentModeKHR *presentMode);
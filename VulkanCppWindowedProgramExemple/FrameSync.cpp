@@ -0,0 +1,218 @@
+#include "FrameSync.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+void createFrameSync(VkDevice device, bool useTimeline, uint32_t framesInFlight, FrameSync *sync) {
+
+	sync->timeline = useTimeline;
+	sync->lastSubmitted = 0;
+	sync->lastCompleted = 0;
+
+	if (useTimeline) {
+		VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		timelineInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device, &timelineInfo, vulkanAllocator(), &sync->timelineSemaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+
+		sync->waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+		sync->getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+		if (sync->waitSemaphores == nullptr || sync->getSemaphoreCounterValue == nullptr) {
+			throw std::runtime_error("failed to load timeline semaphore functions!");
+		}
+	}
+
+	sync->frameValues.assign(framesInFlight, 0);
+
+	if (!useTimeline) {
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		sync->fences.resize(framesInFlight);
+		for (size_t i = 0; i < framesInFlight; i++) {
+			if (vkCreateFence(device, &fenceInfo, vulkanAllocator(), &sync->fences[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create fences!");
+			}
+		}
+	}
+}
+
+void destroyFrameSync(VkDevice device, FrameSync *sync) {
+
+	waitForValue(device, sync, sync->lastSubmitted);
+	//Every submission completed: releases deferred to a value never submitted run too
+	for (FrameSync::PendingRelease &pending : sync->pendingReleases) {
+		pending.release();
+	}
+	sync->pendingReleases.clear();
+
+	for (VkFence fence : sync->fences) {
+		vkDestroyFence(device, fence, vulkanAllocator());
+	}
+	if (sync->timelineSemaphore != VK_NULL_HANDLE) {
+		vkDestroySemaphore(device, sync->timelineSemaphore, vulkanAllocator());
+	}
+
+	*sync = FrameSync();
+}
+
+static VkSemaphore createBinarySemaphore(VkDevice device) {
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkSemaphore semaphore;
+	if (vkCreateSemaphore(device, &semaphoreInfo, vulkanAllocator(), &semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create semaphores!");
+	}
+	return semaphore;
+}
+
+void createSwapChainSync(VkDevice device, uint32_t framesInFlight, uint32_t imageCount, SwapChainSync *sync) {
+
+	sync->imageAvailableSemaphores.resize(framesInFlight);
+	for (size_t i = 0; i < framesInFlight; i++) {
+		sync->imageAvailableSemaphores[i] = createBinarySemaphore(device);
+	}
+
+	resizeSwapChainSync(device, imageCount, sync);
+}
+
+void resizeSwapChainSync(VkDevice device, uint32_t imageCount, SwapChainSync *sync) {
+
+	while (sync->renderFinishedSemaphores.size() < imageCount) {
+		sync->renderFinishedSemaphores.push_back(createBinarySemaphore(device));
+	}
+	sync->imagesInFlight.assign(imageCount, 0);
+}
+
+void destroySwapChainSync(VkDevice device, SwapChainSync *sync) {
+
+	for (VkSemaphore semaphore : sync->imageAvailableSemaphores) {
+		vkDestroySemaphore(device, semaphore, vulkanAllocator());
+	}
+	for (VkSemaphore semaphore : sync->renderFinishedSemaphores) {
+		vkDestroySemaphore(device, semaphore, vulkanAllocator());
+	}
+
+	*sync = SwapChainSync();
+}
+
+uint64_t lastSwapChainValue(const SwapChainSync &sync) {
+
+	uint64_t value = 0;
+	for (uint64_t imageValue : sync.imagesInFlight) {
+		value = std::max(value, imageValue);
+	}
+	return value;
+}
+
+uint64_t beginSubmit(VkDevice device, FrameSync *sync, size_t currentFrame) {
+
+	uint64_t value = ++sync->lastSubmitted;
+	sync->frameValues[currentFrame] = value;
+
+	//The fence was waited on through frameValues before the slot is reused
+	if (!sync->timeline) {
+		vkResetFences(device, 1, &sync->fences[currentFrame]);
+	}
+
+	return value;
+}
+
+VkFence submitFence(const FrameSync &sync, size_t currentFrame) {
+	return sync.timeline ? VK_NULL_HANDLE : sync.fences[currentFrame];
+}
+
+uint64_t pollCompletedValue(VkDevice device, FrameSync *sync) {
+
+	if (sync->timeline) {
+		uint64_t value = 0;
+		if (sync->getSemaphoreCounterValue(device, sync->timelineSemaphore, &value) == VK_SUCCESS) {
+			sync->lastCompleted = std::max(sync->lastCompleted, value);
+		}
+	}
+	else {
+		for (size_t i = 0; i < sync->fences.size(); i++) {
+			if (sync->frameValues[i] > sync->lastCompleted && vkGetFenceStatus(device, sync->fences[i]) == VK_SUCCESS) {
+				sync->lastCompleted = sync->frameValues[i];
+			}
+		}
+	}
+
+	return sync->lastCompleted;
+}
+
+void waitForValue(VkDevice device, FrameSync *sync, uint64_t value) {
+
+	if (value <= sync->lastCompleted) {
+		return;
+	}
+	if (value > sync->lastSubmitted) {
+		throw std::runtime_error("waiting on a timeline value that was never submitted!");
+	}
+
+	if (sync->timeline) {
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &sync->timelineSemaphore;
+		waitInfo.pValues = &value;
+
+		if (sync->waitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to wait on timeline semaphore!");
+		}
+		sync->lastCompleted = value;
+		return;
+	}
+
+	//Submissions retire in order, the oldest slot at or after value covers it
+	size_t slot = sync->fences.size();
+	for (size_t i = 0; i < sync->fences.size(); i++) {
+		if (sync->frameValues[i] >= value && (slot == sync->fences.size() || sync->frameValues[i] < sync->frameValues[slot])) {
+			slot = i;
+		}
+	}
+	if (slot == sync->fences.size()) {
+		throw std::runtime_error("no frame slot covers the requested value!");
+	}
+
+	vkWaitForFences(device, 1, &sync->fences[slot], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	sync->lastCompleted = std::max(sync->lastCompleted, sync->frameValues[slot]);
+}
+
+void releaseAfter(FrameSync *sync, uint64_t value, std::function<void()> release) {
+
+	if (value <= sync->lastCompleted) {
+		release();
+		return;
+	}
+	sync->pendingReleases.push_back({ value, std::move(release) });
+}
+
+void collectReleases(VkDevice device, FrameSync *sync) {
+
+	if (sync->pendingReleases.empty()) {
+		return;
+	}
+
+	uint64_t completed = pollCompletedValue(device, sync);
+
+	auto retired = std::stable_partition(sync->pendingReleases.begin(), sync->pendingReleases.end(),
+		[completed](const FrameSync::PendingRelease &pending) { return pending.value > completed; });
+
+	for (auto it = retired; it != sync->pendingReleases.end(); ++it) {
+		it->release();
+	}
+	sync->pendingReleases.erase(retired, sync->pendingReleases.end());
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//Frame synchronisation built on VK_KHR_timeline_semaphore.
+//Every graphics submission signals a monotonically increasing value on one timeline semaphore,
+//CPU waits are waits on a value and resources are released once the value they were retired at completed.
+//Without timeline support one fence per frame in flight emulates the same values (binary fallback).
+struct FrameSync {
+	bool timeline = false;
+	VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+	uint64_t lastSubmitted = 0;
+	uint64_t lastCompleted = 0;
+
+	//Per frame in flight
+	std::vector<uint64_t> frameValues;
+	std::vector<VkFence> fences; //binary fallback only
+
+	struct PendingRelease {
+		uint64_t value;
+		std::function<void()> release;
+	};
+	std::vector<PendingRelease> pendingReleases;
+
+	PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+};
+
+//Binary semaphores of one swap chain, the frame slots and their values are shared by every swap chain
+struct SwapChainSync {
+	//Per frame in flight
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+
+	//Per swap chain image: present wait semaphore and value of the last submission rendering to it
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+	std::vector<uint64_t> imagesInFlight;
+};
+
+void createFrameSync(VkDevice device, bool useTimeline, uint32_t framesInFlight, FrameSync *sync);
+void destroyFrameSync(VkDevice device, FrameSync *sync);
+
+void createSwapChainSync(VkDevice device, uint32_t framesInFlight, uint32_t imageCount, SwapChainSync *sync);
+//Swap chain image count can change on recreation. Semaphores are only added: a present of the
+//retired swap chain may still wait on one, and other swap chains keep rendering meanwhile.
+void resizeSwapChainSync(VkDevice device, uint32_t imageCount, SwapChainSync *sync);
+//After destroyFrameSync or another wait for every submission
+void destroySwapChainSync(VkDevice device, SwapChainSync *sync);
+//Value of the last submission rendering to any image of the swap chain
+uint64_t lastSwapChainValue(const SwapChainSync &sync);
+
+//Reserve the value signaled by the next submission of frame slot currentFrame
+uint64_t beginSubmit(VkDevice device, FrameSync *sync, size_t currentFrame);
+//Fence to pass to vkQueueSubmit for the frame slot (VK_NULL_HANDLE with timeline semaphores)
+VkFence submitFence(const FrameSync &sync, size_t currentFrame);
+
+uint64_t pollCompletedValue(VkDevice device, FrameSync *sync);
+void waitForValue(VkDevice device, FrameSync *sync, uint64_t value);
+
+//Defer release until every submission up to value has completed on the GPU
+void releaseAfter(FrameSync *sync, uint64_t value, std::function<void()> release);
+void collectReleases(VkDevice device, FrameSync *sync);
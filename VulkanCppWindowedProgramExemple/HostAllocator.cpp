@@ -0,0 +1,349 @@
+#include "HostAllocator.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+//Bump arena for command scope allocations, owned by one thread.
+//Blocks may be freed from any thread, the owner rewinds when none is live anymore.
+struct HostArena {
+	char *buffer = nullptr;
+	size_t offset = 0;
+	std::atomic<uint32_t> live{ 0 };
+
+	~HostArena() {
+		std::free(buffer);
+	}
+};
+
+//Stored right before every pointer handed to the implementation, realloc and free need the size and origin
+struct BlockHeader {
+	void *base;
+	size_t size;
+	HostArena *arena; //nullptr for heap blocks
+	VkSystemAllocationScope scope;
+};
+
+static thread_local HostArena threadArena;
+static thread_local uint64_t threadHeapCount = 0;
+static thread_local uint64_t threadNewCount = 0;
+static thread_local VkSystemAllocationScope threadLastHeapScope = VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+
+static const VkAllocationCallbacks *installedCallbacks = nullptr;
+
+static const char *scopeName(uint32_t scope) {
+	switch (scope) {
+	case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+	case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+	case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+	case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+	case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+	}
+	return "unknown";
+}
+
+HostAllocatorOptions parseHostAllocatorOptions(int argc, char *argv[]) {
+
+	HostAllocatorOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--alloc-warmup", &value)) {
+			options.warmupFrames = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchFlag(arg, "--strict-allocations")) {
+			options.strict = true;
+		}
+	}
+
+	return options;
+}
+
+//Header goes in front of the aligned pointer, the padding absorbs the alignment
+static size_t blockFootprint(size_t size, size_t alignment) {
+	return size + alignment + sizeof(BlockHeader);
+}
+
+static void *placeBlock(char *base, size_t size, size_t alignment, HostArena *arena, VkSystemAllocationScope scope) {
+
+	uintptr_t first = reinterpret_cast<uintptr_t>(base) + sizeof(BlockHeader);
+	uintptr_t aligned = (first + alignment - 1) & ~(uintptr_t(alignment) - 1);
+
+	BlockHeader *header = reinterpret_cast<BlockHeader *>(aligned) - 1;
+	header->base = base;
+	header->size = size;
+	header->arena = arena;
+	header->scope = scope;
+
+	return reinterpret_cast<void *>(aligned);
+}
+
+static BlockHeader *headerOf(void *memory) {
+	return reinterpret_cast<BlockHeader *>(memory) - 1;
+}
+
+static void *arenaAllocate(HostAllocator *allocator, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+	HostArena &arena = threadArena;
+	if (arena.buffer == nullptr) {
+		arena.buffer = static_cast<char *>(std::malloc(HOST_ARENA_SIZE));
+		if (arena.buffer == nullptr) {
+			return nullptr;
+		}
+	}
+
+	//Everything handed out earlier was freed, start over
+	if (arena.live.load(std::memory_order_acquire) == 0) {
+		arena.offset = 0;
+	}
+
+	size_t footprint = blockFootprint(size, alignment);
+	if (footprint > HOST_ARENA_SIZE - arena.offset) {
+		allocator->arenaOverflows.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	void *memory = placeBlock(arena.buffer + arena.offset, size, alignment, &arena, scope);
+	arena.offset += footprint;
+	arena.live.fetch_add(1, std::memory_order_relaxed);
+	allocator->arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+	return memory;
+}
+
+static void *heapAllocate(HostAllocator *allocator, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+	char *base = static_cast<char *>(std::malloc(blockFootprint(size, alignment)));
+	if (base == nullptr) {
+		return nullptr;
+	}
+
+	allocator->heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	threadHeapCount++;
+	threadLastHeapScope = scope;
+	return placeBlock(base, size, alignment, nullptr, scope);
+}
+
+static void countAllocation(HostAllocator *allocator, size_t size, VkSystemAllocationScope scope) {
+
+	HostScopeCounters &counters = allocator->scopes[scope];
+	counters.allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.bytes.fetch_add(size, std::memory_order_relaxed);
+
+	int64_t live = counters.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+	int64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+	}
+}
+
+static void *allocateBlock(HostAllocator *allocator, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+	if (size == 0 || static_cast<uint32_t>(scope) >= HOST_ALLOCATION_SCOPE_COUNT) {
+		return nullptr;
+	}
+	alignment = std::max(alignment, alignof(std::max_align_t));
+
+	void *memory = nullptr;
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+		memory = arenaAllocate(allocator, size, alignment, scope);
+	}
+	if (memory == nullptr) {
+		memory = heapAllocate(allocator, size, alignment, scope);
+	}
+	if (memory != nullptr) {
+		countAllocation(allocator, size, scope);
+	}
+	return memory;
+}
+
+static void freeBlock(HostAllocator *allocator, void *memory) {
+
+	BlockHeader *header = headerOf(memory);
+	HostScopeCounters &counters = allocator->scopes[header->scope];
+	counters.frees.fetch_add(1, std::memory_order_relaxed);
+	counters.liveBytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+
+	if (header->arena != nullptr) {
+		header->arena->live.fetch_sub(1, std::memory_order_release);
+	}
+	else {
+		std::free(header->base);
+	}
+}
+
+static void *VKAPI_PTR hostAllocation(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+
+	return allocateBlock(static_cast<HostAllocator *>(pUserData), size, alignment, allocationScope);
+}
+
+static void *VKAPI_PTR hostReallocation(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+
+	HostAllocator *allocator = static_cast<HostAllocator *>(pUserData);
+
+	if (pOriginal == nullptr) {
+		return hostAllocation(pUserData, size, alignment, allocationScope);
+	}
+	if (size == 0) {
+		freeBlock(allocator, pOriginal);
+		return nullptr;
+	}
+
+	//Blocks carry their own header, grow or shrink by copy into a fresh block
+	void *memory = allocateBlock(allocator, size, alignment, allocationScope);
+	if (memory == nullptr) {
+		return nullptr;
+	}
+	std::memcpy(memory, pOriginal, std::min(size, headerOf(pOriginal)->size));
+	freeBlock(allocator, pOriginal);
+
+	allocator->scopes[allocationScope].reallocations.fetch_add(1, std::memory_order_relaxed);
+	return memory;
+}
+
+static void VKAPI_PTR hostFree(void *pUserData, void *pMemory) {
+
+	if (pMemory != nullptr) {
+		freeBlock(static_cast<HostAllocator *>(pUserData), pMemory);
+	}
+}
+
+//Executable memory and other allocations the implementation makes itself, only reported to us
+static void VKAPI_PTR hostInternalAllocation(void *pUserData, size_t, VkInternalAllocationType, VkSystemAllocationScope) {
+	static_cast<HostAllocator *>(pUserData)->internalAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void VKAPI_PTR hostInternalFree(void *, size_t, VkInternalAllocationType, VkSystemAllocationScope) {
+}
+
+void createHostAllocator(HostAllocator *allocator, const HostAllocatorOptions &options) {
+
+	allocator->options = options;
+
+	allocator->callbacks.pUserData = allocator;
+	allocator->callbacks.pfnAllocation = hostAllocation;
+	allocator->callbacks.pfnReallocation = hostReallocation;
+	allocator->callbacks.pfnFree = hostFree;
+	allocator->callbacks.pfnInternalAllocation = hostInternalAllocation;
+	allocator->callbacks.pfnInternalFree = hostInternalFree;
+
+	installedCallbacks = &allocator->callbacks;
+}
+
+const VkAllocationCallbacks *vulkanAllocator() {
+	return installedCallbacks;
+}
+
+ThreadAllocations threadAllocations() {
+
+	ThreadAllocations allocations;
+	allocations.vulkan = threadHeapCount;
+	allocations.operatorNew = threadNewCount;
+	return allocations;
+}
+
+void checkFrameAllocations(HostAllocator *allocator, const ThreadAllocations &before, bool swapChainRecreated) {
+
+	allocator->frames++;
+	if (swapChainRecreated || allocator->frames <= allocator->options.warmupFrames) {
+		return;
+	}
+	allocator->steadyStateFrames++;
+
+	uint64_t vulkan = threadHeapCount - before.vulkan;
+	uint64_t operatorNew = threadNewCount - before.operatorNew;
+	if (vulkan == 0 && operatorNew == 0) {
+		return;
+	}
+	allocator->steadyStateHeapAllocations += vulkan;
+	allocator->steadyStateNewAllocations += operatorNew;
+
+	//Report the first few only, a regression usually repeats every frame
+	if (allocator->violations++ < 8) {
+		std::cout << "Frame " << allocator->frames << " allocated: " << operatorNew << " operator new, " << vulkan << " Vulkan host heap";
+		if (vulkan != 0) {
+			std::cout << " (last at " << scopeName(threadLastHeapScope) << " scope)";
+		}
+		std::cout << std::endl;
+	}
+	if (allocator->options.strict) {
+		throw std::runtime_error("heap allocation in a steady-state frame!");
+	}
+}
+
+void printHostAllocationReport(const HostAllocator &allocator) {
+
+	std::cout << "Host allocations:" << std::endl;
+	std::cout << "  " << std::left << std::setw(10) << "scope" << std::right
+		<< std::setw(10) << "allocs" << std::setw(10) << "reallocs" << std::setw(10) << "frees"
+		<< std::setw(14) << "bytes" << std::setw(12) << "peak" << std::setw(10) << "live" << std::endl;
+
+	for (uint32_t scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; scope++) {
+		const HostScopeCounters &counters = allocator.scopes[scope];
+		std::cout << "  " << std::left << std::setw(10) << scopeName(scope) << std::right
+			<< std::setw(10) << counters.allocations.load()
+			<< std::setw(10) << counters.reallocations.load()
+			<< std::setw(10) << counters.frees.load()
+			<< std::setw(14) << counters.bytes.load()
+			<< std::setw(12) << counters.peakBytes.load()
+			<< std::setw(10) << counters.liveBytes.load() << std::endl;
+	}
+
+	std::cout << "  heap " << allocator.heapAllocations.load() << ", arena " << allocator.arenaAllocations.load()
+		<< " (" << allocator.arenaOverflows.load() << " overflowed), internal " << allocator.internalAllocations.load() << std::endl;
+	std::cout << "  steady-state frames " << allocator.steadyStateFrames << ", allocations in them: "
+		<< allocator.steadyStateNewAllocations << " operator new, " << allocator.steadyStateHeapAllocations << " Vulkan host heap" << std::endl;
+}
+
+//Counting replacements of the global operator new and delete, forwarding to malloc.
+//Aligned overloads keep the standard library versions and are not counted.
+void *operator new(std::size_t size) {
+
+	threadNewCount++;
+	if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	threadNewCount++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void *memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+	std::free(memory);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Host memory handed to the Vulkan implementation through VkAllocationCallbacks.
+//Object, cache, device and instance scope allocations outlive the call and go to the general heap,
+//command scope allocations only live for the duration of one vkXxx call and come from a per-thread
+//bump arena that rewinds once everything allocated from it was freed.
+//Every allocation is counted per VkSystemAllocationScope, heap allocations are also counted per thread
+//along with operator new so the frame loop can check it did not hit the heap once warmed up.
+//The check only sees the thread calling drawFrame, and the jobs it happens to run while it waits:
+//allocations on the job system workers, such as command buffer re-recording and capture encodes, are not checked.
+//A long run with --headless --frames=N --strict-allocations asserts zero allocations per frame.
+//
+//  --strict-allocations  fail when a steady-state frame allocates from the heap
+//  --alloc-warmup=N      frames excluded from the check, 120 by default
+struct HostAllocatorOptions {
+	uint32_t warmupFrames = 120;
+	bool strict = false;
+};
+
+static const uint32_t HOST_ALLOCATION_SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+static const size_t HOST_ARENA_SIZE = 256 * 1024;
+
+struct HostScopeCounters {
+	std::atomic<uint64_t> allocations{ 0 };
+	std::atomic<uint64_t> reallocations{ 0 };
+	std::atomic<uint64_t> frees{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+	std::atomic<int64_t> liveBytes{ 0 };
+	std::atomic<int64_t> peakBytes{ 0 };
+};
+
+struct HostAllocator {
+	HostAllocatorOptions options;
+	VkAllocationCallbacks callbacks = {};
+
+	HostScopeCounters scopes[HOST_ALLOCATION_SCOPE_COUNT];
+	std::atomic<uint64_t> heapAllocations{ 0 };
+	std::atomic<uint64_t> arenaAllocations{ 0 };
+	std::atomic<uint64_t> arenaOverflows{ 0 }; //command scope allocations that did not fit in the arena
+	std::atomic<uint64_t> internalAllocations{ 0 };
+
+	//Steady-state check, only touched by the thread calling drawFrame
+	uint64_t frames = 0;
+	uint64_t steadyStateFrames = 0;
+	uint64_t steadyStateHeapAllocations = 0;
+	uint64_t steadyStateNewAllocations = 0;
+	uint64_t violations = 0;
+};
+
+HostAllocatorOptions parseHostAllocatorOptions(int argc, char *argv[]);
+
+//Installs the callbacks returned by vulkanAllocator(), must run before the instance is created
+//and the allocator must outlive the instance
+void createHostAllocator(HostAllocator *allocator, const HostAllocatorOptions &options);
+//Callbacks to pass as pAllocator to every vkCreate*/vkDestroy*, nullptr before createHostAllocator
+const VkAllocationCallbacks *vulkanAllocator();
+
+//Heap allocations made by the calling thread so far: Vulkan host allocations that missed the arenas,
+//and operator new, replaced program-wide to count them
+struct ThreadAllocations {
+	uint64_t vulkan = 0;
+	uint64_t operatorNew = 0;
+};
+
+ThreadAllocations threadAllocations();
+//Call at the end of a frame with the calling thread's counts from the start of the frame.
+//Frames that recreated the swap chain are expected to allocate and are not checked.
+void checkFrameAllocations(HostAllocator *allocator, const ThreadAllocations &before, bool swapChainRecreated);
+//Per scope totals, call after the instance is destroyed to also report leaked bytes
+void printHostAllocationReport(const HostAllocator &allocator);
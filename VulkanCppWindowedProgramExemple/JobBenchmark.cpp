@@ -0,0 +1,132 @@
+#include "JobBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static double elapsedMs(BenchmarkClock::time_point start) {
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+//Fixed amount of integer work the compiler cannot drop
+static uint64_t busyWork(uint64_t seed, uint32_t iterations) {
+	uint64_t x = seed | 1;
+	for (uint32_t i = 0; i < iterations; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+	}
+	return x;
+}
+
+struct JobBenchmarkResult {
+	double spawnNs;
+	double roundTripUs;
+	double stolenPercent;
+	double workloadMs;
+};
+
+static JobBenchmarkResult benchmarkWorkers(uint32_t workers, bool pinWorkers) {
+
+	const uint32_t spawnCount = 100000;
+	const uint32_t roundTrips = 10000;
+	const uint32_t fanOut = 4000;
+	const uint32_t workloadJobs = 512;
+	const uint32_t workloadIterations = 200000;
+
+	JobSystem system;
+	startJobSystem(&system, workers, pinWorkers);
+
+	JobBenchmarkResult result = {};
+
+	//Spawn overhead: empty jobs submitted from a non-worker thread, including the final wait
+	{
+		JobCounter counter;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < spawnCount; i++) {
+			spawnJob(&system, &counter, []() {});
+		}
+		waitForCounter(&system, &counter);
+		result.spawnNs = elapsedMs(start) * 1.0e6 / spawnCount;
+	}
+
+	//Wait overhead: one empty job and a wait on it, back to back
+	{
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < roundTrips; i++) {
+			JobCounter counter;
+			spawnJob(&system, &counter, []() {});
+			waitForCounter(&system, &counter);
+		}
+		result.roundTripUs = elapsedMs(start) * 1.0e3 / roundTrips;
+	}
+
+	//Steal: a single job fans out onto its own worker deque, every other thread has to steal
+	{
+		uint64_t stolenBefore = system.externalStolen.load();
+		for (auto &worker : system.workers) {
+			stolenBefore += worker->stolen.load();
+		}
+
+		std::atomic<uint64_t> sink(0);
+		JobCounter root;
+		JobCounter children;
+		spawnJob(&system, &root, [&system, &children, &sink]() {
+			for (uint32_t i = 0; i < fanOut; i++) {
+				spawnJob(&system, &children, [&sink, i]() { sink.fetch_xor(busyWork(i, 2000), std::memory_order_relaxed); });
+			}
+		});
+		waitForCounter(&system, &root);
+		waitForCounter(&system, &children);
+
+		uint64_t stolen = system.externalStolen.load();
+		for (auto &worker : system.workers) {
+			stolen += worker->stolen.load();
+		}
+		result.stolenPercent = 100.0 * (stolen - stolenBefore) / fanOut;
+	}
+
+	//Scaling: same total work for every worker count
+	{
+		std::atomic<uint64_t> sink(0);
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		parallelFor(&system, workloadJobs, 1, [&sink](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				sink.fetch_xor(busyWork(i, workloadIterations), std::memory_order_relaxed);
+			}
+		});
+		result.workloadMs = elapsedMs(start);
+	}
+
+	stopJobSystem(&system);
+	return result;
+}
+
+void runJobBenchmarks(uint32_t maxWorkers, bool pinWorkers) {
+
+	if (maxWorkers == 0) {
+		//hardware_concurrency is 0 when unknown
+		maxWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	std::cout << "Job system benchmark, 1 to " << maxWorkers << " workers" << (pinWorkers ? " (pinned)" : "")
+		<< ", the waiting thread also runs jobs" << std::endl;
+	std::cout << std::setw(8) << "workers" << std::setw(14) << "spawn ns/job" << std::setw(16) << "spawn+wait us"
+		<< std::setw(12) << "stolen %" << std::setw(14) << "workload ms" << std::setw(10) << "speedup" << std::endl;
+
+	double baseline = 0.0;
+	std::cout << std::fixed << std::setprecision(2);
+	for (uint32_t workers = 1; workers <= maxWorkers; workers++) {
+		JobBenchmarkResult result = benchmarkWorkers(workers, pinWorkers);
+		if (workers == 1) {
+			baseline = result.workloadMs;
+		}
+
+		std::cout << std::setw(8) << workers << std::setw(14) << result.spawnNs << std::setw(16) << result.roundTripUs
+			<< std::setw(12) << result.stolenPercent << std::setw(14) << result.workloadMs
+			<< std::setw(10) << (result.workloadMs > 0.0 ? baseline / result.workloadMs : 0.0) << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "JobSystem.h"
+
+//Microbenchmarks of the job system for 1 to maxWorkers workers (0 for one per core minus the caller):
+//spawn + run cost of empty jobs, spawn-and-wait round trip, steal rate of a fan-out from one worker,
+//and speedup of a fixed CPU workload
+void runJobBenchmarks(uint32_t maxWorkers, bool pinWorkers);
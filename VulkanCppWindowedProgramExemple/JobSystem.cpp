@@ -0,0 +1,349 @@
+#include "JobSystem.h"
+#include "CommandLine.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//Jobs come from a per-thread ring, a slot is reused once the job that last used it has run
+static const size_t JOB_POOL_SIZE = 4096;
+
+static thread_local JobWorker *currentWorker = nullptr;
+static thread_local std::unique_ptr<Job[]> jobPool;
+static thread_local size_t jobPoolNext = 0;
+static thread_local uint32_t stealSeed = 0;
+
+bool WorkStealingDeque::push(Job *job) {
+
+	int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	int64_t top = top_.load(std::memory_order_acquire);
+	if (bottom - top >= CAPACITY) {
+		return false;
+	}
+
+	buffer_[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom_.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job *WorkStealingDeque::pop() {
+
+	int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = top_.load(std::memory_order_relaxed);
+
+	if (top > bottom) {
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job *job = buffer_[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (top == bottom) {
+		//Last job, race the thieves for it
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job *WorkStealingDeque::steal() {
+
+	int64_t top = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+	if (top >= bottom) {
+		return nullptr;
+	}
+
+	Job *job = buffer_[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return job;
+}
+
+JobSystemOptions parseJobSystemOptions(int argc, char *argv[]) {
+
+	JobSystemOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--job-workers", &value)) {
+			options.workerCount = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchFlag(arg, "--pin-workers")) {
+			options.pinWorkers = true;
+		}
+		else if (matchFlag(arg, "--bench-jobs")) {
+			options.benchmark = true;
+		}
+	}
+
+	return options;
+}
+
+static void pinThread(std::thread &thread, uint32_t core) {
+#if defined(_WIN32)
+	SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+	(void)thread;
+	(void)core;
+#endif
+}
+
+static void pushJob(JobSystem *system, Job *job) {
+
+	if (currentWorker == nullptr || currentWorker->system != system || !currentWorker->deque.push(job)) {
+		std::lock_guard<std::mutex> lock(system->injectMutex);
+		system->injected.push_back(job);
+		system->injectedCount.fetch_add(1, std::memory_order_release);
+	}
+
+	//A worker that counted itself sleeping after this bump sees it under the mutex and does not wait,
+	//one that counted itself before is notified: the mutex keeps the notify out of the gap before its wait
+	system->workEpoch.fetch_add(1, std::memory_order_seq_cst);
+	if (system->sleeping.load(std::memory_order_seq_cst) > 0) {
+		std::lock_guard<std::mutex> lock(system->sleepMutex);
+		system->wake.notify_one();
+	}
+}
+
+static void finishJob(JobSystem *system, Job *job) {
+
+	JobCounter *counter = job->counter;
+	job->task = nullptr;
+	job->busy.store(false, std::memory_order_release);
+
+	if (counter == nullptr) {
+		return;
+	}
+
+	//finishing keeps the waiter from returning (and the counter from going away) until the continuations are out
+	counter->finishing.fetch_add(1, std::memory_order_seq_cst);
+	if (counter->pending.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+		std::vector<Job*> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			continuations.swap(counter->continuations);
+		}
+		for (Job *continuation : continuations) {
+			pushJob(system, continuation);
+		}
+	}
+	counter->finishing.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+static void runJob(JobSystem *system, Job *job) {
+
+	try {
+		job->task();
+	}
+	catch (...) {
+		if (job->counter != nullptr) {
+			std::lock_guard<std::mutex> lock(job->counter->mutex);
+			if (!job->counter->error) {
+				job->counter->error = std::current_exception();
+			}
+		}
+	}
+	finishJob(system, job);
+}
+
+bool runOneJob(JobSystem *system) {
+
+	JobWorker *worker = (currentWorker != nullptr && currentWorker->system == system) ? currentWorker : nullptr;
+
+	Job *job = worker != nullptr ? worker->deque.pop() : nullptr;
+	bool stolen = false;
+
+	if (job == nullptr && system->injectedCount.load(std::memory_order_acquire) > 0) {
+		std::lock_guard<std::mutex> lock(system->injectMutex);
+		if (!system->injected.empty()) {
+			job = system->injected.front();
+			system->injected.pop_front();
+			system->injectedCount.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	if (job == nullptr && !system->workers.empty()) {
+		//Start at a random victim so thieves spread over the workers
+		stealSeed = stealSeed * 1664525u + 1013904223u;
+		size_t workerCount = system->workers.size();
+		size_t start = (stealSeed >> 16) % workerCount;
+		for (size_t i = 0; i < workerCount && job == nullptr; i++) {
+			JobWorker *victim = system->workers[(start + i) % workerCount].get();
+			if (victim != worker) {
+				job = victim->deque.steal();
+			}
+		}
+		stolen = job != nullptr;
+	}
+
+	if (job == nullptr) {
+		return false;
+	}
+
+	runJob(system, job);
+	if (worker != nullptr) {
+		worker->executed.fetch_add(1, std::memory_order_relaxed);
+		if (stolen) {
+			worker->stolen.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	else if (stolen) {
+		system->externalStolen.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+static void workerMain(JobSystem *system, JobWorker *worker) {
+
+	currentWorker = worker;
+	stealSeed = worker->index * 2654435761u + 1;
+
+	while (system->running.load(std::memory_order_acquire)) {
+
+		//Read before searching, a push the search missed has changed it
+		uint64_t epoch = system->workEpoch.load(std::memory_order_seq_cst);
+		if (runOneJob(system)) {
+			continue;
+		}
+
+		//Sleep until new work is pushed
+		system->sleeping.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock<std::mutex> lock(system->sleepMutex);
+			system->wake.wait(lock, [system, epoch]() {
+				return !system->running.load(std::memory_order_acquire) || system->workEpoch.load(std::memory_order_seq_cst) != epoch;
+			});
+		}
+		system->sleeping.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	currentWorker = nullptr;
+}
+
+void startJobSystem(JobSystem *system, uint32_t workerCount, bool pinWorkers) {
+
+	uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+	if (workerCount == 0) {
+		workerCount = std::max(1u, cores - 1);
+	}
+
+	system->running.store(true, std::memory_order_release);
+	system->workers.clear();
+	for (uint32_t i = 0; i < workerCount; i++) {
+		std::unique_ptr<JobWorker> worker(new JobWorker());
+		worker->system = system;
+		worker->index = i;
+		system->workers.push_back(std::move(worker));
+	}
+
+	//Deques exist before any worker can try to steal from them
+	for (uint32_t i = 0; i < workerCount; i++) {
+		JobWorker *worker = system->workers[i].get();
+		worker->thread = std::thread(workerMain, system, worker);
+		if (pinWorkers) {
+			pinThread(worker->thread, (i + 1) % cores);
+		}
+	}
+}
+
+void stopJobSystem(JobSystem *system) {
+
+	{
+		std::lock_guard<std::mutex> lock(system->sleepMutex);
+		system->running.store(false, std::memory_order_release);
+	}
+	system->wake.notify_all();
+
+	for (auto &worker : system->workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+	system->workers.clear();
+}
+
+void spawnJob(JobSystem *system, JobCounter *counter, std::function<void()> task, JobCounter *dependency) {
+
+	if (!jobPool) {
+		jobPool.reset(new Job[JOB_POOL_SIZE]);
+	}
+
+	//Oldest slot of the ring still running: help until it is free
+	Job *job = &jobPool[jobPoolNext];
+	while (job->busy.load(std::memory_order_acquire)) {
+		if (!runOneJob(system)) {
+			std::this_thread::yield();
+		}
+	}
+	jobPoolNext = (jobPoolNext + 1) % JOB_POOL_SIZE;
+
+	job->busy.store(true, std::memory_order_relaxed);
+	job->task = std::move(task);
+	job->counter = counter;
+	if (counter != nullptr) {
+		counter->pending.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	if (dependency != nullptr) {
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->pending.load(std::memory_order_seq_cst) > 0) {
+			dependency->continuations.push_back(job);
+			return;
+		}
+	}
+
+	pushJob(system, job);
+}
+
+void waitForCounter(JobSystem *system, JobCounter *counter) {
+
+	while (counter->pending.load(std::memory_order_seq_cst) > 0 || counter->finishing.load(std::memory_order_seq_cst) > 0) {
+		if (!runOneJob(system)) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		error = counter->error;
+		counter->error = nullptr;
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void parallelFor(JobSystem *system, uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)> &body) {
+
+	grain = std::max(1u, grain);
+
+	JobCounter counter;
+	for (uint32_t begin = 0; begin < count; begin += grain) {
+		uint32_t end = std::min(count, begin + grain);
+		spawnJob(system, &counter, [&body, begin, end]() { body(begin, end); });
+	}
+	waitForCounter(system, &counter);
+}
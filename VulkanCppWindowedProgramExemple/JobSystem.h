@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+//Completion counter: one per spawned job, released when the job has run.
+//Jobs spawned with a dependency are held back until the dependency counter reaches zero.
+//A counter must outlive its jobs, waitForCounter guarantees it for the waiting scope.
+struct JobCounter {
+	std::atomic<uint32_t> pending{ 0 };
+	std::atomic<uint32_t> finishing{ 0 };
+	std::mutex mutex;
+	std::vector<Job*> continuations;
+	std::exception_ptr error;
+};
+
+struct Job {
+	std::function<void()> task;
+	JobCounter *counter = nullptr;
+	std::atomic<bool> busy{ false };
+};
+
+//Chase-Lev deque: the owning worker pushes and pops at the bottom, other threads steal from the top
+class WorkStealingDeque {
+public:
+	static constexpr int64_t CAPACITY = 4096;
+
+	bool push(Job *job);
+	Job *pop();
+	Job *steal();
+
+private:
+	alignas(64) std::atomic<int64_t> top_{ 0 };
+	alignas(64) std::atomic<int64_t> bottom_{ 0 };
+	std::atomic<Job*> buffer_[CAPACITY];
+};
+
+struct JobSystem;
+
+struct JobWorker {
+	JobSystem *system = nullptr;
+	uint32_t index = 0;
+	WorkStealingDeque deque;
+	std::thread thread;
+	std::atomic<uint64_t> executed{ 0 };
+	std::atomic<uint64_t> stolen{ 0 };
+};
+
+//Worker threads with one deque each. Threads that are not workers (main, render thread)
+//submit through the injection queue and help run jobs while they wait on a counter.
+struct JobSystem {
+	std::vector<std::unique_ptr<JobWorker>> workers;
+	std::atomic<bool> running{ false };
+
+	std::mutex injectMutex;
+	std::deque<Job*> injected;
+	std::atomic<size_t> injectedCount{ 0 };
+
+	//Bumped by every push: a worker only sleeps while it is unchanged since its last search
+	std::atomic<uint64_t> workEpoch{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<uint32_t> sleeping{ 0 };
+
+	//Jobs taken from a worker deque by threads that are not workers
+	std::atomic<uint64_t> externalStolen{ 0 };
+};
+
+//Job system command line:
+//  --job-workers=N     worker threads, 0 for one per core minus the calling thread
+//  --pin-workers       pin worker i to core i + 1
+//  --bench-jobs        run the job system microbenchmarks and exit
+struct JobSystemOptions {
+	uint32_t workerCount = 0;
+	bool pinWorkers = false;
+	bool benchmark = false;
+};
+
+JobSystemOptions parseJobSystemOptions(int argc, char *argv[]);
+
+void startJobSystem(JobSystem *system, uint32_t workerCount, bool pinWorkers);
+void stopJobSystem(JobSystem *system);
+
+void spawnJob(JobSystem *system, JobCounter *counter, std::function<void()> task, JobCounter *dependency = nullptr);
+//Run queued jobs on the calling thread until the counter is done, rethrows the first job exception
+void waitForCounter(JobSystem *system, JobCounter *counter);
+//Split [0, count) in chunks of grain and wait for all of them
+void parallelFor(JobSystem *system, uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)> &body);
+
+//One job from the own deque, the injection queue or another worker, false if nothing was found
+bool runOneJob(JobSystem *system);
@@ -0,0 +1,107 @@
+#include "LatencyStats.h"
+#include <algorithm>
+
+static double millisecondsBetween(LatencyTracker::Clock::time_point from, LatencyTracker::Clock::time_point to) {
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+void resetLatency(LatencyTracker *tracker) {
+
+	tracker->inputPending = false;
+	tracker->inFlight.assign(LatencyTracker::SAMPLE_COUNT, LatencyTracker::InFlightInput());
+	tracker->inFlightCount = 0;
+	tracker->latenciesMs.assign(LatencyTracker::SAMPLE_COUNT, 0.0);
+	tracker->frameTimesMs.assign(LatencyTracker::SAMPLE_COUNT, 0.0);
+	tracker->latencySamples = 0;
+	tracker->frameSamples = 0;
+	tracker->lastFrame = LatencyTracker::Clock::time_point();
+}
+
+void markInput(LatencyTracker *tracker) {
+	markInput(tracker, LatencyTracker::Clock::now());
+}
+
+void markInput(LatencyTracker *tracker, LatencyTracker::Clock::time_point input) {
+
+	//Oldest unconsumed input defines the latency of the next frame
+	if (!tracker->inputPending) {
+		tracker->inputPending = true;
+		tracker->pendingInput = input;
+	}
+}
+
+void frameSubmitted(LatencyTracker *tracker, uint64_t value) {
+
+	LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+
+	if (tracker->lastFrame != LatencyTracker::Clock::time_point()) {
+		tracker->frameTimesMs[tracker->frameSamples % LatencyTracker::SAMPLE_COUNT] = millisecondsBetween(tracker->lastFrame, now);
+		tracker->frameSamples++;
+	}
+	tracker->lastFrame = now;
+
+	if (tracker->inputPending && tracker->inFlightCount < tracker->inFlight.size()) {
+		tracker->inFlight[tracker->inFlightCount++] = { value, tracker->pendingInput };
+		tracker->inputPending = false;
+	}
+}
+
+void framesCompleted(LatencyTracker *tracker, uint64_t completedValue) {
+
+	if (tracker->inFlightCount == 0) {
+		return;
+	}
+
+	LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+
+	size_t remaining = 0;
+	for (size_t i = 0; i < tracker->inFlightCount; i++) {
+		const LatencyTracker::InFlightInput &input = tracker->inFlight[i];
+		if (input.value <= completedValue) {
+			tracker->latenciesMs[tracker->latencySamples % LatencyTracker::SAMPLE_COUNT] = millisecondsBetween(input.input, now);
+			tracker->latencySamples++;
+		}
+		else {
+			tracker->inFlight[remaining++] = input;
+		}
+	}
+	tracker->inFlightCount = remaining;
+}
+
+LatencySummary summarizeLatency(const LatencyTracker &tracker) {
+
+	LatencySummary summary = {};
+
+	size_t latencyCount = std::min(tracker.latencySamples, LatencyTracker::SAMPLE_COUNT);
+	if (latencyCount > 0) {
+		std::vector<double> sorted(tracker.latenciesMs.begin(), tracker.latenciesMs.begin() + latencyCount);
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (double latency : sorted) {
+			total += latency;
+		}
+		summary.samples = latencyCount;
+		summary.meanMs = total / latencyCount;
+		summary.p50Ms = sorted[latencyCount / 2];
+		summary.p99Ms = sorted[std::min(latencyCount - 1, latencyCount * 99 / 100)];
+	}
+
+	size_t frameCount = std::min(tracker.frameSamples, LatencyTracker::SAMPLE_COUNT);
+	if (frameCount > 0) {
+		std::vector<double> sorted(tracker.frameTimesMs.begin(), tracker.frameTimesMs.begin() + frameCount);
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (double frameTime : sorted) {
+			total += frameTime;
+		}
+		summary.frameRate = total > 0.0 ? 1000.0 * frameCount / total : 0.0;
+		summary.frameSamples = frameCount;
+		summary.frameMeanMs = total / frameCount;
+		summary.frameP50Ms = sorted[frameCount / 2];
+		summary.frameP99Ms = sorted[std::min(frameCount - 1, frameCount * 99 / 100)];
+	}
+
+	return summary;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Input-to-present latency: time from an input event being read to the GPU completing the first frame
+//submitted after it, the image is queued for present at that point. Samples live in fixed rings so the
+//frame loop does not allocate once the tracker is created.
+struct LatencyTracker {
+	typedef std::chrono::steady_clock Clock;
+
+	static constexpr size_t SAMPLE_COUNT = 1024;
+
+	bool inputPending = false;
+	Clock::time_point pendingInput;
+
+	struct InFlightInput {
+		uint64_t value;
+		Clock::time_point input;
+	};
+	std::vector<InFlightInput> inFlight;
+	size_t inFlightCount = 0;
+
+	std::vector<double> latenciesMs;
+	std::vector<double> frameTimesMs;
+	size_t latencySamples = 0;
+	size_t frameSamples = 0;
+	Clock::time_point lastFrame;
+};
+
+struct LatencySummary {
+	size_t samples;
+	double meanMs;
+	double p50Ms;
+	double p99Ms;
+	double frameRate;
+	//Present to present intervals over the last SAMPLE_COUNT frames
+	size_t frameSamples;
+	double frameMeanMs;
+	double frameP50Ms;
+	double frameP99Ms;
+};
+
+void resetLatency(LatencyTracker *tracker);
+void markInput(LatencyTracker *tracker);
+void markInput(LatencyTracker *tracker, LatencyTracker::Clock::time_point input);
+//Attach the pending input (if any) to the submission signaling value
+void frameSubmitted(LatencyTracker *tracker, uint64_t value);
+void framesCompleted(LatencyTracker *tracker, uint64_t completedValue);
+LatencySummary summarizeLatency(const LatencyTracker &tracker);
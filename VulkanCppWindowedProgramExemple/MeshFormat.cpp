@@ -0,0 +1,349 @@
+#include "MeshFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint64_t SECTION_ALIGNMENT = 16;
+
+static uint64_t alignSection(uint64_t offset) {
+	return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+//Round to nearest even, overflow to infinity, small values to half subnormals
+static uint16_t floatToHalf(float value) {
+
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (floatExponent == 0xFF) {
+		return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+	if (exponent >= 31) {
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) {
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	//A carry out of the mantissa bumps the exponent, which is the correct rounding
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+		half++;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+static float halfToFloat(uint16_t half) {
+
+	uint32_t exponent = (half >> 10) & 0x1F;
+	float mantissa = static_cast<float>(half & 0x3FF);
+	float value;
+	if (exponent == 0) {
+		value = std::ldexp(mantissa, -24);
+	}
+	else if (exponent == 31) {
+		value = INFINITY;
+	}
+	else {
+		value = std::ldexp(mantissa + 1024.0f, static_cast<int>(exponent) - 25);
+	}
+	return (half & 0x8000) ? -value : value;
+}
+
+static int16_t toSnorm16(float value) {
+	return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+static uint8_t toUnorm8(float value) {
+	return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+//The unit normal projected on the octahedron |x|+|y|+|z| = 1, the lower half folded over the upper one
+static void encodeOctahedral(const float normal[3], int16_t out[2]) {
+
+	float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	float x = sum > 0.0f ? normal[0] / sum : 0.0f;
+	float y = sum > 0.0f ? normal[1] / sum : 0.0f;
+	if (normal[2] < 0.0f) {
+		float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	out[0] = toSnorm16(x);
+	out[1] = toSnorm16(y);
+}
+
+//Same decoding as mesh.vert
+static void decodeOctahedral(const int16_t encoded[2], float normal[3]) {
+
+	float x = std::max(encoded[0] / 32767.0f, -1.0f);
+	float y = std::max(encoded[1] / 32767.0f, -1.0f);
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+	float length = std::sqrt(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+PackedMesh packMesh(const ImportedMesh &mesh, QuantizationError *error) {
+
+	if (mesh.vertices.empty()) {
+		throw std::runtime_error("failed to pack an empty mesh!");
+	}
+
+	//Half floats are most precise near zero: the bounding box is centered and scaled into [-1, 1]
+	float minimum[3], maximum[3];
+	for (int c = 0; c < 3; c++) {
+		minimum[c] = maximum[c] = mesh.vertices[0].position[c];
+	}
+	for (const MeshVertex &vertex : mesh.vertices) {
+		for (int c = 0; c < 3; c++) {
+			minimum[c] = std::min(minimum[c], vertex.position[c]);
+			maximum[c] = std::max(maximum[c], vertex.position[c]);
+		}
+	}
+
+	PackedMesh packed;
+	MeshFileHeader &header = packed.header;
+	std::memset(&header, 0, sizeof(header));
+	header.extent = 0.0f;
+	for (int c = 0; c < 3; c++) {
+		header.center[c] = (minimum[c] + maximum[c]) * 0.5f;
+		header.extent = std::max(header.extent, (maximum[c] - minimum[c]) * 0.5f);
+	}
+	if (header.extent <= 0.0f) {
+		header.extent = 1.0f;
+	}
+
+	QuantizationError worst = {};
+	float worstNormalCosine = 1.0f;
+	packed.vertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const MeshVertex &source = mesh.vertices[i];
+		PackedVertex &vertex = packed.vertices[i];
+
+		for (int c = 0; c < 3; c++) {
+			vertex.position[c] = floatToHalf((source.position[c] - header.center[c]) / header.extent);
+			float restored = halfToFloat(vertex.position[c]) * header.extent + header.center[c];
+			worst.position = std::max(worst.position, std::fabs(restored - source.position[c]));
+		}
+		vertex.position[3] = floatToHalf(1.0f);
+
+		encodeOctahedral(source.normal, vertex.normal);
+		float restored[3];
+		decodeOctahedral(vertex.normal, restored);
+		worstNormalCosine = std::min(worstNormalCosine, restored[0] * source.normal[0] + restored[1] * source.normal[1] + restored[2] * source.normal[2]);
+
+		for (int c = 0; c < 4; c++) {
+			vertex.color[c] = toUnorm8(source.color[c]);
+		}
+	}
+	worst.normalDegrees = std::acos(std::min(std::max(worstNormalCosine, -1.0f), 1.0f)) * 57.2957795f;
+
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = static_cast<uint32_t>(packed.vertices.size());
+	header.vertexStride = sizeof(PackedVertex);
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.indexSize = packed.vertices.size() <= 65536 ? 2 : 4;
+	header.vertexOffset = alignSection(sizeof(MeshFileHeader));
+	header.indexOffset = alignSection(header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride);
+
+	packed.indices.resize(size_t(header.indexCount) * header.indexSize);
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+		if (header.indexSize == 2) {
+			uint16_t index = static_cast<uint16_t>(mesh.indices[i]);
+			std::memcpy(&packed.indices[i * 2], &index, 2);
+		}
+		else {
+			std::memcpy(&packed.indices[i * 4], &mesh.indices[i], 4);
+		}
+	}
+
+	if (error != nullptr) {
+		*error = worst;
+	}
+	return packed;
+}
+
+void writeMeshFile(const std::string &path, const PackedMesh &mesh) {
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + path + " for writing!");
+	}
+
+	const char padding[SECTION_ALIGNMENT] = {};
+	const MeshFileHeader &header = mesh.header;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+	file.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(mesh.vertices.size() * sizeof(PackedVertex)));
+	file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - mesh.vertices.size() * sizeof(PackedVertex)));
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size()));
+
+	if (!file.good()) {
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+}
+
+static void validateMeshFile(const std::string &path, MappedMeshFile *file) {
+
+	if (file->size < sizeof(MeshFileHeader)) {
+		throw std::runtime_error("mesh file too short: " + path);
+	}
+	const MeshFileHeader *header = reinterpret_cast<const MeshFileHeader*>(file->data);
+	if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION) {
+		throw std::runtime_error("not a version " + std::to_string(MESH_FILE_VERSION) + " mesh file: " + path);
+	}
+	if (header->vertexStride != sizeof(PackedVertex) || (header->indexSize != 2 && header->indexSize != 4)
+		|| header->indexCount % 3 != 0 || header->vertexCount == 0 || header->indexCount == 0) {
+		throw std::runtime_error("invalid mesh file header: " + path);
+	}
+
+	//The offsets come from the file: compared against what is left, never added, so none can wrap around
+	uint64_t size = file->size;
+	uint64_t vertexBytes = uint64_t(header->vertexCount) * header->vertexStride;
+	uint64_t indexBytes = uint64_t(header->indexCount) * header->indexSize;
+	if (header->vertexOffset % SECTION_ALIGNMENT != 0 || header->indexOffset % SECTION_ALIGNMENT != 0
+		|| header->vertexOffset < sizeof(MeshFileHeader) || header->indexOffset < header->vertexOffset
+		|| header->indexOffset - header->vertexOffset < vertexBytes
+		|| header->indexOffset > size || indexBytes > size - header->indexOffset) {
+		throw std::runtime_error("mesh file sections out of bounds: " + path);
+	}
+
+	//Once here, so the GPU never reads a vertex past the buffer: the sections are used as they are
+	const uint8_t *indices = file->data + header->indexOffset;
+	uint32_t largest = 0;
+	if (header->indexSize == 2) {
+		const uint16_t *index = reinterpret_cast<const uint16_t*>(indices);
+		for (uint32_t i = 0; i < header->indexCount; i++) {
+			largest = std::max<uint32_t>(largest, index[i]);
+		}
+	}
+	else {
+		const uint32_t *index = reinterpret_cast<const uint32_t*>(indices);
+		for (uint32_t i = 0; i < header->indexCount; i++) {
+			largest = std::max(largest, index[i]);
+		}
+	}
+	if (largest >= header->vertexCount) {
+		throw std::runtime_error("mesh file index " + std::to_string(largest) + " past the " + std::to_string(header->vertexCount) + " vertices: " + path);
+	}
+
+	file->header = header;
+	file->vertices = file->data + header->vertexOffset;
+	file->indices = indices;
+}
+
+void mapMeshFile(const std::string &path, MappedMeshFile *file) {
+
+#if defined(_WIN32)
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open file!");
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(fileHandle, &size);
+	HANDLE mappingHandle = size.QuadPart > 0 ? CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	void *data = mappingHandle != nullptr ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (data == nullptr) {
+		if (mappingHandle != nullptr) {
+			CloseHandle(mappingHandle);
+		}
+		CloseHandle(fileHandle);
+		throw std::runtime_error("failed to map mesh file!");
+	}
+	file->fileHandle = fileHandle;
+	file->mappingHandle = mappingHandle;
+	file->size = static_cast<size_t>(size.QuadPart);
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("failed to open file!");
+	}
+	struct stat status;
+	void *data = MAP_FAILED;
+	if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+		data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	}
+	//The mapping keeps the file alive
+	close(descriptor);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("failed to map mesh file!");
+	}
+	file->size = static_cast<size_t>(status.st_size);
+#endif
+	file->data = static_cast<const uint8_t*>(data);
+
+	try {
+		validateMeshFile(path, file);
+	}
+	catch (...) {
+		unmapMeshFile(file);
+		throw;
+	}
+}
+
+void unmapMeshFile(MappedMeshFile *file) {
+
+	if (file->data == nullptr) {
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(file->data);
+	CloseHandle(static_cast<HANDLE>(file->mappingHandle));
+	CloseHandle(static_cast<HANDLE>(file->fileHandle));
+#else
+	munmap(const_cast<uint8_t*>(file->data), file->size);
+#endif
+	*file = MappedMeshFile();
+}
+
+void meshVertexInput(std::vector<VkVertexInputBindingDescription> *bindings, std::vector<VkVertexInputAttributeDescription> *attributes) {
+
+	VkVertexInputBindingDescription binding = {};
+	binding.binding = 0;
+	binding.stride = sizeof(PackedVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	bindings->assign(1, binding);
+
+	//Formats with mandatory vertex buffer support
+	attributes->resize(3);
+	(*attributes)[0] = { 0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, static_cast<uint32_t>(offsetof(PackedVertex, position)) };
+	(*attributes)[1] = { 1, 0, VK_FORMAT_R16G16_SNORM, static_cast<uint32_t>(offsetof(PackedVertex, normal)) };
+	(*attributes)[2] = { 2, 0, VK_FORMAT_R8G8B8A8_UNORM, static_cast<uint32_t>(offsetof(PackedVertex, color)) };
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshImport.h"
+
+//Quantized vertex, 16 bytes instead of the 40 of MeshVertex:
+//  position  half float x y z in the mesh's unit cube, w = 1     R16G16B16A16_SFLOAT
+//  normal    octahedral encoding                                 R16G16_SNORM
+//  color     RGBA                                                R8G8B8A8_UNORM
+struct PackedVertex {
+	uint16_t position[4];
+	int16_t normal[2];
+	uint8_t color[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+//.vmesh file: this header, then the vertices and the indices, each at a 16 byte aligned offset.
+//Little endian, read in place from a mapping: the sections are copied to the GPU as they are.
+const uint32_t MESH_FILE_MAGIC = 0x48534D56; //"VMSH"
+const uint32_t MESH_FILE_VERSION = 1;
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t indexSize; //2 up to 65536 vertices, 4 above
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	//Unit cube positions back in the source's units: position * extent + center
+	float center[3];
+	float extent;
+	uint32_t reserved[2];
+};
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader layout is part of the file format");
+
+//A mesh in file layout, in memory
+struct PackedMesh {
+	MeshFileHeader header;
+	std::vector<PackedVertex> vertices;
+	std::vector<uint8_t> indices;
+};
+
+//Largest position and normal errors the quantization introduced
+struct QuantizationError {
+	float position; //source units
+	float normalDegrees;
+};
+
+PackedMesh packMesh(const ImportedMesh &mesh, QuantizationError *error);
+void writeMeshFile(const std::string &path, const PackedMesh &mesh);
+
+//A .vmesh mapped read only, the views point into the mapping
+struct MappedMeshFile {
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	const MeshFileHeader *header = nullptr;
+	const void *vertices = nullptr;
+	const void *indices = nullptr;
+	void *fileHandle = nullptr; //Windows file and mapping handles
+	void *mappingHandle = nullptr;
+};
+
+//Throws when the file is missing, too short, its header or sections are invalid or an index is past the vertices
+void mapMeshFile(const std::string &path, MappedMeshFile *file);
+void unmapMeshFile(MappedMeshFile *file);
+
+//Binding 0 and locations 0 to 2 of shaders/mesh.vert for PackedVertex
+void meshVertexInput(std::vector<VkVertexInputBindingDescription> *bindings, std::vector<VkVertexInputAttributeDescription> *attributes);
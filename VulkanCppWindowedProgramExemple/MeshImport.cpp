@@ -0,0 +1,714 @@
+#include "MeshImport.h"
+#include "ShaderFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+static const float DEFAULT_COLOR[4] = { 0.8f, 0.8f, 0.8f, 1.0f };
+
+static std::string fileExtension(const std::string &path) {
+
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) {
+		return std::string();
+	}
+	std::string extension = path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+	return extension;
+}
+
+static std::string parentDirectory(const std::string &path) {
+
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+//Area weighted: the cross product of two edges is twice the triangle's area. Only the vertices the
+//importers left at (0,0,0) get one, the normals of the file are kept where it has some
+static void generateNormals(ImportedMesh *mesh) {
+
+	std::vector<bool> missing(mesh->vertices.size());
+	for (size_t i = 0; i < mesh->vertices.size(); i++) {
+		const float *normal = mesh->vertices[i].normal;
+		missing[i] = normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f;
+	}
+
+	for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+		MeshVertex *corners[3] = { &mesh->vertices[mesh->indices[i]], &mesh->vertices[mesh->indices[i + 1]], &mesh->vertices[mesh->indices[i + 2]] };
+		float e1[3], e2[3];
+		for (int c = 0; c < 3; c++) {
+			e1[c] = corners[1]->position[c] - corners[0]->position[c];
+			e2[c] = corners[2]->position[c] - corners[0]->position[c];
+		}
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		for (int k = 0; k < 3; k++) {
+			if (!missing[mesh->indices[i + k]]) {
+				continue;
+			}
+			for (int c = 0; c < 3; c++) {
+				corners[k]->normal[c] += n[c];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < mesh->vertices.size(); i++) {
+		if (!missing[i]) {
+			continue;
+		}
+		MeshVertex &vertex = mesh->vertices[i];
+		float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+		if (length > 0.0f) {
+			for (int c = 0; c < 3; c++) {
+				vertex.normal[c] /= length;
+			}
+		}
+		else {
+			vertex.normal[0] = 0.0f;
+			vertex.normal[1] = 0.0f;
+			vertex.normal[2] = 1.0f;
+		}
+	}
+	mesh->hasNormals = true;
+}
+
+//OBJ
+
+//1-based, negative counts back from the last element read so far
+static bool resolveObjIndex(long index, size_t count, size_t *resolved) {
+
+	if (index > 0 && static_cast<size_t>(index) <= count) {
+		*resolved = static_cast<size_t>(index - 1);
+		return true;
+	}
+	if (index < 0 && static_cast<size_t>(-index) <= count) {
+		*resolved = count - static_cast<size_t>(-index);
+		return true;
+	}
+	return false;
+}
+
+static ImportedMesh importObj(const std::string &path) {
+
+	std::vector<char> text = readfile(path);
+	text.push_back('\0');
+
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> normals;
+	bool hasColors = false;
+	bool missingNormals = false;
+
+	ImportedMesh mesh;
+	//Position and normal index pair to vertex: faces share corners
+	std::unordered_map<uint64_t, uint32_t> corners;
+	std::vector<uint32_t> face;
+
+	char *cursor = text.data();
+	char *end = text.data() + text.size() - 1;
+	while (cursor < end) {
+		char *lineEnd = cursor;
+		while (lineEnd < end && *lineEnd != '\n') {
+			lineEnd++;
+		}
+		*lineEnd = '\0';
+		char *line = cursor;
+		cursor = lineEnd + 1;
+
+		while (*line == ' ' || *line == '\t') {
+			line++;
+		}
+
+		if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+			char *next = line + 2;
+			float values[6];
+			int count = 0;
+			while (count < 6) {
+				char *parsed;
+				float value = strtof(next, &parsed);
+				if (parsed == next) {
+					break;
+				}
+				values[count++] = value;
+				next = parsed;
+			}
+			if (count < 3) {
+				throw std::runtime_error("invalid OBJ vertex in " + path);
+			}
+			positions.insert(positions.end(), values, values + 3);
+			if (count == 6) {
+				colors.insert(colors.end(), values + 3, values + 6);
+				hasColors = true;
+			}
+			else {
+				colors.insert(colors.end(), DEFAULT_COLOR, DEFAULT_COLOR + 3);
+			}
+		}
+		else if (line[0] == 'v' && line[1] == 'n') {
+			char *next = line + 2;
+			for (int c = 0; c < 3; c++) {
+				normals.push_back(strtof(next, &next));
+			}
+		}
+		else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+			face.clear();
+			char *next = line + 1;
+			while (true) {
+				char *parsed;
+				long positionIndex = strtol(next, &parsed, 10);
+				if (parsed == next) {
+					break;
+				}
+				next = parsed;
+
+				//v, v/t, v//n or v/t/n; texture coordinates are not used
+				long normalIndex = 0;
+				if (*next == '/') {
+					next++;
+					if (*next != '/') {
+						strtol(next, &next, 10);
+					}
+					if (*next == '/') {
+						next++;
+						normalIndex = strtol(next, &next, 10);
+					}
+				}
+
+				size_t position;
+				if (!resolveObjIndex(positionIndex, positions.size() / 3, &position)) {
+					throw std::runtime_error("OBJ face index out of range in " + path);
+				}
+				size_t normal = 0;
+				bool hasNormal = normalIndex != 0 && resolveObjIndex(normalIndex, normals.size() / 3, &normal);
+				missingNormals = missingNormals || !hasNormal;
+
+				uint64_t key = (uint64_t(position) << 32) | (hasNormal ? normal + 1 : 0);
+				auto found = corners.find(key);
+				if (found == corners.end()) {
+					MeshVertex vertex;
+					std::memcpy(vertex.position, &positions[position * 3], sizeof(vertex.position));
+					std::memcpy(vertex.color, &colors[position * 3], 3 * sizeof(float));
+					vertex.color[3] = 1.0f;
+					if (hasNormal) {
+						std::memcpy(vertex.normal, &normals[normal * 3], sizeof(vertex.normal));
+					}
+					else {
+						vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+					}
+					found = corners.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+					mesh.vertices.push_back(vertex);
+				}
+				face.push_back(found->second);
+			}
+
+			//Convex polygons as a fan around the first corner
+			for (size_t i = 2; i < face.size(); i++) {
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i - 1]);
+				mesh.indices.push_back(face[i]);
+			}
+		}
+	}
+
+	mesh.hasColors = hasColors;
+	mesh.hasNormals = !missingNormals;
+	return mesh;
+}
+
+//glTF
+
+//Just enough JSON for glTF: no comments, numbers as double
+struct JsonValue {
+	enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+	Type type = NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+struct JsonParser {
+	const char *cursor;
+	const char *end;
+};
+
+static void skipJsonWhitespace(JsonParser *parser) {
+	while (parser->cursor < parser->end && (*parser->cursor == ' ' || *parser->cursor == '\t' || *parser->cursor == '\n' || *parser->cursor == '\r')) {
+		parser->cursor++;
+	}
+}
+
+static bool consumeJson(JsonParser *parser, char c) {
+	skipJsonWhitespace(parser);
+	if (parser->cursor < parser->end && *parser->cursor == c) {
+		parser->cursor++;
+		return true;
+	}
+	return false;
+}
+
+static void appendUtf8(std::string *out, uint32_t codePoint) {
+	if (codePoint < 0x80) {
+		out->push_back(static_cast<char>(codePoint));
+	}
+	else if (codePoint < 0x800) {
+		out->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+		out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+	}
+	else {
+		out->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+		out->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+		out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+	}
+}
+
+static std::string parseJsonString(JsonParser *parser) {
+
+	if (!consumeJson(parser, '"')) {
+		throw std::runtime_error("invalid glTF JSON: string expected");
+	}
+
+	std::string value;
+	while (parser->cursor < parser->end && *parser->cursor != '"') {
+		char c = *parser->cursor++;
+		if (c != '\\') {
+			value.push_back(c);
+			continue;
+		}
+		if (parser->cursor >= parser->end) {
+			break;
+		}
+		char escaped = *parser->cursor++;
+		switch (escaped) {
+		case 'b': value.push_back('\b'); break;
+		case 'f': value.push_back('\f'); break;
+		case 'n': value.push_back('\n'); break;
+		case 'r': value.push_back('\r'); break;
+		case 't': value.push_back('\t'); break;
+		case 'u':
+			if (parser->end - parser->cursor < 4) {
+				throw std::runtime_error("invalid glTF JSON: truncated escape");
+			}
+			appendUtf8(&value, static_cast<uint32_t>(std::strtoul(std::string(parser->cursor, 4).c_str(), nullptr, 16)));
+			parser->cursor += 4;
+			break;
+		default: value.push_back(escaped); break;
+		}
+	}
+	if (parser->cursor >= parser->end) {
+		throw std::runtime_error("invalid glTF JSON: unterminated string");
+	}
+	parser->cursor++;
+	return value;
+}
+
+static JsonValue parseJsonValue(JsonParser *parser, int depth) {
+
+	if (depth > 64) {
+		throw std::runtime_error("invalid glTF JSON: nested too deep");
+	}
+	skipJsonWhitespace(parser);
+	if (parser->cursor >= parser->end) {
+		throw std::runtime_error("invalid glTF JSON: value expected");
+	}
+
+	JsonValue value;
+	char c = *parser->cursor;
+
+	if (c == '{') {
+		value.type = JsonValue::OBJECT;
+		parser->cursor++;
+		if (consumeJson(parser, '}')) {
+			return value;
+		}
+		do {
+			std::string name = parseJsonString(parser);
+			if (!consumeJson(parser, ':')) {
+				throw std::runtime_error("invalid glTF JSON: ':' expected");
+			}
+			value.members.emplace_back(std::move(name), parseJsonValue(parser, depth + 1));
+		} while (consumeJson(parser, ','));
+		if (!consumeJson(parser, '}')) {
+			throw std::runtime_error("invalid glTF JSON: '}' expected");
+		}
+	}
+	else if (c == '[') {
+		value.type = JsonValue::ARRAY;
+		parser->cursor++;
+		if (consumeJson(parser, ']')) {
+			return value;
+		}
+		do {
+			value.items.push_back(parseJsonValue(parser, depth + 1));
+		} while (consumeJson(parser, ','));
+		if (!consumeJson(parser, ']')) {
+			throw std::runtime_error("invalid glTF JSON: ']' expected");
+		}
+	}
+	else if (c == '"') {
+		value.type = JsonValue::STRING;
+		value.string = parseJsonString(parser);
+	}
+	else if (parser->end - parser->cursor >= 4 && std::strncmp(parser->cursor, "true", 4) == 0) {
+		value.type = JsonValue::BOOLEAN;
+		value.boolean = true;
+		parser->cursor += 4;
+	}
+	else if (parser->end - parser->cursor >= 5 && std::strncmp(parser->cursor, "false", 5) == 0) {
+		value.type = JsonValue::BOOLEAN;
+		parser->cursor += 5;
+	}
+	else if (parser->end - parser->cursor >= 4 && std::strncmp(parser->cursor, "null", 4) == 0) {
+		parser->cursor += 4;
+	}
+	else {
+		//The text is null terminated, strtod stops at the first character that is not part of the number
+		char *parsed;
+		value.type = JsonValue::NUMBER;
+		value.number = std::strtod(parser->cursor, &parsed);
+		if (parsed == parser->cursor) {
+			throw std::runtime_error("invalid glTF JSON: unexpected character");
+		}
+		parser->cursor = parsed;
+	}
+
+	return value;
+}
+
+static const JsonValue *jsonMember(const JsonValue &object, const char *name) {
+
+	for (const auto &member : object.members) {
+		if (member.first == name) {
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+static const JsonValue &requireMember(const JsonValue &object, const char *name) {
+
+	const JsonValue *member = jsonMember(object, name);
+	if (member == nullptr) {
+		throw std::runtime_error(std::string("invalid glTF: missing ") + name);
+	}
+	return *member;
+}
+
+static size_t jsonIndex(const JsonValue &value, size_t count, const char *what) {
+
+	if (value.type != JsonValue::NUMBER || value.number < 0.0 || value.number >= static_cast<double>(count)) {
+		throw std::runtime_error(std::string("invalid glTF: bad ") + what + " index");
+	}
+	return static_cast<size_t>(value.number);
+}
+
+static double jsonNumberOr(const JsonValue &object, const char *name, double fallback) {
+
+	const JsonValue *member = jsonMember(object, name);
+	return member != nullptr && member->type == JsonValue::NUMBER ? member->number : fallback;
+}
+
+static std::vector<uint8_t> decodeBase64(const std::string &text, size_t begin) {
+
+	std::vector<uint8_t> bytes;
+	bytes.reserve((text.size() - begin) * 3 / 4);
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (size_t i = begin; i < text.size(); i++) {
+		char c = text[i];
+		int value;
+		if (c >= 'A' && c <= 'Z') value = c - 'A';
+		else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') value = c - '0' + 52;
+		else if (c == '+') value = 62;
+		else if (c == '/') value = 63;
+		else if (c == '=') break;
+		else continue;
+
+		bits = (bits << 6) | static_cast<uint32_t>(value);
+		bitCount += 6;
+		if (bitCount >= 8) {
+			bitCount -= 8;
+			bytes.push_back(static_cast<uint8_t>((bits >> bitCount) & 0xFF));
+		}
+	}
+	return bytes;
+}
+
+struct GltfDocument {
+	JsonValue json;
+	std::vector<std::vector<uint8_t>> buffers;
+};
+
+static void loadGltfBuffers(GltfDocument *document, const std::string &directory, std::vector<uint8_t> *binaryChunk) {
+
+	const JsonValue *buffers = jsonMember(document->json, "buffers");
+	if (buffers == nullptr) {
+		return;
+	}
+
+	for (const JsonValue &buffer : buffers->items) {
+		const JsonValue *uri = jsonMember(buffer, "uri");
+		std::vector<uint8_t> bytes;
+
+		if (uri == nullptr) {
+			//The GLB binary chunk, only the first buffer may use it
+			if (binaryChunk == nullptr) {
+				throw std::runtime_error("invalid glTF: buffer without uri");
+			}
+			bytes = std::move(*binaryChunk);
+			binaryChunk = nullptr;
+		}
+		else if (uri->string.compare(0, 5, "data:") == 0) {
+			size_t comma = uri->string.find(";base64,");
+			if (comma == std::string::npos) {
+				throw std::runtime_error("invalid glTF: only base64 data URIs are supported");
+			}
+			bytes = decodeBase64(uri->string, comma + 8);
+		}
+		else {
+			std::vector<char> file = readfile(directory + uri->string);
+			bytes.assign(file.begin(), file.end());
+		}
+
+		if (static_cast<double>(bytes.size()) < jsonNumberOr(buffer, "byteLength", 0.0)) {
+			throw std::runtime_error("invalid glTF: buffer shorter than its byteLength");
+		}
+		document->buffers.push_back(std::move(bytes));
+	}
+}
+
+static uint32_t accessorComponents(const std::string &type) {
+
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	throw std::runtime_error("invalid glTF: unsupported accessor type " + type);
+}
+
+static uint32_t componentSize(uint32_t componentType) {
+
+	switch (componentType) {
+	case 5120: case 5121: return 1; //BYTE, UNSIGNED_BYTE
+	case 5122: case 5123: return 2; //SHORT, UNSIGNED_SHORT
+	case 5125: case 5126: return 4; //UNSIGNED_INT, FLOAT
+	default: throw std::runtime_error("invalid glTF: unsupported component type");
+	}
+}
+
+static double readComponent(const uint8_t *data, uint32_t componentType, bool normalized) {
+
+	switch (componentType) {
+	case 5120: { int8_t v; std::memcpy(&v, data, 1); return normalized ? std::max(v / 127.0, -1.0) : v; }
+	case 5121: { uint8_t v = *data; return normalized ? v / 255.0 : v; }
+	case 5122: { int16_t v; std::memcpy(&v, data, 2); return normalized ? std::max(v / 32767.0, -1.0) : v; }
+	case 5123: { uint16_t v; std::memcpy(&v, data, 2); return normalized ? v / 65535.0 : v; }
+	case 5125: { uint32_t v; std::memcpy(&v, data, 4); return v; }
+	default: { float v; std::memcpy(&v, data, 4); return v; }
+	}
+}
+
+//Element values of an accessor as doubles, returns the components per element. The index was checked by jsonIndex.
+static uint32_t readAccessor(const GltfDocument &document, size_t accessorIndex, std::vector<double> *values) {
+
+	const JsonValue &accessors = requireMember(document.json, "accessors");
+	const JsonValue &accessor = accessors.items[accessorIndex];
+
+	if (jsonMember(accessor, "sparse") != nullptr) {
+		throw std::runtime_error("invalid glTF: sparse accessors are not supported");
+	}
+
+	uint32_t components = accessorComponents(requireMember(accessor, "type").string);
+	uint32_t componentType = static_cast<uint32_t>(requireMember(accessor, "componentType").number);
+	size_t count = static_cast<size_t>(requireMember(accessor, "count").number);
+	const JsonValue *normalizedMember = jsonMember(accessor, "normalized");
+	bool normalized = normalizedMember != nullptr && normalizedMember->boolean;
+
+	values->assign(count * components, 0.0);
+	const JsonValue *viewIndex = jsonMember(accessor, "bufferView");
+	if (viewIndex == nullptr) {
+		//No data: every value is zero
+		return components;
+	}
+
+	const JsonValue &views = requireMember(document.json, "bufferViews");
+	const JsonValue &view = views.items[jsonIndex(*viewIndex, views.items.size(), "bufferView")];
+	const std::vector<uint8_t> &buffer = document.buffers[jsonIndex(requireMember(view, "buffer"), document.buffers.size(), "buffer")];
+
+	size_t elementSize = components * componentSize(componentType);
+	size_t stride = static_cast<size_t>(jsonNumberOr(view, "byteStride", 0.0));
+	if (stride == 0) {
+		stride = elementSize;
+	}
+	size_t viewOffset = static_cast<size_t>(jsonNumberOr(view, "byteOffset", 0.0));
+	size_t viewLength = static_cast<size_t>(requireMember(view, "byteLength").number);
+	size_t accessorOffset = static_cast<size_t>(jsonNumberOr(accessor, "byteOffset", 0.0));
+
+	if (count > 0 && (viewOffset + viewLength > buffer.size() || accessorOffset + (count - 1) * stride + elementSize > viewLength)) {
+		throw std::runtime_error("invalid glTF: accessor outside its buffer");
+	}
+
+	const uint8_t *base = buffer.data() + viewOffset + accessorOffset;
+	for (size_t i = 0; i < count; i++) {
+		for (uint32_t c = 0; c < components; c++) {
+			(*values)[i * components + c] = readComponent(base + i * stride + c * componentSize(componentType), componentType, normalized);
+		}
+	}
+	return components;
+}
+
+static void appendGltfPrimitive(const GltfDocument &document, const JsonValue &primitive, ImportedMesh *mesh) {
+
+	const JsonValue &attributes = requireMember(primitive, "attributes");
+	const JsonValue &accessors = requireMember(document.json, "accessors");
+
+	std::vector<double> positions;
+	if (readAccessor(document, jsonIndex(requireMember(attributes, "POSITION"), accessors.items.size(), "accessor"), &positions) != 3) {
+		throw std::runtime_error("invalid glTF: POSITION must be VEC3");
+	}
+	size_t vertexCount = positions.size() / 3;
+
+	std::vector<double> normals;
+	const JsonValue *normalIndex = jsonMember(attributes, "NORMAL");
+	if (normalIndex != nullptr && readAccessor(document, jsonIndex(*normalIndex, accessors.items.size(), "accessor"), &normals) != 3) {
+		throw std::runtime_error("invalid glTF: NORMAL must be VEC3");
+	}
+
+	std::vector<double> colors;
+	uint32_t colorComponents = 0;
+	const JsonValue *colorIndex = jsonMember(attributes, "COLOR_0");
+	if (colorIndex != nullptr) {
+		colorComponents = readAccessor(document, jsonIndex(*colorIndex, accessors.items.size(), "accessor"), &colors);
+	}
+
+	uint32_t baseVertex = static_cast<uint32_t>(mesh->vertices.size());
+	for (size_t i = 0; i < vertexCount; i++) {
+		MeshVertex vertex;
+		for (int c = 0; c < 3; c++) {
+			vertex.position[c] = static_cast<float>(positions[i * 3 + c]);
+			vertex.normal[c] = normals.empty() ? 0.0f : static_cast<float>(normals[i * 3 + c]);
+		}
+		for (int c = 0; c < 4; c++) {
+			vertex.color[c] = colorComponents > static_cast<uint32_t>(c) ? static_cast<float>(colors[i * colorComponents + c]) : DEFAULT_COLOR[c];
+		}
+		if (colorComponents == 3) {
+			vertex.color[3] = 1.0f;
+		}
+		mesh->vertices.push_back(vertex);
+	}
+
+	const JsonValue *indicesIndex = jsonMember(primitive, "indices");
+	if (indicesIndex == nullptr) {
+		for (size_t i = 0; i + 2 < vertexCount; i += 3) {
+			for (size_t c = 0; c < 3; c++) {
+				mesh->indices.push_back(baseVertex + static_cast<uint32_t>(i + c));
+			}
+		}
+	}
+	else {
+		std::vector<double> indices;
+		readAccessor(document, jsonIndex(*indicesIndex, accessors.items.size(), "accessor"), &indices);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			for (size_t c = 0; c < 3; c++) {
+				if (indices[i + c] >= static_cast<double>(vertexCount)) {
+					throw std::runtime_error("invalid glTF: index out of range");
+				}
+				mesh->indices.push_back(baseVertex + static_cast<uint32_t>(indices[i + c]));
+			}
+		}
+	}
+
+	//Every primitive so far must have had normals: generated ones are only for the vertices without
+	mesh->hasNormals = (baseVertex == 0 || mesh->hasNormals) && !normals.empty();
+	mesh->hasColors = mesh->hasColors || colorComponents != 0;
+}
+
+static uint32_t readLittleEndian32(const uint8_t *data) {
+	return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+static ImportedMesh importGltf(const std::string &path, bool binary) {
+
+	std::vector<char> file = readfile(path);
+	std::string jsonText;
+	std::vector<uint8_t> binaryChunk;
+
+	if (binary) {
+		//12 byte header, then a JSON chunk and an optional BIN chunk, each with an 8 byte header
+		const uint8_t *bytes = reinterpret_cast<const uint8_t*>(file.data());
+		if (file.size() < 20 || readLittleEndian32(bytes) != 0x46546C67 || readLittleEndian32(bytes + 4) != 2) {
+			throw std::runtime_error("not a glTF 2.0 binary file: " + path);
+		}
+		size_t offset = 12;
+		while (offset + 8 <= file.size()) {
+			uint32_t chunkLength = readLittleEndian32(bytes + offset);
+			uint32_t chunkType = readLittleEndian32(bytes + offset + 4);
+			offset += 8;
+			if (offset + chunkLength > file.size()) {
+				throw std::runtime_error("truncated glTF binary file: " + path);
+			}
+			if (chunkType == 0x4E4F534A) {
+				jsonText.assign(file.data() + offset, chunkLength);
+			}
+			else if (chunkType == 0x004E4942 && binaryChunk.empty()) {
+				binaryChunk.assign(bytes + offset, bytes + offset + chunkLength);
+			}
+			offset += chunkLength;
+		}
+	}
+	else {
+		jsonText.assign(file.begin(), file.end());
+	}
+
+	GltfDocument document;
+	JsonParser parser = { jsonText.c_str(), jsonText.c_str() + jsonText.size() };
+	document.json = parseJsonValue(&parser, 0);
+	if (document.json.type != JsonValue::OBJECT) {
+		throw std::runtime_error("invalid glTF: top level is not an object");
+	}
+	loadGltfBuffers(&document, parentDirectory(path), binary ? &binaryChunk : nullptr);
+
+	ImportedMesh mesh;
+	const JsonValue *meshes = jsonMember(document.json, "meshes");
+	if (meshes != nullptr) {
+		for (const JsonValue &gltfMesh : meshes->items) {
+			for (const JsonValue &primitive : requireMember(gltfMesh, "primitives").items) {
+				//Triangle lists only (mode 4, the default)
+				if (jsonNumberOr(primitive, "mode", 4.0) == 4.0) {
+					appendGltfPrimitive(document, primitive, &mesh);
+				}
+			}
+		}
+	}
+	return mesh;
+}
+
+ImportedMesh importMesh(const std::string &path) {
+
+	std::string extension = fileExtension(path);
+
+	ImportedMesh mesh;
+	if (extension == "obj") {
+		mesh = importObj(path);
+	}
+	else if (extension == "gltf" || extension == "glb") {
+		mesh = importGltf(path, extension == "glb");
+	}
+	else {
+		throw std::runtime_error("unsupported mesh format: " + path);
+	}
+
+	if (mesh.indices.empty()) {
+		throw std::runtime_error("no triangles in " + path);
+	}
+	if (!mesh.hasNormals) {
+		generateNormals(&mesh);
+	}
+	return mesh;
+}
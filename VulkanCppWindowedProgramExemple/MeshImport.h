@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Full precision vertex of an imported mesh, before optimization and quantization
+struct MeshVertex {
+	float position[3];
+	float normal[3];
+	float color[4];
+};
+
+//Indexed triangle list
+struct ImportedMesh {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	bool hasNormals = false;
+	bool hasColors = false;
+};
+
+//By extension:
+//  .obj         positions, normals, faces of any size (fanned), "v x y z r g b" vertex colors
+//  .gltf .glb   POSITION, NORMAL and COLOR_0 of every triangle primitive; embedded, data URI or
+//               external buffers. Node transforms and sparse accessors are not supported.
+//Missing normals are generated, smooth and area weighted, for the vertices without one only.
+//Throws on unreadable or invalid files.
+ImportedMesh importMesh(const std::string &path);
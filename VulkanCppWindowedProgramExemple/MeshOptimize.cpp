@@ -0,0 +1,198 @@
+#include "MeshOptimize.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t CACHE_SIZE = 32;
+static const uint32_t INVALID_TRIANGLE = 0xFFFFFFFF;
+
+//Recently used vertices score high, except the last triangle's (no gain in reusing them right away);
+//vertices with few triangles left score high so they leave no stranded triangles behind
+static float vertexScore(int cachePosition, uint32_t remainingTriangles) {
+
+	if (remainingTriangles == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			score = 0.75f;
+		}
+		else {
+			score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (CACHE_SIZE - 3)), 1.5f);
+		}
+	}
+	return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+void optimizeVertexCache(std::vector<uint32_t> *indices, size_t vertexCount) {
+
+	size_t triangleCount = indices->size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//Triangles of each vertex, compacted as triangles are emitted
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : *indices) {
+		remaining[index]++;
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(indices->size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (size_t c = 0; c < 3; c++) {
+			adjacency[fill[(*indices)[t * 3 + c]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScores[v] = vertexScore(-1, remaining[v]);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = 0;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++) {
+		const uint32_t *corners = &(*indices)[t * 3];
+		float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		if (score > bestScore) {
+			bestScore = score;
+			bestTriangle = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices->size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(CACHE_SIZE + 3);
+	nextCache.reserve(CACHE_SIZE + 3);
+	size_t scanCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		//Dead end, nothing in the cache has triangles left: continue with the next one in input order
+		if (bestTriangle == INVALID_TRIANGLE) {
+			while (emitted[scanCursor]) {
+				scanCursor++;
+			}
+			bestTriangle = static_cast<uint32_t>(scanCursor);
+		}
+
+		const uint32_t corners[3] = { (*indices)[bestTriangle * 3], (*indices)[bestTriangle * 3 + 1], (*indices)[bestTriangle * 3 + 2] };
+		output.insert(output.end(), corners, corners + 3);
+		emitted[bestTriangle] = true;
+
+		for (uint32_t vertex : corners) {
+			uint32_t *begin = &adjacency[adjacencyOffsets[vertex]];
+			uint32_t *end = begin + remaining[vertex];
+			uint32_t *found = std::find(begin, end, bestTriangle);
+			if (found != end) {
+				*found = *(end - 1);
+				remaining[vertex]--;
+			}
+		}
+
+		//The triangle's vertices move to the front, the least recently used fall off the end
+		nextCache.assign(corners, corners + 3);
+		for (uint32_t vertex : cache) {
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+		for (size_t i = CACHE_SIZE; i < nextCache.size(); i++) {
+			vertexScores[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+		}
+		if (nextCache.size() > CACHE_SIZE) {
+			nextCache.resize(CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); i++) {
+			vertexScores[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+		}
+
+		//Only triangles touching the cache changed score, the best of them is next
+		bestTriangle = INVALID_TRIANGLE;
+		bestScore = -1.0f;
+		for (uint32_t vertex : cache) {
+			for (uint32_t i = 0; i < remaining[vertex]; i++) {
+				uint32_t triangle = adjacency[adjacencyOffsets[vertex] + i];
+				const uint32_t *triangleCorners = &(*indices)[triangle * 3];
+				float score = vertexScores[triangleCorners[0]] + vertexScores[triangleCorners[1]] + vertexScores[triangleCorners[2]];
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices->swap(output);
+}
+
+void optimizeVertexFetch(ImportedMesh *mesh) {
+
+	const uint32_t UNUSED = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(mesh->vertices.size(), UNUSED);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh->vertices.size());
+
+	for (uint32_t &index : mesh->indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh->vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh->vertices.swap(vertices);
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t vertexStride) {
+
+	const uint32_t FIFO_SIZE = 16;
+	const uint32_t LINE_SIZE = 64;
+	const uint32_t LINE_CACHE_SIZE = 32;
+
+	VertexCacheStats stats = {};
+	if (indices.empty() || vertexCount == 0) {
+		return stats;
+	}
+
+	//Timestamps keep both caches O(1): a vertex is in the FIFO while fewer than FIFO_SIZE vertices were
+	//inserted after it; a line counts as cached while used within the last LINE_CACHE_SIZE line accesses
+	std::vector<uint64_t> vertexInserted(vertexCount, 0);
+	uint64_t vertexClock = FIFO_SIZE + 1;
+	size_t lineCount = (vertexCount * vertexStride + LINE_SIZE - 1) / LINE_SIZE;
+	std::vector<uint64_t> lineUsed(lineCount, 0);
+	uint64_t lineClock = LINE_CACHE_SIZE + 1;
+	uint64_t transformed = 0;
+
+	for (uint32_t index : indices) {
+		if (vertexClock - vertexInserted[index] <= FIFO_SIZE) {
+			continue;
+		}
+		vertexInserted[index] = vertexClock++;
+		transformed++;
+
+		//LRU: a hit refreshes the line
+		size_t firstLine = size_t(index) * vertexStride / LINE_SIZE;
+		size_t lastLine = (size_t(index) * vertexStride + vertexStride - 1) / LINE_SIZE;
+		for (size_t line = firstLine; line <= lastLine; line++) {
+			if (lineClock - lineUsed[line] > LINE_CACHE_SIZE) {
+				stats.fetchedBytes += LINE_SIZE;
+			}
+			lineUsed[line] = lineClock++;
+		}
+	}
+
+	stats.acmr = static_cast<double>(transformed) / (indices.size() / 3);
+	stats.atvr = static_cast<double>(transformed) / vertexCount;
+	stats.overfetch = static_cast<double>(stats.fetchedBytes) / (static_cast<double>(vertexCount) * vertexStride);
+	return stats;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "MeshImport.h"
+
+//Reorders triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm, 32 entry
+//LRU model): triangles reuse recently shaded vertices, the order works on any cache size
+void optimizeVertexCache(std::vector<uint32_t> *indices, size_t vertexCount);
+
+//Reorders vertices by first use in the index buffer so vertex fetches walk memory forward;
+//unreferenced vertices are dropped. Run after optimizeVertexCache.
+void optimizeVertexFetch(ImportedMesh *mesh);
+
+struct VertexCacheStats {
+	double acmr;		//shaded vertices per triangle: 3 without reuse, 0.5 at best
+	double atvr;		//shaded vertices per vertex: 1 is ideal
+	double overfetch;	//bytes fetched over bytes in the vertex buffer: 1 is ideal
+	uint64_t fetchedBytes;
+};
+
+//Simulates a 16 entry FIFO post-transform cache and, for its misses, a 64 byte line vertex fetch cache
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t vertexStride);
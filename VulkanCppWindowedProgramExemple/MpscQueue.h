@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Bounded lock-free multiple producer / single consumer ring (Vyukov's bounded queue).
+//Any thread may call tryPush, one thread only calls tryPop; Capacity must be a power of two.
+//Each cell carries a sequence number: producers claim a position with one CAS on the tail and
+//publish the value by advancing the cell's sequence, so a slow producer never blocks the others.
+template<typename T, size_t Capacity>
+class MpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+	MpscQueue() {
+		for (size_t i = 0; i < Capacity; i++) {
+			cells_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool tryPush(const T &value) {
+
+		size_t position = tail_.load(std::memory_order_relaxed);
+		while (true) {
+			Cell &cell = cells_[position & (Capacity - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (difference == 0) {
+				//Free for this lap: claim it, a failed CAS reloads the position
+				if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) {
+				//Still holds the value of the previous lap: full
+				return false;
+			}
+			else {
+				position = tail_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool tryPop(T *value) {
+
+		size_t head = head_.load(std::memory_order_relaxed);
+		Cell &cell = cells_[head & (Capacity - 1)];
+		//Claimed but not yet published reads as empty
+		if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+			return false;
+		}
+
+		*value = cell.value;
+		cell.sequence.store(head + Capacity, std::memory_order_release);
+		head_.store(head + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	//Consumer and producer indices on separate cache lines
+	alignas(64) std::atomic<size_t> head_{ 0 };
+	alignas(64) std::atomic<size_t> tail_{ 0 };
+	alignas(64) std::array<Cell, Capacity> cells_;
+};
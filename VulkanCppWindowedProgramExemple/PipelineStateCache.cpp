@@ -0,0 +1,400 @@
+#include "PipelineStateCache.h"
+#include "HostAllocator.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+template<typename T>
+static uint64_t hashValue(uint64_t hash, const T &value) {
+	return hashBytes(hash, &value, sizeof(value));
+}
+
+bool operator==(const PipelineState &a, const PipelineState &b) {
+
+	if (a.vertexBindings.size() != b.vertexBindings.size() || a.vertexAttributes.size() != b.vertexAttributes.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.vertexBindings.size(); i++) {
+		const VkVertexInputBindingDescription &x = a.vertexBindings[i];
+		const VkVertexInputBindingDescription &y = b.vertexBindings[i];
+		if (x.binding != y.binding || x.stride != y.stride || x.inputRate != y.inputRate) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < a.vertexAttributes.size(); i++) {
+		const VkVertexInputAttributeDescription &x = a.vertexAttributes[i];
+		const VkVertexInputAttributeDescription &y = b.vertexAttributes[i];
+		if (x.location != y.location || x.binding != y.binding || x.format != y.format || x.offset != y.offset) {
+			return false;
+		}
+	}
+
+	if (a.specializationEntries.size() != b.specializationEntries.size() || a.specializationData != b.specializationData) {
+		return false;
+	}
+	for (size_t i = 0; i < a.specializationEntries.size(); i++) {
+		const VkSpecializationMapEntry &x = a.specializationEntries[i];
+		const VkSpecializationMapEntry &y = b.specializationEntries[i];
+		if (x.constantID != y.constantID || x.offset != y.offset || x.size != y.size) {
+			return false;
+		}
+	}
+
+	return a.vertexShader == b.vertexShader && a.fragmentShader == b.fragmentShader
+		&& a.topology == b.topology
+		&& a.polygonMode == b.polygonMode && a.cullMode == b.cullMode && a.frontFace == b.frontFace && a.samples == b.samples
+		&& a.blendEnable == b.blendEnable
+		&& a.srcColorBlendFactor == b.srcColorBlendFactor && a.dstColorBlendFactor == b.dstColorBlendFactor && a.colorBlendOp == b.colorBlendOp
+		&& a.srcAlphaBlendFactor == b.srcAlphaBlendFactor && a.dstAlphaBlendFactor == b.dstAlphaBlendFactor && a.alphaBlendOp == b.alphaBlendOp
+		&& a.colorWriteMask == b.colorWriteMask
+		&& a.depthTest == b.depthTest && a.depthWrite == b.depthWrite && a.depthCompareOp == b.depthCompareOp
+		&& a.colorFormat == b.colorFormat && a.depthFormat == b.depthFormat && a.subpass == b.subpass
+		&& a.layout == b.layout;
+}
+
+//Field by field so struct padding never reaches the hash
+uint64_t hashPipelineState(const PipelineState &state) {
+
+	uint64_t hash = FNV_OFFSET;
+	hash = hashValue(hash, state.vertexShader);
+	hash = hashValue(hash, state.fragmentShader);
+
+	for (const VkSpecializationMapEntry &entry : state.specializationEntries) {
+		hash = hashValue(hash, entry.constantID);
+		hash = hashValue(hash, entry.offset);
+		hash = hashValue(hash, entry.size);
+	}
+	hash = hashBytes(hash, state.specializationData.data(), state.specializationData.size());
+
+	for (const VkVertexInputBindingDescription &binding : state.vertexBindings) {
+		hash = hashValue(hash, binding.binding);
+		hash = hashValue(hash, binding.stride);
+		hash = hashValue(hash, binding.inputRate);
+	}
+	for (const VkVertexInputAttributeDescription &attribute : state.vertexAttributes) {
+		hash = hashValue(hash, attribute.location);
+		hash = hashValue(hash, attribute.binding);
+		hash = hashValue(hash, attribute.format);
+		hash = hashValue(hash, attribute.offset);
+	}
+	hash = hashValue(hash, state.topology);
+
+	hash = hashValue(hash, state.polygonMode);
+	hash = hashValue(hash, state.cullMode);
+	hash = hashValue(hash, state.frontFace);
+	hash = hashValue(hash, state.samples);
+
+	hash = hashValue(hash, state.blendEnable);
+	hash = hashValue(hash, state.srcColorBlendFactor);
+	hash = hashValue(hash, state.dstColorBlendFactor);
+	hash = hashValue(hash, state.colorBlendOp);
+	hash = hashValue(hash, state.srcAlphaBlendFactor);
+	hash = hashValue(hash, state.dstAlphaBlendFactor);
+	hash = hashValue(hash, state.alphaBlendOp);
+	hash = hashValue(hash, state.colorWriteMask);
+
+	hash = hashValue(hash, state.depthTest);
+	hash = hashValue(hash, state.depthWrite);
+	hash = hashValue(hash, state.depthCompareOp);
+
+	hash = hashValue(hash, state.colorFormat);
+	hash = hashValue(hash, state.depthFormat);
+	hash = hashValue(hash, state.subpass);
+	hash = hashValue(hash, state.layout);
+	return hash;
+}
+
+void createPipelineStateCache(VkDevice device, PipelineStateCache *cache) {
+
+	cache->device = device;
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	if (vkCreatePipelineCache(device, &cacheInfo, vulkanAllocator(), &cache->driverCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+void destroyPipelineStateCache(JobSystem *jobSystem, PipelineStateCache *cache) {
+
+	//Compiles reference the cache, they have to finish first
+	waitForCounter(jobSystem, &cache->compiles);
+
+	std::cout << "Pipeline cache: " << cache->requests.load() << " requests, " << cache->hits.load() << " hits, "
+		<< cache->compiled.load() << " compiled, " << cache->fallbackFrames.load() << " frames on fallback" << std::endl;
+
+	for (auto &entry : cache->entries) {
+		VkPipeline pipeline = entry.second->pipeline.load();
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(cache->device, pipeline, vulkanAllocator());
+		}
+	}
+	cache->entries.clear();
+	cache->shaders.clear();
+
+	vkDestroyPipelineCache(cache->device, cache->driverCache, vulkanAllocator());
+	cache->driverCache = VK_NULL_HANDLE;
+}
+
+uint64_t registerShader(PipelineStateCache *cache, const std::vector<char> &code) {
+
+	uint64_t hash = hashBytes(FNV_OFFSET, code.data(), code.size());
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	cache->shaders.emplace(hash, code);
+	return hash;
+}
+
+static VkShaderModule createShaderModule(VkDevice device, const std::vector<char> &code) {
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, vulkanAllocator(), &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shader module");
+	}
+	return shaderModule;
+}
+
+static VkPipeline compilePipeline(PipelineStateCache *cache, const PipelineState &state, VkRenderPass renderPass) {
+
+	const std::vector<char> *vertexCode;
+	const std::vector<char> *fragmentCode;
+	{
+		//Shader entries are never erased, the vectors stay put after the lookup
+		std::lock_guard<std::mutex> lock(cache->mutex);
+		auto vertex = cache->shaders.find(state.vertexShader);
+		auto fragment = cache->shaders.find(state.fragmentShader);
+		if (vertex == cache->shaders.end() || fragment == cache->shaders.end()) {
+			throw std::runtime_error("pipeline state references an unregistered shader!");
+		}
+		vertexCode = &vertex->second;
+		fragmentCode = &fragment->second;
+	}
+
+	VkShaderModule vertShaderModule = createShaderModule(cache->device, *vertexCode);
+	VkShaderModule fragShaderModule = createShaderModule(cache->device, *fragmentCode);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	VkSpecializationInfo specialization = {};
+	specialization.mapEntryCount = static_cast<uint32_t>(state.specializationEntries.size());
+	specialization.pMapEntries = state.specializationEntries.data();
+	specialization.dataSize = state.specializationData.size();
+	specialization.pData = state.specializationData.data();
+	if (!state.specializationEntries.empty()) {
+		shaderStages[0].pSpecializationInfo = &specialization;
+		shaderStages[1].pSpecializationInfo = &specialization;
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(state.vertexBindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = state.vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.vertexAttributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = state.vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = state.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	//Set with vkCmdSetViewport / vkCmdSetScissor when recording
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = state.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = state.cullMode;
+	rasterizer.frontFace = state.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = state.samples;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = state.depthCompareOp;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = state.colorWriteMask;
+	colorBlendAttachment.blendEnable = state.blendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = state.srcColorBlendFactor;
+	colorBlendAttachment.dstColorBlendFactor = state.dstColorBlendFactor;
+	colorBlendAttachment.colorBlendOp = state.colorBlendOp;
+	colorBlendAttachment.srcAlphaBlendFactor = state.srcAlphaBlendFactor;
+	colorBlendAttachment.dstAlphaBlendFactor = state.dstAlphaBlendFactor;
+	colorBlendAttachment.alphaBlendOp = state.alphaBlendOp;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = state.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = state.layout;
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = state.subpass;
+
+	//Without a render pass the attachment formats are given directly (VK_KHR_dynamic_rendering)
+	VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &state.colorFormat;
+	renderingInfo.depthAttachmentFormat = state.depthFormat;
+	if (renderPass == VK_NULL_HANDLE) {
+		pipelineInfo.pNext = &renderingInfo;
+		pipelineInfo.subpass = 0;
+	}
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(cache->device, cache->driverCache, 1, &pipelineInfo, vulkanAllocator(), &pipeline);
+
+	vkDestroyShaderModule(cache->device, fragShaderModule, vulkanAllocator());
+	vkDestroyShaderModule(cache->device, vertShaderModule, vulkanAllocator());
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
+	cache->compiled.fetch_add(1, std::memory_order_relaxed);
+	return pipeline;
+}
+
+//Existing entry, or a new one when created is set
+static PipelineStateCache::Entry *findEntry(PipelineStateCache *cache, const PipelineState &state, bool *created) {
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+
+	auto found = cache->entries.find(state);
+	if (found != cache->entries.end()) {
+		*created = false;
+		return found->second.get();
+	}
+
+	*created = true;
+	PipelineStateCache::Entry *entry = new PipelineStateCache::Entry();
+	cache->entries.emplace(state, std::unique_ptr<PipelineStateCache::Entry>(entry));
+	return entry;
+}
+
+VkPipeline getPipelineNow(PipelineStateCache *cache, const PipelineState &state, VkRenderPass renderPass) {
+
+	cache->requests.fetch_add(1, std::memory_order_relaxed);
+
+	bool created;
+	PipelineStateCache::Entry *entry = findEntry(cache, state, &created);
+	if (!created) {
+		//Another request may be compiling it right now
+		while (entry->pipeline.load(std::memory_order_acquire) == VK_NULL_HANDLE && !entry->failed.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		if (entry->failed.load(std::memory_order_acquire)) {
+			throw std::runtime_error("failed to create graphics pipeline!");
+		}
+		cache->hits.fetch_add(1, std::memory_order_relaxed);
+		return entry->pipeline.load(std::memory_order_acquire);
+	}
+
+	try {
+		entry->pipeline.store(compilePipeline(cache, state, renderPass), std::memory_order_release);
+	}
+	catch (...) {
+		entry->failed.store(true, std::memory_order_release);
+		throw;
+	}
+	return entry->pipeline.load(std::memory_order_acquire);
+}
+
+VkPipeline requestPipeline(JobSystem *jobSystem, PipelineStateCache *cache, const PipelineState &state, VkRenderPass renderPass, VkPipeline fallback,
+	bool *settled) {
+
+	cache->requests.fetch_add(1, std::memory_order_relaxed);
+
+	bool created;
+	PipelineStateCache::Entry *entry = findEntry(cache, state, &created);
+
+	if (created) {
+		spawnJob(jobSystem, &cache->compiles, [cache, entry, state, renderPass]() {
+			try {
+				entry->pipeline.store(compilePipeline(cache, state, renderPass), std::memory_order_release);
+			}
+			catch (const std::exception &error) {
+				std::cout << "Pipeline compile failed, keeping the fallback: " << error.what() << std::endl;
+				entry->failed.store(true, std::memory_order_release);
+			}
+		});
+	}
+
+	VkPipeline pipeline = entry->pipeline.load(std::memory_order_acquire);
+	if (pipeline == VK_NULL_HANDLE) {
+		if (settled != nullptr) {
+			*settled = entry->failed.load(std::memory_order_acquire);
+		}
+		return fallback;
+	}
+
+	cache->hits.fetch_add(1, std::memory_order_relaxed);
+	if (settled != nullptr) {
+		*settled = true;
+	}
+	return pipeline;
+}
+
+void waitForPipelineCompiles(JobSystem *jobSystem, PipelineStateCache *cache) {
+	waitForCounter(jobSystem, &cache->compiles);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+#include "SpecializationConstants.h"
+
+//Everything a graphics pipeline is built from, hashable and comparable.
+//Shaders are referenced by the hash of their SPIR-V, the render pass by what makes it compatible
+//(attachment formats and sample count). Viewport and scissor are dynamic so the extent is not part of it.
+struct PipelineState {
+	uint64_t vertexShader = 0;
+	uint64_t fragmentShader = 0;
+
+	//Specialization constants for both stages, constant IDs are shared between them
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	std::vector<uint8_t> specializationData;
+
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	bool blendEnable = false;
+	VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+	VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	bool depthTest = false;
+	bool depthWrite = false;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	uint32_t subpass = 0;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+bool operator==(const PipelineState &a, const PipelineState &b);
+
+//Select a variant: copy the constants described by SpecializationLayout<T> into the state.
+//Bytes not covered by an entry (padding) stay zero so equal variants hash equal.
+template<typename T>
+void specializePipeline(PipelineState *state, const T &constants) {
+
+	VkSpecializationInfo info = specializationInfo(constants);
+
+	state->specializationEntries.assign(info.pMapEntries, info.pMapEntries + info.mapEntryCount);
+	state->specializationData.assign(info.dataSize, 0);
+
+	const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&constants);
+	for (const VkSpecializationMapEntry &entry : state->specializationEntries) {
+		std::copy(bytes + entry.offset, bytes + entry.offset + entry.size, state->specializationData.begin() + entry.offset);
+	}
+}
+uint64_t hashPipelineState(const PipelineState &state);
+
+struct PipelineStateHash {
+	size_t operator()(const PipelineState &state) const {
+		return static_cast<size_t>(hashPipelineState(state));
+	}
+};
+
+//Map from pipeline state to VkPipeline. A miss is compiled once on a worker, every request
+//for the same state meanwhile gets the fallback pipeline instead of waiting.
+struct PipelineStateCache {
+	struct Entry {
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		std::atomic<bool> failed{ false };
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache driverCache = VK_NULL_HANDLE;
+
+	std::mutex mutex;
+	std::unordered_map<PipelineState, std::unique_ptr<Entry>, PipelineStateHash> entries;
+	std::unordered_map<uint64_t, std::vector<char>> shaders;
+	JobCounter compiles;
+
+	std::atomic<uint64_t> requests{ 0 };
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> compiled{ 0 };
+	//Counted by the renderer, once per window and frame drawn with the fallback in place of its state
+	std::atomic<uint64_t> fallbackFrames{ 0 };
+};
+
+void createPipelineStateCache(VkDevice device, PipelineStateCache *cache);
+//Waits for outstanding compiles, destroys every cached pipeline
+void destroyPipelineStateCache(JobSystem *jobSystem, PipelineStateCache *cache);
+
+//Keep SPIR-V code for later compiles, returns the hash used in PipelineState
+uint64_t registerShader(PipelineStateCache *cache, const std::vector<char> &code);
+
+//Compile on the calling thread (fallback pipeline at startup)
+//renderPass VK_NULL_HANDLE builds the pipeline for dynamic rendering with the state's attachment formats
+VkPipeline getPipelineNow(PipelineStateCache *cache, const PipelineState &state, VkRenderPass renderPass);
+//Ready pipeline for the state, or fallback while it compiles on a worker. renderPass must stay valid until waitForPipelineCompiles.
+//settled, when given, is set once the answer stops changing: the pipeline compiled, or failed and fallback stays.
+VkPipeline requestPipeline(JobSystem *jobSystem, PipelineStateCache *cache, const PipelineState &state, VkRenderPass renderPass, VkPipeline fallback,
+	bool *settled = nullptr);
+void waitForPipelineCompiles(JobSystem *jobSystem, PipelineStateCache *cache);
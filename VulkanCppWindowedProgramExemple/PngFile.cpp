@@ -0,0 +1,547 @@
+#include "PngFile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+//Slicing by 8: entries[k][n] is the CRC of byte n followed by k zero bytes, eight bytes per step
+struct CrcTables {
+	uint32_t entries[8][256];
+};
+
+static const CrcTables &crcTables() {
+
+	static const struct Tables : CrcTables {
+		Tables() {
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) {
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				entries[0][n] = c;
+			}
+			for (int k = 1; k < 8; k++) {
+				for (uint32_t n = 0; n < 256; n++) {
+					entries[k][n] = (entries[k - 1][n] >> 8) ^ entries[0][entries[k - 1][n] & 0xFF];
+				}
+			}
+		}
+	} tables;
+	return tables;
+}
+
+static uint32_t updateCrc(uint32_t crc, const uint8_t *data, size_t size) {
+
+	const uint32_t (*table)[256] = crcTables().entries;
+	for (; size >= 8; data += 8, size -= 8) {
+		uint32_t low = crc ^ (uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24);
+		uint32_t high = uint32_t(data[4]) | uint32_t(data[5]) << 8 | uint32_t(data[6]) << 16 | uint32_t(data[7]) << 24;
+		crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24]
+			^ table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+	}
+	for (size_t i = 0; i < size; i++) {
+		crc = table[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+//Writes to the file and folds the bytes into the running chunk CRC
+static void writeChecked(PngWriter *writer, const uint8_t *data, size_t size) {
+	writer->crc = updateCrc(writer->crc, data, size);
+	std::fwrite(data, 1, size, writer->file);
+}
+
+static void writeBigEndian(PngWriter *writer, uint32_t value, bool checked) {
+	uint8_t bytes[4] = { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) };
+	if (checked) {
+		writeChecked(writer, bytes, 4);
+	}
+	else {
+		std::fwrite(bytes, 1, 4, writer->file);
+	}
+}
+
+static void beginChunk(PngWriter *writer, const char *type, uint32_t length) {
+	writeBigEndian(writer, length, false);
+	writer->crc = 0xFFFFFFFFu;
+	writeChecked(writer, reinterpret_cast<const uint8_t *>(type), 4);
+}
+
+static void endChunk(PngWriter *writer) {
+	writeBigEndian(writer, writer->crc ^ 0xFFFFFFFFu, false);
+}
+
+bool beginPng(PngWriter *writer, const std::string &path, uint32_t width, uint32_t height, uint8_t *blockScratch) {
+
+	writer->file = std::fopen(path.c_str(), "wb");
+	if (writer->file == nullptr) {
+		return false;
+	}
+
+	writer->width = width;
+	writer->block = blockScratch;
+	writer->fill = 0;
+	writer->remaining = (1 + static_cast<size_t>(width) * 3) * height;
+	writer->adlerA = 1;
+	writer->adlerB = 0;
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::fwrite(signature, 1, sizeof(signature), writer->file);
+
+	//8 bit RGB, no interlace
+	beginChunk(writer, "IHDR", 13);
+	writeBigEndian(writer, width, true);
+	writeBigEndian(writer, height, true);
+	const uint8_t format[5] = { 8, 2, 0, 0, 0 };
+	writeChecked(writer, format, sizeof(format));
+	endChunk(writer);
+
+	//Stored blocks make the compressed size known up front: a single IDAT
+	size_t blockCount = (writer->remaining + PNG_BLOCK_SIZE - 1) / PNG_BLOCK_SIZE;
+	beginChunk(writer, "IDAT", static_cast<uint32_t>(2 + blockCount * 5 + writer->remaining + 4));
+	const uint8_t zlibHeader[2] = { 0x78, 0x01 };
+	writeChecked(writer, zlibHeader, sizeof(zlibHeader));
+
+	return true;
+}
+
+static void flushBlock(PngWriter *writer) {
+
+	uint16_t length = static_cast<uint16_t>(writer->fill);
+	uint8_t header[5] = { uint8_t(writer->remaining == 0 ? 1 : 0), uint8_t(length), uint8_t(length >> 8), uint8_t(~length), uint8_t(~length >> 8) };
+	writeChecked(writer, header, sizeof(header));
+	writeChecked(writer, writer->block, writer->fill);
+	writer->fill = 0;
+}
+
+static void putDeflate(PngWriter *writer, const uint8_t *data, size_t size) {
+
+	while (size > 0) {
+		size_t count = std::min(size, PNG_BLOCK_SIZE - writer->fill);
+		std::copy(data, data + count, writer->block + writer->fill);
+
+		//5552 bytes is the most Adler-32 can sum before the modulo must be applied
+		for (size_t done = 0; done < count;) {
+			size_t run = std::min<size_t>(count - done, 5552);
+			for (size_t i = 0; i < run; i++) {
+				writer->adlerA += data[done + i];
+				writer->adlerB += writer->adlerA;
+			}
+			writer->adlerA %= 65521;
+			writer->adlerB %= 65521;
+			done += run;
+		}
+
+		writer->fill += count;
+		writer->remaining -= count;
+		data += count;
+		size -= count;
+
+		if (writer->fill == PNG_BLOCK_SIZE || writer->remaining == 0) {
+			flushBlock(writer);
+		}
+	}
+}
+
+void writePngRow(PngWriter *writer, const uint8_t *rgb) {
+	const uint8_t filter = 0;
+	putDeflate(writer, &filter, 1);
+	putDeflate(writer, rgb, static_cast<size_t>(writer->width) * 3);
+}
+
+bool endPng(PngWriter *writer) {
+
+	writeBigEndian(writer, (writer->adlerB << 16) | writer->adlerA, true);
+	endChunk(writer);
+
+	beginChunk(writer, "IEND", 0);
+	endChunk(writer);
+
+	bool written = std::ferror(writer->file) == 0;
+	written = std::fclose(writer->file) == 0 && written;
+	writer->file = nullptr;
+	return written;
+}
+
+//Inflate, enough of RFC 1951 for any PNG encoder's output
+
+struct BitReader {
+	const uint8_t *data;
+	size_t size;
+	size_t position = 0;
+	uint32_t buffer = 0;
+	int count = 0;
+	bool overrun = false;
+};
+
+static uint32_t readBits(BitReader *reader, int needed) {
+
+	while (reader->count < needed) {
+		if (reader->position == reader->size) {
+			reader->overrun = true;
+			return 0;
+		}
+		reader->buffer |= static_cast<uint32_t>(reader->data[reader->position++]) << reader->count;
+		reader->count += 8;
+	}
+
+	uint32_t value = reader->buffer & ((1u << needed) - 1);
+	reader->buffer >>= needed;
+	reader->count -= needed;
+	return value;
+}
+
+//Canonical Huffman code: symbol count per length and symbols ordered by code
+struct Huffman {
+	uint16_t counts[16];
+	uint16_t symbols[288];
+};
+
+static bool buildHuffman(Huffman *huffman, const uint8_t *lengths, int symbolCount) {
+
+	std::memset(huffman->counts, 0, sizeof(huffman->counts));
+	for (int symbol = 0; symbol < symbolCount; symbol++) {
+		huffman->counts[lengths[symbol]]++;
+	}
+
+	//Over-subscribed codes are invalid, incomplete ones are allowed (single distance code)
+	int left = 1;
+	for (int length = 1; length < 16; length++) {
+		left = (left << 1) - huffman->counts[length];
+		if (left < 0) {
+			return false;
+		}
+	}
+
+	uint16_t offsets[16];
+	offsets[1] = 0;
+	for (int length = 1; length < 15; length++) {
+		offsets[length + 1] = offsets[length] + huffman->counts[length];
+	}
+	for (int symbol = 0; symbol < symbolCount; symbol++) {
+		if (lengths[symbol] != 0) {
+			huffman->symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+		}
+	}
+	return true;
+}
+
+static int decodeSymbol(BitReader *reader, const Huffman &huffman) {
+
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	for (int length = 1; length < 16; length++) {
+		code |= static_cast<int>(readBits(reader, 1));
+		int count = huffman.counts[length];
+		if (code - count < first) {
+			return huffman.symbols[index + (code - first)];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+static bool inflateCodes(BitReader *reader, const Huffman &lengthCodes, const Huffman &distanceCodes, std::vector<uint8_t> *out) {
+
+	static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	for (;;) {
+		int symbol = decodeSymbol(reader, lengthCodes);
+		if (symbol < 0 || reader->overrun) {
+			return false;
+		}
+		if (symbol < 256) {
+			out->push_back(static_cast<uint8_t>(symbol));
+			continue;
+		}
+		if (symbol == 256) {
+			return true;
+		}
+
+		symbol -= 257;
+		if (symbol >= 29) {
+			return false;
+		}
+		size_t length = lengthBase[symbol] + readBits(reader, lengthExtra[symbol]);
+
+		int distanceSymbol = decodeSymbol(reader, distanceCodes);
+		if (distanceSymbol < 0 || distanceSymbol >= 30) {
+			return false;
+		}
+		size_t distance = distanceBase[distanceSymbol] + readBits(reader, distanceExtra[distanceSymbol]);
+		if (distance > out->size() || reader->overrun) {
+			return false;
+		}
+
+		//Byte by byte, the match may overlap what it produces
+		size_t from = out->size() - distance;
+		for (size_t i = 0; i < length; i++) {
+			out->push_back((*out)[from + i]);
+		}
+	}
+}
+
+static bool inflateZlib(const uint8_t *data, size_t size, std::vector<uint8_t> *out, std::string *error) {
+
+	if (size < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20) != 0) {
+		*error = "image data is not a zlib stream";
+		return false;
+	}
+
+	BitReader reader;
+	reader.data = data + 2;
+	reader.size = size - 2;
+
+	bool last = false;
+	while (!last) {
+		last = readBits(&reader, 1) != 0;
+		uint32_t type = readBits(&reader, 2);
+
+		if (type == 0) {
+			reader.buffer = 0;
+			reader.count = 0;
+			if (reader.size - reader.position < 4) {
+				break;
+			}
+			const uint8_t *header = reader.data + reader.position;
+			size_t length = header[0] | (header[1] << 8);
+			if ((length ^ 0xFFFF) != static_cast<size_t>(header[2] | (header[3] << 8)) || reader.size - reader.position - 4 < length) {
+				*error = "corrupt stored block";
+				return false;
+			}
+			out->insert(out->end(), header + 4, header + 4 + length);
+			reader.position += 4 + length;
+		}
+		else if (type == 1) {
+			uint8_t lengths[288 + 30];
+			std::fill(lengths, lengths + 144, uint8_t(8));
+			std::fill(lengths + 144, lengths + 256, uint8_t(9));
+			std::fill(lengths + 256, lengths + 280, uint8_t(7));
+			std::fill(lengths + 280, lengths + 288, uint8_t(8));
+			std::fill(lengths + 288, lengths + 318, uint8_t(5));
+
+			Huffman lengthCodes, distanceCodes;
+			buildHuffman(&lengthCodes, lengths, 288);
+			buildHuffman(&distanceCodes, lengths + 288, 30);
+			if (!inflateCodes(&reader, lengthCodes, distanceCodes, out)) {
+				*error = "corrupt fixed Huffman block";
+				return false;
+			}
+		}
+		else if (type == 2) {
+			static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			int lengthCount = static_cast<int>(readBits(&reader, 5)) + 257;
+			int distanceCount = static_cast<int>(readBits(&reader, 5)) + 1;
+			int codeLengthCount = static_cast<int>(readBits(&reader, 4)) + 4;
+			if (lengthCount > 286 || distanceCount > 30) {
+				*error = "corrupt dynamic Huffman block";
+				return false;
+			}
+
+			uint8_t lengths[288 + 30] = {};
+			for (int i = 0; i < codeLengthCount; i++) {
+				lengths[order[i]] = static_cast<uint8_t>(readBits(&reader, 3));
+			}
+			Huffman codeLengthCodes;
+			bool valid = buildHuffman(&codeLengthCodes, lengths, 19);
+
+			std::fill(lengths, lengths + 19, uint8_t(0));
+			int index = 0;
+			while (valid && index < lengthCount + distanceCount) {
+				int symbol = decodeSymbol(&reader, codeLengthCodes);
+				if (symbol < 0 || reader.overrun) {
+					valid = false;
+				}
+				else if (symbol < 16) {
+					lengths[index++] = static_cast<uint8_t>(symbol);
+				}
+				else {
+					uint8_t repeated = 0;
+					int repeat;
+					if (symbol == 16) {
+						valid = index > 0;
+						repeated = valid ? lengths[index - 1] : 0;
+						repeat = 3 + static_cast<int>(readBits(&reader, 2));
+					}
+					else if (symbol == 17) {
+						repeat = 3 + static_cast<int>(readBits(&reader, 3));
+					}
+					else {
+						repeat = 11 + static_cast<int>(readBits(&reader, 7));
+					}
+					valid = valid && index + repeat <= lengthCount + distanceCount;
+					while (valid && repeat-- > 0) {
+						lengths[index++] = repeated;
+					}
+				}
+			}
+
+			//Distance lengths follow the literal/length ones without a gap
+			uint8_t distanceLengths[30] = {};
+			std::copy(lengths + lengthCount, lengths + lengthCount + distanceCount, distanceLengths);
+
+			Huffman lengthCodes, distanceCodes;
+			valid = valid && lengths[256] != 0
+				&& buildHuffman(&lengthCodes, lengths, lengthCount)
+				&& buildHuffman(&distanceCodes, distanceLengths, distanceCount)
+				&& inflateCodes(&reader, lengthCodes, distanceCodes, out);
+			if (!valid) {
+				*error = "corrupt dynamic Huffman block";
+				return false;
+			}
+		}
+		else {
+			*error = "invalid deflate block type";
+			return false;
+		}
+
+		if (reader.overrun) {
+			break;
+		}
+	}
+
+	if (!last || reader.overrun) {
+		*error = "truncated image data";
+		return false;
+	}
+	return true;
+}
+
+static uint32_t readBigEndian(const uint8_t *bytes) {
+	return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+static uint8_t paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = std::abs(p - a);
+	int pb = std::abs(p - b);
+	int pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) {
+		return static_cast<uint8_t>(a);
+	}
+	return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+bool readPng(const std::string &path, std::vector<uint8_t> *rgb, uint32_t *width, uint32_t *height, std::string *error) {
+
+	FILE *file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		*error = "cannot open " + path;
+		return false;
+	}
+	std::vector<uint8_t> bytes;
+	uint8_t buffer[65536];
+	size_t count;
+	while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		bytes.insert(bytes.end(), buffer, buffer + count);
+	}
+	std::fclose(file);
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (bytes.size() < 8 || !std::equal(signature, signature + 8, bytes.begin())) {
+		*error = path + " is not a PNG file";
+		return false;
+	}
+
+	uint32_t channels = 0;
+	std::vector<uint8_t> compressed;
+	bool ended = false;
+
+	for (size_t position = 8; !ended;) {
+		if (bytes.size() - position < 12) {
+			*error = path + " is truncated";
+			return false;
+		}
+		uint32_t length = readBigEndian(&bytes[position]);
+		if (bytes.size() - position - 12 < length) {
+			*error = path + " is truncated";
+			return false;
+		}
+		const uint8_t *type = &bytes[position + 4];
+		const uint8_t *chunk = type + 4;
+		if (updateCrc(0xFFFFFFFFu, type, 4 + length) != (readBigEndian(chunk + length) ^ 0xFFFFFFFFu)) {
+			*error = path + " has a corrupt chunk";
+			return false;
+		}
+
+		if (std::memcmp(type, "IHDR", 4) == 0 && length == 13) {
+			*width = readBigEndian(chunk);
+			*height = readBigEndian(chunk + 4);
+			uint8_t depth = chunk[8];
+			uint8_t colorType = chunk[9];
+			uint8_t interlace = chunk[12];
+			channels = colorType == 2 ? 3 : colorType == 6 ? 4 : 0;
+			if (depth != 8 || channels == 0 || interlace != 0) {
+				*error = path + ": only non-interlaced 8 bit RGB and RGBA images are supported";
+				return false;
+			}
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0) {
+			ended = true;
+		}
+		position += 12 + length;
+	}
+
+	if (channels == 0) {
+		*error = path + " has no header";
+		return false;
+	}
+
+	std::vector<uint8_t> filtered;
+	std::string inflateError;
+	if (!inflateZlib(compressed.data(), compressed.size(), &filtered, &inflateError)) {
+		*error = path + ": " + inflateError;
+		return false;
+	}
+
+	size_t stride = static_cast<size_t>(*width) * channels;
+	if (filtered.size() < (stride + 1) * *height) {
+		*error = path + " has less pixel data than its size";
+		return false;
+	}
+
+	//Undo the per row filters in place, each row refers to the already decoded previous one
+	std::vector<uint8_t> previous(stride, 0);
+	rgb->resize(static_cast<size_t>(*width) * *height * 3);
+
+	for (uint32_t y = 0; y < *height; y++) {
+		uint8_t filter = filtered[y * (stride + 1)];
+		uint8_t *row = &filtered[y * (stride + 1) + 1];
+
+		for (size_t x = 0; x < stride; x++) {
+			int left = x >= channels ? row[x - channels] : 0;
+			int up = previous[x];
+			int upLeft = x >= channels ? previous[x - channels] : 0;
+
+			switch (filter) {
+			case 0: break;
+			case 1: row[x] = static_cast<uint8_t>(row[x] + left); break;
+			case 2: row[x] = static_cast<uint8_t>(row[x] + up); break;
+			case 3: row[x] = static_cast<uint8_t>(row[x] + ((left + up) >> 1)); break;
+			case 4: row[x] = static_cast<uint8_t>(row[x] + paeth(left, up, upLeft)); break;
+			default:
+				*error = path + " has an invalid row filter";
+				return false;
+			}
+		}
+		std::copy(row, row + stride, previous.begin());
+
+		uint8_t *out = &(*rgb)[static_cast<size_t>(y) * *width * 3];
+		for (uint32_t x = 0; x < *width; x++) {
+			out[x * 3 + 0] = row[x * channels + 0];
+			out[x * 3 + 1] = row[x * channels + 1];
+			out[x * 3 + 2] = row[x * channels + 2];
+		}
+	}
+
+	return true;
+}
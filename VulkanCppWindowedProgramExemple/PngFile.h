@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//8 bit RGB PNG, written with stored deflate blocks: no compression cost, the file is as large
+//as the pixels. Rows are pushed one at a time so a frame can be converted while it is written.
+static const size_t PNG_BLOCK_SIZE = 65535;
+
+struct PngWriter {
+	FILE *file = nullptr;
+	uint32_t width = 0;
+	uint32_t crc = 0;
+
+	//Deflate state, the block buffer is supplied by the caller so writing does not allocate
+	uint8_t *block = nullptr;
+	size_t fill = 0;
+	size_t remaining = 0;
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+};
+
+//blockScratch must hold PNG_BLOCK_SIZE bytes and outlive the writer, false when the file cannot be opened
+bool beginPng(PngWriter *writer, const std::string &path, uint32_t width, uint32_t height, uint8_t *blockScratch);
+//width * 3 bytes, rows top to bottom
+void writePngRow(PngWriter *writer, const uint8_t *rgb);
+//False when the file could not be written completely
+bool endPng(PngWriter *writer);
+
+//Non-interlaced 8 bit RGB or RGBA (alpha dropped) into width * height * 3 bytes,
+//false with the reason in error for anything else
+bool readPng(const std::string &path, std::vector<uint8_t> *rgb, uint32_t *width, uint32_t *height, std::string *error);
@@ -0,0 +1,119 @@
+#include "QueueFamilies.h"
+#include <algorithm>
+#include <iostream>
+
+std::vector<uint32_t> QueueFamilyIndices::uniqueFamilies() const {
+
+	std::vector<uint32_t> unique;
+	for (const auto &family : { graphicsFamily, presentFamily }) {
+		if (family.has_value() && std::find(unique.begin(), unique.end(), family.value()) == unique.end()) {
+			unique.push_back(family.value());
+		}
+	}
+	return unique;
+}
+
+//Queue of device instruction if compatible
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface) {
+	QueueFamilyIndices indices;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+	//Record every family before choosing
+	indices.families.resize(queueFamilyCount);
+	for (uint32_t i = 0; i < queueFamilyCount; i++) {
+		const VkQueueFamilyProperties &properties = queueFamilies[i];
+		QueueFamilyCapabilities &family = indices.families[i];
+
+		family.queueCount = properties.queueCount;
+		family.timestampValidBits = properties.timestampValidBits;
+
+		if (properties.queueCount == 0) {
+			continue;
+		}
+
+		family.graphics = (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		family.compute = (properties.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		//Graphics and compute queues support transfers even without the bit
+		family.transfer = (properties.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+
+		//provided presentation support. Offscreen there is no surface and nothing is presented:
+		//graphics families stand in, so present never needs a queue of its own
+		VkBool32 presentSupport = family.graphics ? VK_TRUE : VK_FALSE;
+		if (surface != VK_NULL_HANDLE) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
+		family.present = presentSupport == VK_TRUE;
+	}
+
+	//Graphics: prefer a family that also presents so no ownership transfer is needed
+	for (uint32_t i = 0; i < queueFamilyCount; i++) {
+		const QueueFamilyCapabilities &family = indices.families[i];
+		if (family.graphics && (!indices.graphicsFamily.has_value() || (family.present && !indices.families[indices.graphicsFamily.value()].present))) {
+			indices.graphicsFamily = i;
+		}
+	}
+
+	//Present: the graphics family when it can, else the first presenting family
+	if (indices.graphicsFamily.has_value() && indices.families[indices.graphicsFamily.value()].present) {
+		indices.presentFamily = indices.graphicsFamily;
+	}
+	else {
+		for (uint32_t i = 0; i < queueFamilyCount; i++) {
+			if (indices.families[i].present) {
+				indices.presentFamily = i;
+				break;
+			}
+		}
+	}
+
+	//Compute: async family without graphics, else the graphics family
+	//Transfer: dedicated family (DMA engine), else async compute, else graphics
+	for (uint32_t i = 0; i < queueFamilyCount; i++) {
+		const QueueFamilyCapabilities &family = indices.families[i];
+		if (family.compute && !family.graphics && !indices.computeFamily.has_value()) {
+			indices.computeFamily = i;
+		}
+		if (family.transfer && !family.graphics && !family.compute && !indices.transferFamily.has_value()) {
+			indices.transferFamily = i;
+		}
+	}
+	if (!indices.computeFamily.has_value()) {
+		indices.computeFamily = indices.graphicsFamily;
+	}
+	if (!indices.transferFamily.has_value()) {
+		indices.transferFamily = indices.computeFamily;
+	}
+
+	return indices;
+}
+
+void printQueueFamilies(const QueueFamilyIndices &indices) {
+
+	for (size_t i = 0; i < indices.families.size(); i++) {
+		const QueueFamilyCapabilities &family = indices.families[i];
+		std::cout << "Queue family " << i << ": " << family.queueCount << " queues,"
+			<< (family.graphics ? " graphics" : "") << (family.compute ? " compute" : "")
+			<< (family.transfer ? " transfer" : "") << (family.present ? " present" : "")
+			<< ", timestamp bits " << family.timestampValidBits << std::endl;
+	}
+
+	auto print = [](const char *name, const std::optional<uint32_t> &family) {
+		std::cout << name << " family: ";
+		if (family.has_value()) {
+			std::cout << family.value();
+		}
+		else {
+			std::cout << "none";
+		}
+		std::cout << std::endl;
+	};
+	print("Graphics", indices.graphicsFamily);
+	print("Present", indices.presentFamily);
+	print("Compute", indices.computeFamily);
+	print("Transfer", indices.transferFamily);
+}
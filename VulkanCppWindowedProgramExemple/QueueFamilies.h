@@ -0,0 +1,42 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//What one queue family can do
+struct QueueFamilyCapabilities {
+	uint32_t queueCount = 0;
+	uint32_t timestampValidBits = 0;
+	bool graphics = false;
+	bool compute = false;
+	bool transfer = false;
+	bool present = false;
+};
+
+//Capability map of every queue family plus the families chosen for each kind of work
+struct QueueFamilyIndices {
+	std::vector<QueueFamilyCapabilities> families;
+
+	std::optional<uint32_t> graphicsFamily;
+	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily;
+	std::optional<uint32_t> transferFamily;
+
+	bool isComplete() const {
+		return graphicsFamily.has_value() && presentFamily.has_value();
+	}
+
+	//Present runs on its own queue and swap chain images change owner between the two families
+	bool separatePresent() const {
+		return isComplete() && graphicsFamily.value() != presentFamily.value();
+	}
+
+	//Families that get a queue at device creation. Compute and transfer are only recorded for device
+	//scoring, nothing is submitted to them yet
+	std::vector<uint32_t> uniqueFamilies() const;
+};
+
+//surface is VK_NULL_HANDLE offscreen
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
+void printQueueFamilies(const QueueFamilyIndices &indices);
@@ -0,0 +1,277 @@
+#include "RegressionCheck.h"
+#include "CommandLine.h"
+#include "PngFile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+RegressionOptions parseRegressionOptions(int argc, char *argv[]) {
+
+	RegressionOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--golden", &value)) {
+			options.goldenPath = value;
+		}
+		else if (matchOption(arg, "--golden-frame", &value)) {
+			options.goldenFrame = std::stoull(value);
+		}
+		else if (matchOption(arg, "--golden-tolerance", &value)) {
+			options.tolerance = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (matchOption(arg, "--golden-max-differing", &value)) {
+			options.maxDifferingFraction = std::stod(value);
+		}
+		else if (matchFlag(arg, "--golden-update")) {
+			options.updateGolden = true;
+		}
+		else if (matchOption(arg, "--baseline", &value)) {
+			options.baselinePath = value;
+		}
+		else if (matchFlag(arg, "--baseline-update")) {
+			options.updateBaseline = true;
+		}
+		else if (matchOption(arg, "--max-frame-regression", &value)) {
+			options.maxFrameRegressionPercent = std::stod(value);
+		}
+		else if (matchOption(arg, "--max-startup-regression", &value)) {
+			options.maxStartupRegressionPercent = std::stod(value);
+		}
+	}
+
+	if ((options.updateGolden && options.goldenPath.empty()) || (options.updateBaseline && options.baselinePath.empty())) {
+		throw std::runtime_error("--golden-update and --baseline-update need the file to write!");
+	}
+
+	return options;
+}
+
+//Keeps an RGB copy of the golden frame, the mapped readback buffer is only valid during the call
+static void storeFrame(RegressionRun *run, const CapturedFrame &captured) {
+
+	std::lock_guard<std::mutex> lock(run->frameMutex);
+
+	size_t pixelCount = static_cast<size_t>(captured.extent.width) * captured.extent.height;
+	run->frame.resize(pixelCount * 3);
+	int red = captured.swapRedBlue ? 2 : 0;
+	int blue = captured.swapRedBlue ? 0 : 2;
+
+	for (size_t i = 0; i < pixelCount; i++) {
+		run->frame[i * 3 + 0] = captured.pixels[i * 4 + red];
+		run->frame[i * 3 + 1] = captured.pixels[i * 4 + 1];
+		run->frame[i * 3 + 2] = captured.pixels[i * 4 + blue];
+	}
+	run->frameExtent = captured.extent;
+	run->frameCaptured = true;
+}
+
+void prepareRegressionRun(RegressionRun *run, FrameCapture *capture, uint64_t frameLimit) {
+
+	if (run->options.goldenPath.empty()) {
+		return;
+	}
+
+	uint64_t frame = run->options.goldenFrame;
+	if (frame == GOLDEN_LAST_FRAME) {
+		if (frameLimit == 0) {
+			throw std::runtime_error("--golden needs --frames or --golden-frame!");
+		}
+		//The last frame: every pipeline had time to compile and replace its fallback
+		frame = frameLimit - 1;
+	}
+	else if (frameLimit != 0 && frame >= frameLimit) {
+		throw std::runtime_error("--golden-frame is past the last of --frames!");
+	}
+
+	capture->options.firstFrame = frame;
+	capture->options.every = 1;
+	capture->options.frameCount = 1;
+	capture->inspect = [run](const CapturedFrame &captured) { storeFrame(run, captured); };
+}
+
+static bool writeRgbPng(const std::string &path, const std::vector<uint8_t> &rgb, VkExtent2D extent) {
+
+	std::vector<uint8_t> block(PNG_BLOCK_SIZE);
+	PngWriter writer;
+	if (!beginPng(&writer, path, extent.width, extent.height, block.data())) {
+		return false;
+	}
+	for (uint32_t y = 0; y < extent.height; y++) {
+		writePngRow(&writer, &rgb[static_cast<size_t>(y) * extent.width * 3]);
+	}
+	return endPng(&writer);
+}
+
+static bool checkGolden(RegressionRun *run) {
+
+	const RegressionOptions &options = run->options;
+
+	if (!run->frameCaptured) {
+		std::cout << "Golden image: FAIL, the frame was not captured, did the run reach it?" << std::endl;
+		return false;
+	}
+
+	if (options.updateGolden) {
+		if (!writeRgbPng(options.goldenPath, run->frame, run->frameExtent)) {
+			throw std::runtime_error("failed to write golden image " + options.goldenPath + "!");
+		}
+		std::cout << "Golden image: updated " << options.goldenPath << std::endl;
+		return true;
+	}
+
+	std::vector<uint8_t> golden;
+	uint32_t width, height;
+	std::string error;
+	if (!readPng(options.goldenPath, &golden, &width, &height, &error)) {
+		std::cout << "Golden image: " << error << std::endl;
+		return false;
+	}
+
+	if (width != run->frameExtent.width || height != run->frameExtent.height) {
+		std::cout << "Golden image: FAIL, frame is " << run->frameExtent.width << "x" << run->frameExtent.height
+			<< ", golden is " << width << "x" << height << std::endl;
+		writeRgbPng(options.goldenPath + ".actual.png", run->frame, run->frameExtent);
+		return false;
+	}
+
+	//Differing pixels are marked in the diff image, scaled so small differences stay visible
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	std::vector<uint8_t> diff(pixelCount * 3, 0);
+	size_t differing = 0;
+	int maxDifference = 0;
+
+	for (size_t i = 0; i < pixelCount; i++) {
+		int difference = 0;
+		for (int channel = 0; channel < 3; channel++) {
+			difference = std::max(difference, std::abs(int(run->frame[i * 3 + channel]) - int(golden[i * 3 + channel])));
+		}
+		maxDifference = std::max(maxDifference, difference);
+		if (difference > static_cast<int>(options.tolerance)) {
+			differing++;
+			diff[i * 3] = static_cast<uint8_t>(std::min(255, 64 + difference * 4));
+		}
+	}
+
+	double fraction = static_cast<double>(differing) / pixelCount;
+	bool passed = fraction <= options.maxDifferingFraction;
+
+	std::cout << "Golden image: " << (passed ? "pass" : "FAIL") << ", " << differing << " of " << pixelCount
+		<< " pixels beyond tolerance " << options.tolerance << " (" << fraction * 100.0 << "%, max "
+		<< options.maxDifferingFraction * 100.0 << "%), largest difference " << maxDifference << std::endl;
+
+	if (!passed) {
+		writeRgbPng(options.goldenPath + ".actual.png", run->frame, run->frameExtent);
+		writeRgbPng(options.goldenPath + ".diff.png", diff, run->frameExtent);
+	}
+	return passed;
+}
+
+struct Metric {
+	std::string name;
+	double milliseconds;
+};
+
+static std::vector<Metric> collectMetrics(const LatencySummary &latency, const StartupTimer &startup) {
+
+	std::vector<Metric> metrics;
+	if (latency.frameSamples > 0) {
+		metrics.push_back({ "frame.mean", latency.frameMeanMs });
+		metrics.push_back({ "frame.p50", latency.frameP50Ms });
+		metrics.push_back({ "frame.p99", latency.frameP99Ms });
+	}
+
+	double total = 0.0;
+	for (const StartupTimer::Step &step : startup.steps) {
+		//Step names become single words, the baseline file is whitespace separated
+		std::string name = std::string("startup.") + step.name;
+		std::replace(name.begin(), name.end(), ' ', '_');
+		metrics.push_back({ name, step.milliseconds });
+		total += step.milliseconds;
+	}
+	metrics.push_back({ "startup.total", total });
+
+	return metrics;
+}
+
+static bool checkBaseline(const RegressionOptions &options, const std::vector<Metric> &metrics) {
+
+	if (options.updateBaseline) {
+		std::ofstream file(options.baselinePath);
+		file << "#name milliseconds, written by --baseline-update" << std::endl;
+		file << std::setprecision(6);
+		for (const Metric &metric : metrics) {
+			file << metric.name << " " << metric.milliseconds << std::endl;
+		}
+		if (!file) {
+			throw std::runtime_error("failed to write baseline " + options.baselinePath + "!");
+		}
+		std::cout << "Baseline: updated " << options.baselinePath << std::endl;
+		return true;
+	}
+
+	std::ifstream file(options.baselinePath);
+	if (!file) {
+		std::cout << "Baseline: cannot open " << options.baselinePath << std::endl;
+		return false;
+	}
+
+	//Sub-millisecond steps are noise, a regression must also exceed this in absolute terms
+	const double minimumRegressionMs = 0.5;
+
+	bool passed = true;
+	std::string line;
+	std::cout << "Baseline " << options.baselinePath << ":" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		Metric baseline;
+		if (!(fields >> baseline.name >> baseline.milliseconds)) {
+			continue;
+		}
+
+		std::vector<Metric>::const_iterator current = std::find_if(metrics.begin(), metrics.end(),
+			[&baseline](const Metric &metric) { return metric.name == baseline.name; });
+		if (current == metrics.end()) {
+			std::cout << "  " << std::left << std::setw(32) << baseline.name << std::right << " not measured in this run" << std::endl;
+			continue;
+		}
+
+		double allowedPercent = baseline.name.compare(0, 6, "frame.") == 0 ? options.maxFrameRegressionPercent : options.maxStartupRegressionPercent;
+		double limit = baseline.milliseconds * (1.0 + allowedPercent / 100.0);
+		bool regressed = current->milliseconds > limit && current->milliseconds - baseline.milliseconds > minimumRegressionMs;
+		passed = passed && !regressed;
+
+		std::cout << "  " << std::left << std::setw(32) << baseline.name << std::right << std::setw(10) << current->milliseconds
+			<< " ms, baseline " << std::setw(10) << baseline.milliseconds << " ms, limit " << std::setw(10) << limit << " ms"
+			<< (regressed ? "  REGRESSED" : "") << std::endl;
+	}
+	std::cout << std::defaultfloat;
+
+	std::cout << "Baseline: " << (passed ? "pass" : "FAIL") << std::endl;
+	return passed;
+}
+
+bool finishRegressionRun(RegressionRun *run, const LatencySummary &latency, const StartupTimer &startup) {
+
+	bool passed = true;
+
+	if (!run->options.goldenPath.empty()) {
+		passed = checkGolden(run) && passed;
+	}
+	if (!run->options.baselinePath.empty()) {
+		passed = checkBaseline(run->options, collectMetrics(latency, startup)) && passed;
+	}
+
+	return passed;
+}
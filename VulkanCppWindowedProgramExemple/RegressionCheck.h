@@ -0,0 +1,57 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FrameCapture.h"
+#include "LatencyStats.h"
+#include "StartupTimer.h"
+
+//Correctness and performance regression run, set from the command line. Meant for unattended runs
+//on a software rasterizer, e.g. --device=llvmpipe --offscreen --frames=600: nothing is presented,
+//so frame times measure the renderer and not the display, and no display is needed.
+//  --golden=FILE.png              compare one presented frame against this image
+//  --golden-frame=N               frame compared, counting from 0, the last of --frames by default
+//  --golden-tolerance=N           per channel difference ignored, 2 by default
+//  --golden-max-differing=F       fraction of pixels allowed beyond the tolerance, 0.001 by default
+//  --golden-update                write the frame as the new golden image instead of comparing
+//  --baseline=FILE                frame time and startup step timings of a reference run
+//  --baseline-update              write this run's timings as the new baseline instead of comparing
+//  --max-frame-regression=PCT     allowed frame time increase over the baseline, 10 by default
+//  --max-startup-regression=PCT   allowed startup step increase over the baseline, 25 by default
+//A failed comparison makes the program exit with EXIT_FAILURE, a differing frame is written
+//next to the golden image as FILE.actual.png along with FILE.diff.png.
+//--golden-frame not given: frame 0 is a valid choice, so "unset" needs a value of its own
+const uint64_t GOLDEN_LAST_FRAME = UINT64_MAX;
+
+struct RegressionOptions {
+	std::string goldenPath;
+	uint64_t goldenFrame = GOLDEN_LAST_FRAME;
+	uint32_t tolerance = 2;
+	double maxDifferingFraction = 0.001;
+	bool updateGolden = false;
+
+	std::string baselinePath;
+	bool updateBaseline = false;
+	double maxFrameRegressionPercent = 10.0;
+	double maxStartupRegressionPercent = 25.0;
+};
+
+struct RegressionRun {
+	RegressionOptions options;
+
+	//Filled on a capture worker, read once the renderer is destroyed
+	std::mutex frameMutex;
+	std::vector<uint8_t> frame; //RGB
+	VkExtent2D frameExtent = {};
+	bool frameCaptured = false;
+};
+
+RegressionOptions parseRegressionOptions(int argc, char *argv[]);
+
+//Takes over the capture options so the golden frame is read back, before the renderer is created
+void prepareRegressionRun(RegressionRun *run, FrameCapture *capture, uint64_t frameLimit);
+//Compares the frame and the timings, or writes them with the update flags.
+//False when a threshold was exceeded, true when nothing was requested.
+bool finishRegressionRun(RegressionRun *run, const LatencySummary &latency, const StartupTimer &startup);
@@ -0,0 +1,84 @@
+#include "RenderEvents.h"
+#include <thread>
+
+bool translateEvent(const SDL_Event &event, RenderEvent *renderEvent) {
+
+	renderEvent->time = std::chrono::steady_clock::now();
+
+	switch (event.type) {
+
+	case SDL_QUIT:
+		renderEvent->type = RenderEvent::QUIT;
+		return true;
+
+	case SDL_KEYDOWN:
+		renderEvent->type = RenderEvent::INPUT;
+		renderEvent->windowId = event.key.windowID;
+		return true;
+
+	case SDL_MOUSEBUTTONDOWN:
+		renderEvent->type = RenderEvent::INPUT;
+		renderEvent->windowId = event.button.windowID;
+		return true;
+
+	case SDL_MOUSEMOTION:
+		renderEvent->type = RenderEvent::INPUT;
+		renderEvent->windowId = event.motion.windowID;
+		return true;
+
+	case SDL_WINDOWEVENT:
+		renderEvent->windowId = event.window.windowID;
+		switch (event.window.event) {
+		case SDL_WINDOWEVENT_CLOSE:
+			//With several windows SDL_QUIT only follows the last one, closing any window ends the program
+			renderEvent->type = RenderEvent::QUIT;
+			return true;
+		case SDL_WINDOWEVENT_SIZE_CHANGED:
+			renderEvent->type = RenderEvent::RESIZE;
+			renderEvent->width = event.window.data1;
+			renderEvent->height = event.window.data2;
+			return true;
+		case SDL_WINDOWEVENT_MINIMIZED:
+			renderEvent->type = RenderEvent::MINIMIZED;
+			return true;
+		case SDL_WINDOWEVENT_RESTORED:
+			renderEvent->type = RenderEvent::RESTORED;
+			return true;
+		case SDL_WINDOWEVENT_EXPOSED:
+			renderEvent->type = RenderEvent::EXPOSED;
+			return true;
+		default:
+			return false;
+		}
+
+	default:
+		return false;
+	}
+}
+
+bool pushRenderEvent(RenderEventQueue *queue, const RenderEvent &renderEvent, const std::atomic<bool> &consumerRunning) {
+
+	while (!queue->tryPush(renderEvent)) {
+		if (renderEvent.type == RenderEvent::INPUT || !consumerRunning.load(std::memory_order_acquire)) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+void wakeRenderer(RenderWakeup *wakeup) {
+
+	{
+		std::lock_guard<std::mutex> lock(wakeup->mutex);
+		wakeup->pending = true;
+	}
+	wakeup->condition.notify_one();
+}
+
+void waitForWakeup(RenderWakeup *wakeup, std::chrono::milliseconds timeout) {
+
+	std::unique_lock<std::mutex> lock(wakeup->mutex);
+	wakeup->condition.wait_for(lock, timeout, [wakeup]() { return wakeup->pending; });
+	wakeup->pending = false;
+}
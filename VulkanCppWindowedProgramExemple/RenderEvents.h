@@ -0,0 +1,41 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "SpscQueue.h"
+
+//Window events forwarded by the thread owning SDL to the thread owning the Vulkan device
+struct RenderEvent {
+	enum Type { QUIT, RESIZE, MINIMIZED, RESTORED, EXPOSED, INPUT };
+
+	Type type = INPUT;
+	//When the event was read from SDL, input-to-present latency starts here
+	std::chrono::steady_clock::time_point time;
+	//SDL window the event happened in, 0 when not tied to a window
+	uint32_t windowId = 0;
+	int32_t width = 0;
+	int32_t height = 0;
+};
+
+typedef SpscQueue<RenderEvent, 256> RenderEventQueue;
+
+//false for SDL events the renderer does not care about
+bool translateEvent(const SDL_Event &event, RenderEvent *renderEvent);
+//Input events are dropped when the queue is full (the oldest pending input already defines the latency),
+//other events wait for the consumer to make room while it is still running
+bool pushRenderEvent(RenderEventQueue *queue, const RenderEvent &renderEvent, const std::atomic<bool> &consumerRunning);
+
+//Lets a render thread with nothing to present sleep until the event thread pushed something.
+//Only used on demand: a continuously drawing render thread polls the queue between frames.
+struct RenderWakeup {
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool pending = false;
+};
+
+void wakeRenderer(RenderWakeup *wakeup);
+//Returns at once if woken since the last wait, otherwise at the next wake or after the timeout
+void waitForWakeup(RenderWakeup *wakeup, std::chrono::milliseconds timeout);
@@ -0,0 +1,1471 @@
+#include "Renderer.h"
+#include "MeshFormat.h"
+#include "ShaderFile.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+//Damage rectangles kept per present before they are merged into their bounds
+static const size_t MAX_DAMAGE_RECTS = 16;
+
+//Capture follows the primary window only
+static bool isPrimaryWindow(const Renderer &renderer, const RenderWindow *window) {
+	return window == &renderer.windows[0];
+}
+
+//Layout drawing leaves a finished image in: PRESENT_SRC for the presentation engine,
+//TRANSFER_SRC offscreen where only the capture copy reads it
+static VkImageLayout presentLayout(const Renderer &renderer) {
+	return renderer.policy.offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+//What a surface would report for images the renderer makes itself: the window's size, a format
+//every device can render to and blit, and the usages the capture and dynamic resolution need
+static SwapChainSupportDetails offscreenSupport(const RenderWindow &window) {
+
+	SwapChainSupportDetails details;
+	details.capabilities = {};
+	details.capabilities.minImageCount = 2;
+	details.capabilities.maxImageCount = 0;
+	details.capabilities.currentExtent = window.windowExtent;
+	details.capabilities.minImageExtent = window.windowExtent;
+	details.capabilities.maxImageExtent = window.windowExtent;
+	details.capabilities.maxImageArrayLayers = 1;
+	details.capabilities.supportedTransforms = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	details.capabilities.currentTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	details.capabilities.supportedCompositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	details.capabilities.supportedUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	details.formats = { { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR } };
+	details.presentsModes = { VK_PRESENT_MODE_FIFO_KHR };
+	return details;
+}
+
+const SwapChainSupportDetails &windowSurfaceSupport(const Renderer &renderer, RenderWindow *window) {
+
+	if (!window->surfaceSupportValid) {
+		if (renderer.policy.offscreen) {
+			window->surfaceSupport = offscreenSupport(*window);
+		}
+		else {
+			window->surfaceSupport = querySwapChainSupport(renderer.physicalDevice, window->surface);
+		}
+		window->surfaceSupportValid = true;
+	}
+	return window->surfaceSupport;
+}
+
+static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats) {
+
+	for (const auto& availableFormat : availableFormats) {
+		if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			return availableFormat;
+		}
+	}
+
+	return availableFormats[0];
+}
+
+static VkExtent2D chooseSwapExtent(const RenderWindow &window, const VkSurfaceCapabilitiesKHR &capabilities) {
+
+	//The surface dictates its size unless it reports the special value
+	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+		return capabilities.currentExtent;
+	}
+
+	//Last size reported by SDL, the render thread must not query the window itself
+	VkExtent2D actualExtent = window.windowExtent;
+
+	actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
+	actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
+
+	return actualExtent;
+}
+
+static uint32_t findImageMemoryType(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeBits) {
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) != 0 && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0) {
+			return i;
+		}
+	}
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) != 0) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find a memory type for the offscreen images!");
+}
+
+//Offscreen stand-in for the swap chain: imageCount images of the window's format and extent, handed out in turn
+static void createOffscreenImages(Renderer *renderer, RenderWindow *window, uint32_t imageCount, VkImageUsageFlags usage) {
+
+	VkDevice device = renderer->device;
+	window->swapChainImages.resize(imageCount);
+	window->swapChainMemory.resize(imageCount);
+	window->nextImage = 0;
+
+	for (uint32_t i = 0; i < imageCount; i++) {
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = window->swapChainImageFormat;
+		imageInfo.extent = { window->swapChainExtent.width, window->swapChainExtent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, vulkanAllocator(), &window->swapChainImages[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen image!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, window->swapChainImages[i], &requirements);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = findImageMemoryType(renderer->capabilities->memoryProperties, requirements.memoryTypeBits);
+
+		if (vkAllocateMemory(device, &allocInfo, vulkanAllocator(), &window->swapChainMemory[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate offscreen image memory!");
+		}
+		vkBindImageMemory(device, window->swapChainImages[i], window->swapChainMemory[i], 0);
+	}
+}
+
+//Nothing presents them: once the submissions rendering to them completed they can go
+static void destroyOffscreenImages(Renderer *renderer, RenderWindow *window) {
+
+	for (size_t i = 0; i < window->swapChainImages.size(); i++) {
+		vkDestroyImage(renderer->device, window->swapChainImages[i], vulkanAllocator());
+		vkFreeMemory(renderer->device, window->swapChainMemory[i], vulkanAllocator());
+	}
+	window->swapChainImages.clear();
+	window->swapChainMemory.clear();
+}
+
+//Create Swap Chain (buffer of rendu "frameBuffer"), oldSwapChain hands the surface over on recreation.
+//Offscreen the images are created in place of the swap chain.
+static void createSwapChain(Renderer *renderer, RenderWindow *window, VkSwapchainKHR oldSwapChain) {
+
+	const SwapChainSupportDetails &swapChainSupport = windowSurfaceSupport(*renderer, window);
+
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+	//Preference order of the frame policy, falls back to FIFO
+	VkPresentModeKHR presentMode = choosePresentMode(renderer->policy, swapChainSupport.presentsModes);
+	VkExtent2D extent = chooseSwapExtent(*window, swapChainSupport.capabilities);
+
+	uint32_t imageCount = chooseImageCount(renderer->policy, swapChainSupport.capabilities);
+
+	VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	//Captured frames are copied out of the presented image
+	if (renderer->capture.active && isPrimaryWindow(*renderer, window)) {
+		imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+	//The scene is blitted in rather than drawn
+	if (window->resolution.active) {
+		imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
+	window->swapChainImageFormat = surfaceFormat.format;
+	window->swapChainExtent = extent;
+
+	if (renderer->policy.offscreen) {
+		createOffscreenImages(renderer, window, imageCount, imageUsage);
+		return;
+	}
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = window->surface;
+
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.imageExtent = extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = imageUsage;
+
+	//Exclusive even with a separate present family: ownership is transferred explicitly
+	createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = presentMode;
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = oldSwapChain;
+
+	if (vkCreateSwapchainKHR(renderer->device, &createInfo, vulkanAllocator(), &window->swapChain) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create swap chain!");
+	}
+
+	vkGetSwapchainImagesKHR(renderer->device, window->swapChain, &imageCount, nullptr);
+	window->swapChainImages.resize(imageCount);
+	vkGetSwapchainImagesKHR(renderer->device, window->swapChain, &imageCount, window->swapChainImages.data());
+}
+
+static void createImageViews(Renderer *renderer, RenderWindow *window) {
+
+	window->swapChainImageViews.resize(window->swapChainImages.size());
+
+	for (size_t i = 0; i < window->swapChainImages.size(); i++) {
+
+		VkImageViewCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = window->swapChainImages[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = window->swapChainImageFormat;
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(renderer->device, &createInfo, vulkanAllocator(), &window->swapChainImageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create ImageView");
+		}
+	}
+}
+
+static void createRenderPass(Renderer *renderer, RenderWindow *window) {
+
+	//Dynamic rendering begins directly on the image views
+	if (renderer->dynamicRendering) {
+		return;
+	}
+
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = window->swapChainImageFormat;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = presentLayout(*renderer);
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+
+	VkSubpassDependency dependency = {};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = 0;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+
+	if (vkCreateRenderPass(renderer->device, &renderPassInfo, vulkanAllocator(), &window->renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create render pass!");
+	}
+}
+
+//The window's pipeline: the fallback until the real state compiled or failed to, from then on the cached result
+static VkPipeline windowPipeline(Renderer *renderer, RenderWindow *window) {
+
+	if (!window->pipelineSettled) {
+		window->pipeline = requestPipeline(renderer->jobSystem, &renderer->pipelineCache, window->pipelineState, window->renderPass,
+			window->fallbackPipeline, &window->pipelineSettled);
+	}
+	return window->pipeline;
+}
+
+//Pipelines for the window's render pass format. The fallback is the same state with the shaders' default
+//constants, compiled now and shared by every variant (a cache hit unless the format is new). A variant is
+//queued on a worker and picked up by drawFrame once ready; the default variant is the fallback itself.
+//Windows of the same format share both pipelines through the cache.
+static void preparePipelines(Renderer *renderer, RenderWindow *window) {
+
+	window->pipelineState = renderer->graphicsPipelineState;
+	window->pipelineState.colorFormat = window->swapChainImageFormat;
+
+	PipelineState fallbackState = window->pipelineState;
+	fallbackState.specializationEntries.clear();
+	fallbackState.specializationData.clear();
+	window->fallbackPipeline = getPipelineNow(&renderer->pipelineCache, fallbackState, window->renderPass);
+
+	window->pipeline = window->fallbackPipeline;
+	window->pipelineSettled = fallbackState == window->pipelineState;
+	//Queues the variant's compile
+	windowPipeline(renderer, window);
+}
+
+//Shaders, layout and fixed state shared by every window, the windows add their format in preparePipelines
+static void createGraphicsPipeline(Renderer *renderer) {
+
+	//Both shader files load in parallel
+	std::vector<char> vertShaderCode;
+	std::vector<char> fragShaderCode;
+	JobCounter shaderFiles;
+	//The mesh reads its placement and tint from the bindless heap when it got a slot there
+	const char *vertShaderPath = "shaders/vert.spv";
+	if (renderer->mesh.loaded) {
+		vertShaderPath = renderer->mesh.drawSlot != BINDLESS_INVALID_SLOT ? "shaders/mesh_bindless_vert.spv" : "shaders/mesh_vert.spv";
+	}
+	spawnJob(renderer->jobSystem, &shaderFiles, [&vertShaderCode, vertShaderPath]() { vertShaderCode = readfile(vertShaderPath); });
+	spawnJob(renderer->jobSystem, &shaderFiles, [&fragShaderCode]() { fragShaderCode = readfile("shaders/frag.spv"); });
+	waitForCounter(renderer->jobSystem, &shaderFiles);
+
+	createPipelineStateCache(renderer->device, &renderer->pipelineCache);
+
+	//Every pipeline shares the bindless layout, so one bound set serves all of them
+	VkPushConstantRange pushConstantRange = bindlessPushConstantRange();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	if (renderer->bindless) {
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &renderer->bindlessHeap.layout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	}
+
+	if (vkCreatePipelineLayout(renderer->device, &pipelineLayoutInfo, vulkanAllocator(), &renderer->pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	//Triangle list, back face culling, no blending, no depth: the PipelineState defaults
+	PipelineState &state = renderer->graphicsPipelineState;
+	state = PipelineState();
+	state.vertexShader = registerShader(&renderer->pipelineCache, vertShaderCode);
+	state.fragmentShader = registerShader(&renderer->pipelineCache, fragShaderCode);
+	state.layout = renderer->pipelineLayout;
+	//The mesh's quantized vertex layout, the triangle has no vertex input. mesh.vert flips Y up source
+	//data to the screen, counter-clockwise triangles of glTF and OBJ stay counter-clockwise on screen.
+	if (renderer->mesh.loaded) {
+		meshVertexInput(&state.vertexBindings, &state.vertexAttributes);
+		state.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	}
+	//The default variant keeps the shaders' own constants, the fallback pipeline then is the real one
+	if (!isDefaultTriangleVariant(renderer->variant)) {
+		specializePipeline(&state, renderer->variant);
+	}
+	std::cout << "Shader variant: " << describeTriangleVariant(renderer->variant) << std::endl;
+}
+
+//The scene's draw packets, sorted once: the command buffers are recorded from the queue
+static void createSceneDraws(Renderer *renderer) {
+
+	loadDrawRecorder(renderer->device, &renderer->drawRecorder);
+
+	clearDrawQueue(&renderer->drawQueue);
+
+	const SceneMesh &mesh = renderer->mesh;
+	if (mesh.loaded) {
+		DrawPacket packet;
+		packet.pipelineIndex = 0;
+		packet.vertexBuffer = mesh.buffer;
+		packet.indexBuffer = mesh.buffer;
+		packet.indexOffset = mesh.indexOffset;
+		packet.indexType = mesh.indexType;
+		packet.indexCount = mesh.indexCount;
+		if (mesh.drawSlot != BINDLESS_INVALID_SLOT) {
+			packet.constants.bufferIndex = mesh.drawSlot;
+		}
+		pushDraw(&renderer->drawQueue, packet, 0, 0, 0);
+	}
+	else {
+		//The triangle, its vertices come from the vertex shader
+		DrawPacket triangle;
+		triangle.pipelineIndex = 0;
+		triangle.vertexCount = 3;
+		pushDraw(&renderer->drawQueue, triangle, 0, 0, 0);
+	}
+
+	sortDrawQueue(&renderer->drawQueue);
+}
+
+//Pixels of the window's image the scene's draws may cover, with the fallback's default constants or the
+//variant's: only these change when one pipeline replaces the other, the clear color around them stays.
+//The triangle's vertices of shader.vert, or the mesh's unit cube placed by its draw data, in clip space.
+static VkRect2D sceneBounds(const Renderer &renderer, const RenderWindow &window) {
+
+	float scale = std::max(1.0f, std::abs(renderer.variant.scale));
+	float half = 0.5f * scale;
+	float centerX = 0.0f;
+	float centerY = 0.0f;
+	if (renderer.mesh.loaded) {
+		const MeshDrawData &data = renderer.mesh.drawData;
+		half = scale * std::abs(data.placement[2]);
+		centerX = data.placement[0];
+		centerY = data.placement[1];
+	}
+
+	//Rasterization rounding and the dynamic resolution upscale filter reach a pixel further
+	const float margin = 2.0f;
+	float width = static_cast<float>(window.swapChainExtent.width);
+	float height = static_cast<float>(window.swapChainExtent.height);
+	float left = std::floor((centerX - half + 1.0f) * 0.5f * width - margin);
+	float top = std::floor((centerY - half + 1.0f) * 0.5f * height - margin);
+	float right = std::ceil((centerX + half + 1.0f) * 0.5f * width + margin);
+	float bottom = std::ceil((centerY + half + 1.0f) * 0.5f * height + margin);
+
+	//markDamage clips to the image
+	left = std::max(left, -1.0f);
+	top = std::max(top, -1.0f);
+	right = std::min(right, width + 1.0f);
+	bottom = std::min(bottom, height + 1.0f);
+	VkRect2D rect = {};
+	if (right <= left || bottom <= top) {
+		return rect;
+	}
+	rect.offset = { static_cast<int32_t>(left), static_cast<int32_t>(top) };
+	rect.extent = { static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top) };
+	return rect;
+}
+
+static void createFrameBuffers(Renderer *renderer, RenderWindow *window) {
+
+	if (renderer->dynamicRendering) {
+		return;
+	}
+
+	window->swapChainFramebuffers.resize(window->swapChainImageViews.size());
+
+	for (size_t i = 0; i < window->swapChainImageViews.size(); i++) {
+		VkImageView attachments[] = {
+			window->swapChainImageViews[i]
+		};
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = window->renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = window->swapChainExtent.width;
+		framebufferInfo.height = window->swapChainExtent.height;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(renderer->device, &framebufferInfo, vulkanAllocator(), &window->swapChainFramebuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create framebuffer!");
+		}
+	}
+}
+
+//Ownership acquire barriers are recorded for the present family, drawing uses the per image pools
+static void createCommandPool(Renderer *renderer) {
+
+	if (!renderer->separatePresentQueue) {
+		return;
+	}
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = renderer->presentFamilyIndex;
+
+	if (vkCreateCommandPool(renderer->device, &poolInfo, vulkanAllocator(), &renderer->presentCommandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create present command pool!");
+	}
+}
+
+//Queue family ownership transfer of a swap chain image from graphics to present.
+//Drawing already left the image in PRESENT_SRC, so both halves keep the layout.
+//The release waits on the last write: the color attachment, or the upscale blit with dynamic resolution.
+static void recordOwnershipTransfer(const Renderer &renderer, VkCommandBuffer commandBuffer, VkImage image, bool release, bool upscaled) {
+
+	VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkAccessFlags srcAccess = 0;
+	if (release) {
+		srcStage = upscaled ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		srcAccess = upscaled ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	}
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	barrier.srcQueueFamilyIndex = renderer.graphicsFamilyIndex;
+	barrier.dstQueueFamilyIndex = renderer.presentFamilyIndex;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//Swap chain image layout transition, what the render pass's initial/final layouts and external dependency did
+static void transitionSwapChainImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//Into the swap chain image, or the scene target with dynamic resolution
+static void beginDynamicRendering(const Renderer &renderer, const RenderWindow &window, VkCommandBuffer commandBuffer, VkImage image, VkImageView view,
+	VkExtent2D extent, const VkClearValue &clearColor) {
+
+	//Same stage as the acquire semaphore wait: the presentation engine is done reading the image.
+	//A scene target was last read by the previous blit of this image.
+	transitionSwapChainImage(commandBuffer, image,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		0, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | (window.resolution.active ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0),
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+	VkRenderingAttachmentInfoKHR colorAttachment = {};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+	colorAttachment.imageView = view;
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.clearValue = clearColor;
+
+	VkRenderingInfoKHR renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = extent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+
+	renderer.cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+static void endDynamicRendering(const Renderer &renderer, const RenderWindow &window, VkCommandBuffer commandBuffer, VkImage image) {
+
+	renderer.cmdEndRendering(commandBuffer);
+
+	if (window.resolution.active) {
+		//The scene target is blitted next, the layout the scene render pass ends in
+		transitionSwapChainImage(commandBuffer, image,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		return;
+	}
+
+	//Present (and the capture copy) expect the layout the render pass ends in
+	transitionSwapChainImage(commandBuffer, image,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, presentLayout(renderer),
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
+
+static void recordCommandBuffer(Renderer *renderer, RenderWindow *window, size_t imageIndex, VkPipeline pipeline) {
+
+	VkCommandBuffer commandBuffer = window->commandBuffers[imageIndex];
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
+
+	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	//Dynamic resolution draws the scene into the image's target at the current scale
+	DynamicResolution &resolution = window->resolution;
+	VkExtent2D renderExtent = window->swapChainExtent;
+	VkImage renderImage = window->swapChainImages[imageIndex];
+	VkImageView renderView = window->swapChainImageViews[imageIndex];
+	if (resolution.active) {
+		beginSceneTimer(resolution, commandBuffer, imageIndex);
+		renderExtent = sceneExtent(resolution, window->swapChainExtent);
+		renderImage = resolution.targets[imageIndex].image;
+		renderView = resolution.targets[imageIndex].view;
+	}
+
+	if (renderer->dynamicRendering) {
+		beginDynamicRendering(*renderer, *window, commandBuffer, renderImage, renderView, renderExtent, clearColor);
+	}
+	else {
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = resolution.active ? resolution.renderPass : window->renderPass;
+		renderPassInfo.framebuffer = resolution.active ? resolution.targets[imageIndex].framebuffer : window->swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = renderExtent;
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	//Bound once for the command buffer, each draw only pushes its resource indices
+	if (renderer->bindless) {
+		bindBindlessHeap(renderer->bindlessHeap, commandBuffer, renderer->pipelineLayout);
+	}
+
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)renderExtent.width;
+	viewport.height = (float)renderExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = renderExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	//The window's pipeline is the only entry of the table
+	DrawRecordTarget target;
+	target.pipelines = &pipeline;
+	target.layout = renderer->pipelineLayout;
+	target.descriptorSetIndex = renderer->bindless ? 1 : 0;
+	target.constantStages = renderer->bindless ? bindlessPushConstantRange().stageFlags : 0;
+	recordDrawQueue(renderer->drawRecorder, renderer->drawQueue, commandBuffer, target, &window->recordedBindStats[imageIndex]);
+
+	if (renderer->dynamicRendering) {
+		endDynamicRendering(*renderer, *window, commandBuffer, renderImage);
+	}
+	else {
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	if (resolution.active) {
+		recordUpscale(resolution, commandBuffer, imageIndex, window->swapChainImages[imageIndex], presentLayout(*renderer), renderExtent, window->swapChainExtent);
+	}
+
+	if (renderer->separatePresentQueue) {
+		recordOwnershipTransfer(*renderer, commandBuffer, window->swapChainImages[imageIndex], true, resolution.active);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+
+	window->recordedPipelines[imageIndex] = pipeline;
+	window->recordedExtents[imageIndex] = renderExtent;
+}
+
+static void createCommandeBuffers(Renderer *renderer, RenderWindow *window) {
+
+	size_t imageCount = window->swapChainImages.size();
+	window->commandBuffers.resize(imageCount);
+	window->recordCommandPools.resize(imageCount);
+	window->recordedPipelines.assign(imageCount, VK_NULL_HANDLE);
+	window->recordedExtents.assign(imageCount, VkExtent2D());
+	window->recordedBindStats.assign(imageCount, DrawBindStats());
+
+	VkPipeline pipeline = windowPipeline(renderer, window);
+
+	//Each image has its own pool: a pool and its buffers are externally synchronized,
+	//separate pools let the workers record in parallel
+	parallelFor(renderer->jobSystem, static_cast<uint32_t>(imageCount), 1, [renderer, window, pipeline](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = renderer->graphicsFamilyIndex;
+
+			if (vkCreateCommandPool(renderer->device, &poolInfo, vulkanAllocator(), &window->recordCommandPools[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = window->recordCommandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(renderer->device, &allocInfo, &window->commandBuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+
+			recordCommandBuffer(renderer, window, i, pipeline);
+		}
+	});
+}
+
+//Present family side of the ownership transfer, one command buffer and semaphore per image
+static void createPresentCommandBuffers(Renderer *renderer, RenderWindow *window) {
+
+	if (!renderer->separatePresentQueue) {
+		return;
+	}
+
+	size_t imageCount = window->swapChainImages.size();
+	window->presentCommandBuffers.resize(imageCount);
+	window->presentOwnershipSemaphores.resize(imageCount);
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = renderer->presentCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = (uint32_t)imageCount;
+
+	if (vkAllocateCommandBuffers(renderer->device, &allocInfo, window->presentCommandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate present command buffers!");
+	}
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < imageCount; i++) {
+		if (vkCreateSemaphore(renderer->device, &semaphoreInfo, vulkanAllocator(), &window->presentOwnershipSemaphores[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create semaphores!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+		if (vkBeginCommandBuffer(window->presentCommandBuffers[i], &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
+
+		recordOwnershipTransfer(*renderer, window->presentCommandBuffers[i], window->swapChainImages[i], false, false);
+
+		if (vkEndCommandBuffer(window->presentCommandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+	}
+}
+
+//Everything in the submit and present infos that does not change from frame to frame, sized for
+//every window acquiring at once. Depends on the frame sync (timeline or not), rebuilt whenever it is recreated.
+static void prepareFrameSubmission(Renderer *renderer) {
+
+	Renderer::FrameSubmission &submission = renderer->submission;
+	submission = Renderer::FrameSubmission();
+
+	size_t windowCount = renderer->windows.size();
+	submission.waitSemaphores.resize(windowCount);
+	submission.waitStages.assign(windowCount, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	//One more for the capture copy, or the timeline semaphore
+	submission.commandBuffers.resize(windowCount + 1);
+	submission.signalSemaphores.resize(windowCount + 1);
+	submission.signalValues.resize(windowCount + 1);
+
+	//The binary semaphores' values are ignored
+	submission.timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	submission.timelineInfo.pSignalSemaphoreValues = submission.signalValues.data();
+
+	VkSubmitInfo &submitInfo = submission.submitInfo;
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = renderer->frameSync.timeline ? &submission.timelineInfo : nullptr;
+	submitInfo.pWaitSemaphores = submission.waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = submission.waitStages.data();
+	submitInfo.pCommandBuffers = submission.commandBuffers.data();
+	submitInfo.pSignalSemaphores = submission.signalSemaphores.data();
+
+	//Separate present family: acquire each image on the present queue once rendering finished
+	submission.ownershipWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	submission.ownershipInfos.resize(windowCount);
+	for (size_t i = 0; i < windowCount; i++) {
+		VkSubmitInfo &ownershipInfo = submission.ownershipInfos[i];
+		ownershipInfo = VkSubmitInfo();
+		ownershipInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		ownershipInfo.waitSemaphoreCount = 1;
+		ownershipInfo.pWaitSemaphores = &submission.signalSemaphores[i];
+		ownershipInfo.pWaitDstStageMask = &submission.ownershipWaitStage;
+		ownershipInfo.commandBufferCount = 1;
+		ownershipInfo.signalSemaphoreCount = 1;
+	}
+
+	submission.windowIndices.resize(windowCount);
+	submission.pipelines.resize(windowCount);
+	submission.presentWaitSemaphores.resize(windowCount);
+	submission.swapChains.resize(windowCount);
+	submission.imageIndices.resize(windowCount);
+	submission.presentResults.resize(windowCount);
+	submission.presentRegions.resize(windowCount);
+
+	VkPresentInfoKHR &presentInfo = submission.presentInfo;
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.pWaitSemaphores = submission.presentWaitSemaphores.data();
+	presentInfo.pSwapchains = submission.swapChains.data();
+	presentInfo.pImageIndices = submission.imageIndices.data();
+	presentInfo.pResults = submission.presentResults.data();
+
+	//Chained by drawFrame when a window's frame only changed inside its damage rectangles
+	submission.presentRegionsInfo.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+	submission.presentRegionsInfo.pRegions = submission.presentRegions.data();
+}
+
+//Frames in flight, 1 to 4 frames from the frame policy
+//Synchronisation GPU //CPU work use a timeline semaphore value per submission, fences as fallback
+static void createSyncObjects(Renderer *renderer) {
+
+	createFrameSync(renderer->device, renderer->timelineSemaphore, renderer->policy.framesInFlight, &renderer->frameSync);
+	for (RenderWindow &window : renderer->windows) {
+		createSwapChainSync(renderer->device, renderer->policy.framesInFlight, static_cast<uint32_t>(window.swapChainImages.size()), &window.sync);
+	}
+	renderer->currentFrame = 0;
+
+	prepareFrameSubmission(renderer);
+}
+
+//Everything sized by the swap chain but the swap chain itself, kept as the old swap chain of its replacement
+static void cleanupSwapChain(Renderer *renderer, RenderWindow *window) {
+
+	VkDevice device = renderer->device;
+
+	for (size_t i = 0; i < window->swapChainFramebuffers.size(); i++) {
+		vkDestroyFramebuffer(device, window->swapChainFramebuffers[i], vulkanAllocator());
+	}
+
+	//Destroying the per-image pools frees their command buffers
+	for (size_t i = 0; i < window->recordCommandPools.size(); i++) {
+		vkDestroyCommandPool(device, window->recordCommandPools[i], vulkanAllocator());
+	}
+	window->recordCommandPools.clear();
+
+	if (renderer->separatePresentQueue) {
+		vkFreeCommandBuffers(device, renderer->presentCommandPool, static_cast<uint32_t>(window->presentCommandBuffers.size()), window->presentCommandBuffers.data());
+		for (size_t i = 0; i < window->presentOwnershipSemaphores.size(); i++) {
+			vkDestroySemaphore(device, window->presentOwnershipSemaphores[i], vulkanAllocator());
+		}
+		window->presentCommandBuffers.clear();
+		window->presentOwnershipSemaphores.clear();
+	}
+
+	//Pipelines outlive the swap chain: viewport and scissor are dynamic, the render pass is only compatibility
+	if (window->renderPass != VK_NULL_HANDLE) {
+		vkDestroyRenderPass(device, window->renderPass, vulkanAllocator());
+		window->renderPass = VK_NULL_HANDLE;
+	}
+	window->swapChainFramebuffers.clear();
+
+	for (size_t i = 0; i < window->swapChainImageViews.size(); i++) {
+		vkDestroyImageView(device, window->swapChainImageViews[i], vulkanAllocator());
+	}
+	window->swapChainImageViews.clear();
+}
+
+//Decided before the first swap chain, which needs TRANSFER_SRC usage for the copies
+static void createCapture(Renderer *renderer) {
+
+	if (renderer->capture.options.format == CaptureOptions::NONE && !renderer->capture.inspect) {
+		return;
+	}
+
+	const SwapChainSupportDetails &swapChainSupport = windowSurfaceSupport(*renderer, &renderer->windows[0]);
+	const char *reason = captureUnsupportedReason(chooseSwapSurfaceFormat(swapChainSupport.formats).format,
+		swapChainSupport.capabilities.supportedUsageFlags, renderer->separatePresentQueue);
+	if (reason != nullptr) {
+		std::cout << "Capture disabled: " << reason << std::endl;
+		return;
+	}
+
+	createFrameCapture(&renderer->capture, renderer->device, renderer->capabilities->memoryProperties, renderer->graphicsFamilyIndex, renderer->jobSystem);
+}
+
+//Like the capture, decided before the window's first swap chain, which needs TRANSFER_DST usage for the blit.
+//Each window holds its own scale: their GPU times differ with their sizes.
+static void createResolution(Renderer *renderer, RenderWindow *window) {
+
+	window->resolution.options = renderer->resolutionOptions;
+	if (!window->resolution.options.enabled) {
+		return;
+	}
+
+	const SwapChainSupportDetails &swapChainSupport = windowSurfaceSupport(*renderer, window);
+	const char *reason = dynamicResolutionUnsupportedReason(*renderer->capabilities, renderer->graphicsFamilyIndex,
+		chooseSwapSurfaceFormat(swapChainSupport.formats).format, swapChainSupport.capabilities.supportedUsageFlags);
+	if (reason != nullptr) {
+		std::cout << "Dynamic resolution disabled: " << reason << std::endl;
+		return;
+	}
+
+	createDynamicResolution(&window->resolution, renderer->device, *renderer->capabilities, renderer->graphicsFamilyIndex, renderer->policy.targetFrameRate);
+}
+
+void createRenderer(Renderer *renderer) {
+
+	if (renderer->windows.empty()) {
+		throw std::runtime_error("no window to render to!");
+	}
+
+	if (renderer->dynamicRendering) {
+		renderer->cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(renderer->device, "vkCmdBeginRenderingKHR");
+		renderer->cmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(renderer->device, "vkCmdEndRenderingKHR");
+		if (renderer->cmdBeginRendering == nullptr || renderer->cmdEndRendering == nullptr) {
+			throw std::runtime_error("failed to load VK_KHR_dynamic_rendering commands!");
+		}
+	}
+
+	if (renderer->bindless) {
+		createBindlessHeap(&renderer->bindlessHeap, renderer->device, *renderer->capabilities);
+	}
+
+	createCapture(renderer);
+	for (RenderWindow &window : renderer->windows) {
+		createResolution(renderer, &window);
+		createSwapChain(renderer, &window, VK_NULL_HANDLE);
+		createImageViews(renderer, &window);
+		createSceneTargets(&window.resolution, window.swapChainImages.size(), window.swapChainImageFormat, window.swapChainExtent, renderer->dynamicRendering);
+	}
+	markStartupStep(renderer->startupTimer, "createSwapChain");
+	createSceneMesh(&renderer->mesh, renderer->device, renderer->capabilities->memoryProperties, renderer->graphicsQueue, renderer->graphicsFamilyIndex);
+	if (renderer->bindless) {
+		createMeshDrawData(&renderer->mesh, renderer->capabilities->memoryProperties, &renderer->bindlessHeap, MeshDrawData());
+	}
+	createGraphicsPipeline(renderer);
+	createSceneDraws(renderer);
+	for (RenderWindow &window : renderer->windows) {
+		createRenderPass(renderer, &window);
+		preparePipelines(renderer, &window);
+	}
+	markStartupStep(renderer->startupTimer, "createGraphicsPipeline");
+	createCommandPool(renderer);
+	for (RenderWindow &window : renderer->windows) {
+		createFrameBuffers(renderer, &window);
+		createCommandeBuffers(renderer, &window);
+		createPresentCommandBuffers(renderer, &window);
+	}
+	createCaptureTargets(&renderer->capture, renderer->windows[0].swapChainImages, presentLayout(*renderer), renderer->windows[0].swapChainImageFormat, renderer->windows[0].swapChainExtent);
+	markStartupStep(renderer->startupTimer, "createCommandeBuffers");
+	createSyncObjects(renderer);
+	markStartupStep(renderer->startupTimer, "createSyncObjects");
+
+	for (RenderWindow &window : renderer->windows) {
+		window.damage.reserve(MAX_DAMAGE_RECTS);
+	}
+	markSceneDirty(renderer);
+}
+
+void destroyRenderer(Renderer *renderer) {
+
+	vkDeviceWaitIdle(renderer->device);
+	destroyCaptureTargets(&renderer->capture, pollCompletedValue(renderer->device, &renderer->frameSync));
+	destroyFrameCapture(&renderer->capture);
+	for (RenderWindow &window : renderer->windows) {
+		destroySceneTargets(&window.resolution);
+		destroyDynamicResolution(&window.resolution);
+		cleanupSwapChain(renderer, &window);
+		if (renderer->policy.offscreen) {
+			destroyOffscreenImages(renderer, &window);
+		}
+		else {
+			vkDestroySwapchainKHR(renderer->device, window.swapChain, vulkanAllocator());
+			window.swapChain = VK_NULL_HANDLE;
+		}
+	}
+
+	releaseMeshDrawData(&renderer->mesh, &renderer->bindlessHeap, &renderer->frameSync);
+
+	//Clean up render semaphores, fences and pending releases, retired swap chains among them
+	destroyFrameSync(renderer->device, &renderer->frameSync);
+	for (RenderWindow &window : renderer->windows) {
+		destroySwapChainSync(renderer->device, &window.sync);
+	}
+
+	//The frame sync ran the deferred slot frees
+	if (renderer->bindless) {
+		printBindlessReport(&renderer->bindlessHeap);
+		destroyBindlessHeap(&renderer->bindlessHeap);
+	}
+
+	printBindReport(renderer->bindStats, renderer->framesPresented);
+	destroySceneMesh(&renderer->mesh);
+
+	destroyPipelineStateCache(renderer->jobSystem, &renderer->pipelineCache);
+	vkDestroyPipelineLayout(renderer->device, renderer->pipelineLayout, vulkanAllocator());
+
+	if (renderer->presentCommandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(renderer->device, renderer->presentCommandPool, vulkanAllocator());
+	}
+}
+
+//One window's swap chain recreation, every member is replaced in place. Only waits for the
+//submissions that rendered to this window: the other windows keep their frames in flight.
+static void recreateWindowSwapChain(Renderer *renderer, RenderWindow *window) {
+
+	VkDevice device = renderer->device;
+	FrameSync &frameSync = renderer->frameSync;
+
+	waitForValue(device, &frameSync, lastSwapChainValue(window->sync));
+	//Queued compiles use the render pass about to be destroyed
+	waitForPipelineCompiles(renderer->jobSystem, &renderer->pipelineCache);
+	bool primary = isPrimaryWindow(*renderer, window);
+	if (primary) {
+		//Copies recorded for the old images, encodes still read the old buffers
+		destroyCaptureTargets(&renderer->capture, pollCompletedValue(device, &frameSync));
+	}
+	destroySceneTargets(&window->resolution);
+	cleanupSwapChain(renderer, window);
+
+	//Recreation follows a surface change, extent and capabilities must be queried again
+	window->surfaceSupportValid = false;
+
+	if (renderer->policy.offscreen) {
+		//The wait above covered every submission rendering to them
+		destroyOffscreenImages(renderer, window);
+		createSwapChain(renderer, window, VK_NULL_HANDLE);
+	}
+	else {
+		VkSwapchainKHR retiredSwapChain = window->swapChain;
+		createSwapChain(renderer, window, retiredSwapChain);
+		//Its last presents may still be queued behind frames of the other windows: released once the next submission completed
+		releaseAfter(&frameSync, frameSync.lastSubmitted + 1, [device, retiredSwapChain]() {
+			vkDestroySwapchainKHR(device, retiredSwapChain, vulkanAllocator());
+		});
+	}
+
+	resizeSwapChainSync(device, static_cast<uint32_t>(window->swapChainImages.size()), &window->sync);
+	createImageViews(renderer, window);
+	createSceneTargets(&window->resolution, window->swapChainImages.size(), window->swapChainImageFormat, window->swapChainExtent, renderer->dynamicRendering);
+	createRenderPass(renderer, window);
+	preparePipelines(renderer, window);
+	createFrameBuffers(renderer, window);
+	createCommandeBuffers(renderer, window);
+	createPresentCommandBuffers(renderer, window);
+	if (primary) {
+		createCaptureTargets(&renderer->capture, window->swapChainImages, presentLayout(*renderer), window->swapChainImageFormat, window->swapChainExtent);
+	}
+
+	//New images hold nothing yet
+	markWindowDirty(window);
+}
+
+void recreateSwapChains(Renderer *renderer) {
+
+	vkDeviceWaitIdle(renderer->device);
+	for (RenderWindow &window : renderer->windows) {
+		recreateWindowSwapChain(renderer, &window);
+	}
+}
+
+void applyFramePolicy(Renderer *renderer, const FramePolicy &policy) {
+
+	vkDeviceWaitIdle(renderer->device);
+	renderer->policy = policy;
+
+	recreateSwapChains(renderer);
+
+	destroyFrameSync(renderer->device, &renderer->frameSync);
+	for (RenderWindow &window : renderer->windows) {
+		destroySwapChainSync(renderer->device, &window.sync);
+	}
+	createSyncObjects(renderer);
+}
+
+static void retireFrames(Renderer *renderer) {
+
+	//Release resources retired by frames the GPU has finished
+	collectReleases(renderer->device, &renderer->frameSync);
+	uint64_t completedValue = pollCompletedValue(renderer->device, &renderer->frameSync);
+	framesCompleted(renderer->latency, completedValue);
+	//Finished copies go to the encoders, nothing waits on the GPU for them
+	collectCaptures(&renderer->capture, completedValue);
+}
+
+//Drawing, nothing here allocates once the pipelines are compiled.
+//Every window that acquires an image is drawn by one submission and presented by one present call.
+void drawFrame(Renderer *renderer) {
+
+	ThreadAllocations allocationsBefore = threadAllocations();
+	bool swapChainRecreated = false;
+
+	VkDevice device = renderer->device;
+	FrameSync &frameSync = renderer->frameSync;
+	Renderer::FrameSubmission &submission = renderer->submission;
+	size_t currentFrame = renderer->currentFrame;
+
+	//Wait the previous submission of this frame slot
+	waitForValue(device, &frameSync, frameSync.frameValues[currentFrame]);
+
+	uint32_t acquired = 0;
+	for (size_t w = 0; w < renderer->windows.size(); w++) {
+		RenderWindow *window = &renderer->windows[w];
+		//Nothing to present until the window is restored
+		if (window->windowMinimized) {
+			continue;
+		}
+
+		uint32_t imageIndex = window->nextImage;
+		VkResult result = VK_SUCCESS;
+		if (renderer->policy.offscreen) {
+			//Images are handed out in turn, the wait on the image's last submission below is all the acquire there is
+			window->nextImage = (imageIndex + 1) % static_cast<uint32_t>(window->swapChainImages.size());
+		}
+		else {
+			result = vkAcquireNextImageKHR(device, window->swapChain, std::numeric_limits<uint64_t>::max(), window->sync.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		}
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			//The swap chain has become incompatible with the surface and can no longer be used for rendering. Usually happens after a window resize
+			recreateWindowSwapChain(renderer, window);
+			swapChainRecreated = true;
+			continue;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			//Suboptimal can still be used to successfully present to the surface, but the surface properties are no longer matched exactly
+			throw std::runtime_error("Failed to acquire swap chain image!");
+		}
+
+		//Another frame slot may still be rendering to this image
+		waitForValue(device, &frameSync, window->sync.imagesInFlight[imageIndex]);
+		//Its last submission completed, its timestamps steer the render scale
+		measureSceneTime(&window->resolution, imageIndex);
+
+		//Switch from the fallback once the real pipeline compiled, or to the new render scale, the image's commands are idle now
+		VkPipeline pipeline = windowPipeline(renderer, window);
+		//The default variant is its own fallback: only a variant still compiling, or that failed to, counts
+		if (pipeline == window->fallbackPipeline && !window->pipelineState.specializationEntries.empty()) {
+			renderer->pipelineCache.fallbackFrames.fetch_add(1, std::memory_order_relaxed);
+		}
+		VkExtent2D renderExtent = window->resolution.active ? sceneExtent(window->resolution, window->swapChainExtent) : window->swapChainExtent;
+		const VkExtent2D &recordedExtent = window->recordedExtents[imageIndex];
+		bool sameExtent = recordedExtent.width == renderExtent.width && recordedExtent.height == renderExtent.height;
+		if (window->recordedPipelines[imageIndex] != pipeline || !sameExtent) {
+			bool pipelineSwap = sameExtent && window->recordedPipelines[imageIndex] != VK_NULL_HANDLE;
+			vkResetCommandPool(device, window->recordCommandPools[imageIndex], 0);
+			recordCommandBuffer(renderer, window, imageIndex, pipeline);
+			//Another pipeline only changes the pixels under the scene's draws, another scale may change any pixel
+			if (pipelineSwap) {
+				markDamage(window, sceneBounds(*renderer, *window));
+			}
+			else {
+				markWindowDirty(window);
+			}
+		}
+
+		submission.windowIndices[acquired] = w;
+		submission.pipelines[acquired] = pipeline;
+		submission.imageIndices[acquired] = imageIndex;
+		submission.swapChains[acquired] = window->swapChain;
+		submission.waitSemaphores[acquired] = window->sync.imageAvailableSemaphores[currentFrame];
+		submission.commandBuffers[acquired] = window->commandBuffers[imageIndex];
+		submission.signalSemaphores[acquired] = window->sync.renderFinishedSemaphores[imageIndex];
+		submission.presentWaitSemaphores[acquired] = window->sync.renderFinishedSemaphores[imageIndex];
+		acquired++;
+	}
+
+	//Every window minimized or just recreated: nothing was acquired, the frame slot stays as it was
+	if (acquired == 0) {
+		retireFrames(renderer);
+		checkFrameAllocations(renderer->hostAllocator, allocationsBefore, swapChainRecreated);
+		return;
+	}
+
+	uint64_t signalValue = beginSubmit(device, &frameSync, currentFrame);
+	frameSubmitted(renderer->latency, signalValue);
+
+	uint32_t commandBufferCount = acquired;
+	for (uint32_t i = 0; i < acquired; i++) {
+		size_t w = submission.windowIndices[i];
+		renderer->windows[w].sync.imagesInFlight[submission.imageIndices[i]] = signalValue;
+		addBindStats(&renderer->bindStats, renderer->windows[w].recordedBindStats[submission.imageIndices[i]]);
+
+		//The copy runs after the draw on the same queue, its completion is the frame's timeline value
+		if (w == 0) {
+			VkCommandBuffer captureCommands = beginCapture(&renderer->capture, submission.imageIndices[i], signalValue);
+			if (captureCommands != VK_NULL_HANDLE) {
+				submission.commandBuffers[commandBufferCount++] = captureCommands;
+			}
+		}
+	}
+
+	//The timeline semaphore follows the binary ones, offscreen there is no acquire nor present to wait on
+	uint32_t binaryCount = renderer->policy.offscreen ? 0 : acquired;
+	uint32_t signalCount = binaryCount;
+	if (frameSync.timeline) {
+		submission.signalSemaphores[binaryCount] = frameSync.timelineSemaphore;
+		submission.signalValues[binaryCount] = signalValue;
+		signalCount++;
+	}
+	submission.timelineInfo.signalSemaphoreValueCount = signalCount;
+	submission.submitInfo.waitSemaphoreCount = binaryCount;
+	submission.submitInfo.commandBufferCount = commandBufferCount;
+	submission.submitInfo.signalSemaphoreCount = signalCount;
+
+	if (vkQueueSubmit(renderer->graphicsQueue, 1, &submission.submitInfo, submitFence(frameSync, currentFrame)) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit draw command buffer!");
+	}
+
+	if (renderer->separatePresentQueue) {
+		for (uint32_t i = 0; i < acquired; i++) {
+			RenderWindow &window = renderer->windows[submission.windowIndices[i]];
+			uint32_t imageIndex = submission.imageIndices[i];
+			submission.ownershipInfos[i].pCommandBuffers = &window.presentCommandBuffers[imageIndex];
+			submission.ownershipInfos[i].pSignalSemaphores = &window.presentOwnershipSemaphores[imageIndex];
+			submission.presentWaitSemaphores[i] = window.presentOwnershipSemaphores[imageIndex];
+		}
+
+		if (vkQueueSubmit(renderer->presentQueue, acquired, submission.ownershipInfos.data(), VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit ownership transfer!");
+		}
+	}
+
+	VkResult result = VK_SUCCESS;
+	if (renderer->policy.offscreen) {
+		//The frame stays in its image, where the capture copy read it
+		std::fill(submission.presentResults.begin(), submission.presentResults.begin() + acquired, VK_SUCCESS);
+	}
+	else {
+		//Every change since a window's last present was localized, the presentation engine may only update those rectangles.
+		//Windows with full damage present zero rectangles, the whole image.
+		bool partialPresent = false;
+		for (uint32_t i = 0; i < acquired; i++) {
+			const RenderWindow &window = renderer->windows[submission.windowIndices[i]];
+			bool windowPartial = renderer->incrementalPresent && !window.fullDamage && !window.damage.empty();
+			submission.presentRegions[i].rectangleCount = windowPartial ? static_cast<uint32_t>(window.damage.size()) : 0;
+			submission.presentRegions[i].pRectangles = window.damage.data();
+			partialPresent = partialPresent || windowPartial;
+		}
+		submission.presentRegionsInfo.swapchainCount = acquired;
+		submission.presentInfo.pNext = partialPresent ? &submission.presentRegionsInfo : nullptr;
+		submission.presentInfo.waitSemaphoreCount = acquired;
+		submission.presentInfo.swapchainCount = acquired;
+
+		result = vkQueuePresentKHR(renderer->presentQueue, &submission.presentInfo);
+	}
+
+	for (uint32_t i = 0; i < acquired; i++) {
+		RenderWindow &window = renderer->windows[submission.windowIndices[i]];
+		if (!window.fullDamage && !window.damage.empty()) {
+			renderer->usage.localizedPresents++;
+		}
+		window.presentedPipeline = submission.pipelines[i];
+		window.sceneDirty = false;
+		window.fullDamage = false;
+		window.damage.clear();
+	}
+
+	//Each swap chain reports its own result, only the windows whose surface changed are recreated
+	for (uint32_t i = 0; i < acquired; i++) {
+		RenderWindow *window = &renderer->windows[submission.windowIndices[i]];
+		VkResult windowResult = submission.presentResults[i];
+
+		if (windowResult == VK_ERROR_OUT_OF_DATE_KHR || windowResult == VK_SUBOPTIMAL_KHR || window->framebufferResized) {
+			window->framebufferResized = false;
+			recreateWindowSwapChain(renderer, window);
+			swapChainRecreated = true;
+		}
+		else if (windowResult != VK_SUCCESS) {
+			throw std::runtime_error("Failed to present swap chain image");
+		}
+	}
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+		throw std::runtime_error("Failed to present swap chain image");
+	}
+
+	if (!renderer->startupTimer->reported) {
+		markStartupStep(renderer->startupTimer, "first frame");
+		printStartupReport(renderer->startupTimer);
+	}
+
+	retireFrames(renderer);
+
+	renderer->currentFrame = (currentFrame + 1) % renderer->policy.framesInFlight;
+	renderer->framesPresented++;
+
+	//Once warmed up a frame must not reach the heap, arenas serve command scope allocations
+	checkFrameAllocations(renderer->hostAllocator, allocationsBefore, swapChainRecreated);
+}
+
+//Window of an SDL window ID, nullptr when the event is not tied to one of them
+static RenderWindow *findWindow(Renderer *renderer, uint32_t windowId) {
+
+	for (RenderWindow &window : renderer->windows) {
+		if (window.windowId == windowId) {
+			return &window;
+		}
+	}
+	return nullptr;
+}
+
+//Surface events make the window's cached capabilities stale
+static void applyWindowEvent(RenderWindow *window, const RenderEvent &renderEvent) {
+
+	switch (renderEvent.type) {
+
+	case RenderEvent::EXPOSED:
+		//The window system lost what was presented
+		markWindowDirty(window);
+		break;
+
+	case RenderEvent::RESIZE:
+		window->windowExtent = { static_cast<uint32_t>(renderEvent.width), static_cast<uint32_t>(renderEvent.height) };
+		window->framebufferResized = true;
+		window->surfaceSupportValid = false;
+		break;
+
+	case RenderEvent::MINIMIZED:
+		window->windowMinimized = true;
+		break;
+
+	case RenderEvent::RESTORED:
+		window->windowMinimized = false;
+		window->framebufferResized = true;
+		window->surfaceSupportValid = false;
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool handleRenderEvent(Renderer *renderer, const RenderEvent &renderEvent) {
+
+	switch (renderEvent.type) {
+
+	case RenderEvent::QUIT:
+		return false;
+
+	case RenderEvent::INPUT:
+		//The scene may react anywhere, in every window, and the input's latency ends at the next present
+		markInput(renderer->latency, renderEvent.time);
+		markSceneDirty(renderer);
+		break;
+
+	default: {
+		//Events without a known window apply to all of them
+		RenderWindow *window = findWindow(renderer, renderEvent.windowId);
+		if (window != nullptr) {
+			applyWindowEvent(window, renderEvent);
+			break;
+		}
+		for (RenderWindow &other : renderer->windows) {
+			applyWindowEvent(&other, renderEvent);
+		}
+		break;
+	}
+	}
+
+	return true;
+}
+
+void markSceneDirty(Renderer *renderer) {
+
+	for (RenderWindow &window : renderer->windows) {
+		markWindowDirty(&window);
+	}
+}
+
+void markWindowDirty(RenderWindow *window) {
+
+	window->sceneDirty = true;
+	window->fullDamage = true;
+	window->damage.clear();
+}
+
+void markDamage(RenderWindow *window, const VkRect2D &rect) {
+
+	window->sceneDirty = true;
+	if (window->fullDamage) {
+		return;
+	}
+
+	//Present regions must lie inside the image
+	VkExtent2D extent = window->swapChainExtent;
+	VkRectLayerKHR region = {};
+	region.offset.x = std::max(0, rect.offset.x);
+	region.offset.y = std::max(0, rect.offset.y);
+	if (static_cast<uint32_t>(region.offset.x) >= extent.width || static_cast<uint32_t>(region.offset.y) >= extent.height) {
+		return;
+	}
+	int64_t right = std::min<int64_t>(int64_t(rect.offset.x) + rect.extent.width, extent.width);
+	int64_t bottom = std::min<int64_t>(int64_t(rect.offset.y) + rect.extent.height, extent.height);
+	if (right <= region.offset.x || bottom <= region.offset.y) {
+		return;
+	}
+	region.extent.width = static_cast<uint32_t>(right - region.offset.x);
+	region.extent.height = static_cast<uint32_t>(bottom - region.offset.y);
+
+	if (window->damage.size() < MAX_DAMAGE_RECTS) {
+		window->damage.push_back(region);
+		return;
+	}
+
+	//Full list: one rectangle bounding them all, still smaller than the image
+	for (const VkRectLayerKHR &other : window->damage) {
+		right = std::max<int64_t>(right, int64_t(other.offset.x) + other.extent.width);
+		bottom = std::max<int64_t>(bottom, int64_t(other.offset.y) + other.extent.height);
+		region.offset.x = std::min(region.offset.x, other.offset.x);
+		region.offset.y = std::min(region.offset.y, other.offset.y);
+	}
+	region.extent.width = static_cast<uint32_t>(right - region.offset.x);
+	region.extent.height = static_cast<uint32_t>(bottom - region.offset.y);
+	window->damage.clear();
+	window->damage.push_back(region);
+}
+
+bool renderingPaused(const Renderer &renderer) {
+
+	for (const RenderWindow &window : renderer.windows) {
+		if (!window.windowMinimized) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool frameNeeded(Renderer *renderer) {
+
+	if (!renderer->policy.onDemand) {
+		return true;
+	}
+
+	for (RenderWindow &window : renderer->windows) {
+		if (window.windowMinimized) {
+			continue;
+		}
+		if (window.sceneDirty || window.framebufferResized) {
+			return true;
+		}
+
+		//The real pipeline finished compiling, it replaces the fallback on screen
+		if (windowPipeline(renderer, &window) != window.presentedPipeline) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void idleFrame(Renderer *renderer) {
+
+	retireFrames(renderer);
+	renderer->usage.idleWakeups++;
+}
+
+bool frameLimitReached(const Renderer &renderer) {
+
+	if (renderer.policy.runSeconds > 0.0 && usageElapsedSeconds(renderer.usage) >= renderer.policy.runSeconds) {
+		return true;
+	}
+	return renderer.policy.frameLimit != 0 && renderer.framesPresented >= renderer.policy.frameLimit;
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "BindlessHeap.h"
+#include "DeviceCapabilities.h"
+#include "DrawQueue.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "FramePolicy.h"
+#include "FrameSync.h"
+#include "HostAllocator.h"
+#include "JobSystem.h"
+#include "LatencyStats.h"
+#include "PipelineStateCache.h"
+#include "RenderEvents.h"
+#include "SceneMesh.h"
+#include "ShaderVariants.h"
+#include "StartupTimer.h"
+#include "UsageMeter.h"
+
+//One window: its surface, swap chain and everything sized by the swap chain. Windows share the
+//device, the pipelines, the bindless heap and the frame slots, but each is recreated on its own:
+//a resize only waits for that window's submissions while the others keep presenting.
+struct RenderWindow {
+	//Set by main before createRenderer, VK_NULL_HANDLE offscreen
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	uint32_t windowId = 0; //SDL window ID, routes the window events
+
+	//Surface capabilities, formats and present modes of this window, re-queried after a surface change.
+	//Offscreen they describe the images the renderer makes in place of a swap chain.
+	SwapChainSupportDetails surfaceSupport;
+	bool surfaceSupportValid = false;
+
+	//Swap chain
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	std::vector<VkImage> swapChainImages;
+	std::vector<VkImageView> swapChainImageViews;
+	std::vector<VkFramebuffer> swapChainFramebuffers;
+	VkFormat swapChainImageFormat = VK_FORMAT_UNDEFINED;
+	VkExtent2D swapChainExtent = {};
+	//Offscreen only: memory of the images standing in for the swap chain, and the next one handed out
+	std::vector<VkDeviceMemory> swapChainMemory;
+	uint32_t nextImage = 0;
+	//Render pass path only, VK_NULL_HANDLE with dynamic rendering
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+
+	//The renderer's state for this window's format: the fallback is always ready, the real state compiles on a worker.
+	//pipeline is what drawing uses, the cache is only asked again until the compile settled.
+	PipelineState pipelineState;
+	VkPipeline fallbackPipeline = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	bool pipelineSettled = false;
+
+	//One pool per swap chain image so the command buffers can be recorded on different workers
+	std::vector<VkCommandPool> recordCommandPools;
+	std::vector<VkCommandBuffer> commandBuffers;
+	//Pipeline each image's command buffer was recorded with, re-recorded when the selection changes
+	std::vector<VkPipeline> recordedPipelines;
+	//Render area each image's command buffer was recorded with, re-recorded when the scale moves
+	std::vector<VkExtent2D> recordedExtents;
+	//Binds each image's command buffer issued and elided, added to the renderer's totals when submitted
+	std::vector<DrawBindStats> recordedBindStats;
+
+	//Present family side of the queue ownership transfer
+	std::vector<VkCommandBuffer> presentCommandBuffers;
+	std::vector<VkSemaphore> presentOwnershipSemaphores;
+
+	//Offscreen scene at a GPU time driven scale, inactive unless --dynamic-resolution was given
+	DynamicResolution resolution;
+
+	SwapChainSync sync;
+
+	//Window state, only touched by the thread running the frame loop
+	VkExtent2D windowExtent = {};
+	bool framebufferResized = false;
+	bool windowMinimized = false;
+
+	//What changed since the last present: on demand nothing is drawn until something did.
+	//When every change was localized the damage rectangles become the present regions.
+	bool sceneDirty = true;
+	bool fullDamage = true;
+	std::vector<VkRectLayerKHR> damage; //reserved up front, merged into one rectangle once full
+	VkPipeline presentedPipeline = VK_NULL_HANDLE;
+};
+
+//Everything the frame loop touches: the windows, frame sync and pipelines.
+//main creates the instance, the device and the surfaces and fills the device fields, the renderer owns the rest.
+//Offscreen (policy.offscreen) there are no surfaces: each window draws into images of its own, nothing is presented.
+//Recreation updates the members in place: the frame loop never copies a container and the
+//submit and present infos built once keep pointing at live handles.
+//Not copyable nor movable, the submit infos point into the renderer itself.
+struct Renderer {
+	//Services owned by main, they outlive the renderer
+	JobSystem *jobSystem = nullptr;
+	DeviceCapabilities *capabilities = nullptr;
+	LatencyTracker *latency = nullptr;
+	HostAllocator *hostAllocator = nullptr;
+	StartupTimer *startupTimer = nullptr;
+
+	FramePolicy policy;
+	TriangleVariant variant;
+
+	//Device, set by main before createRenderer
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	VkQueue presentQueue = VK_NULL_HANDLE;
+	uint32_t graphicsFamilyIndex = 0;
+	uint32_t presentFamilyIndex = 0;
+	bool separatePresentQueue = false;
+	bool timelineSemaphore = false;
+	bool dynamicRendering = false; //enabled on the device, no render pass nor framebuffers then
+	bool bindless = false; //descriptor indexing features enabled on the device
+	bool incrementalPresent = false; //VK_KHR_incremental_present enabled, presents may carry damage rectangles
+	PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+	//Sized by main with their surfaces before createRenderer, the first one is the primary window
+	std::vector<RenderWindow> windows;
+	//Copied to every window
+	ResolutionOptions resolutionOptions;
+
+	//Shared by every window: the pipeline cache keys on the state, so windows of the same format share pipelines
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	//Set 0 of the pipeline layout when supported, resources are selected by index in push constants
+	BindlessHeap bindlessHeap;
+	PipelineStateCache pipelineCache;
+	//Shaders, layout and fixed state, each window adds its color format
+	PipelineState graphicsPipelineState;
+
+	//Drawn instead of the triangle when --mesh was given, options set by main
+	SceneMesh mesh;
+
+	//The scene's draws in sort key order, recorded into every window's command buffers
+	DrawQueue drawQueue;
+	DrawRecorder drawRecorder;
+	DrawBindStats bindStats; //every submitted command buffer, reported per presented frame
+
+	//Ownership acquire barriers of every window are recorded from this pool
+	VkCommandPool presentCommandPool = VK_NULL_HANDLE;
+
+	//Readback of the primary window's presented images, inactive unless --capture was given
+	FrameCapture capture;
+
+	FrameSync frameSync;
+	size_t currentFrame = 0;
+	uint64_t framesPresented = 0;
+	UsageMeter usage;
+
+	//Built by createRenderer and after frame sync changes, sized for every window at once.
+	//drawFrame fills the first entries with the windows that acquired an image this frame.
+	struct FrameSubmission {
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<VkCommandBuffer> commandBuffers; //draws, then the capture copy when the frame is captured
+		std::vector<VkSemaphore> signalSemaphores; //binary per window for present, then the timeline for the CPU
+		std::vector<uint64_t> signalValues;
+		VkTimelineSemaphoreSubmitInfoKHR timelineInfo;
+		VkSubmitInfo submitInfo;
+
+		VkPipelineStageFlags ownershipWaitStage;
+		std::vector<VkSubmitInfo> ownershipInfos;
+
+		//One present call for every acquired swap chain
+		std::vector<size_t> windowIndices;
+		std::vector<VkPipeline> pipelines;
+		std::vector<VkSemaphore> presentWaitSemaphores;
+		std::vector<VkSwapchainKHR> swapChains;
+		std::vector<uint32_t> imageIndices;
+		std::vector<VkResult> presentResults;
+		std::vector<VkPresentRegionKHR> presentRegions;
+		VkPresentRegionsKHR presentRegionsInfo;
+		VkPresentInfoKHR presentInfo;
+	} submission = {};
+
+	Renderer() = default;
+	Renderer(const Renderer &) = delete;
+	Renderer &operator=(const Renderer &) = delete;
+};
+
+//Swap chains, render passes, pipelines, command buffers and frame sync for the device fields and windows
+void createRenderer(Renderer *renderer);
+//Waits for the GPU and releases everything createRenderer created, the device is left to main
+void destroyRenderer(Renderer *renderer);
+
+//Record if needed, submit every window in one batch and present them in one call,
+//recreating the swap chains whose surface changed
+void drawFrame(Renderer *renderer);
+//Every window's swap chain, after waiting for the device
+void recreateSwapChains(Renderer *renderer);
+//Switch frames in flight, swap chain image count and present mode at runtime
+void applyFramePolicy(Renderer *renderer, const FramePolicy &policy);
+
+//The scene changed in every window, in one window, or only in this rectangle of a window's swap chain image:
+//presented by the next frame
+void markSceneDirty(Renderer *renderer);
+void markWindowDirty(RenderWindow *window);
+void markDamage(RenderWindow *window, const VkRect2D &rect);
+//Surface capabilities, formats and present modes of the window, cached until a resize or an
+//out of date or suboptimal swap chain invalidates them
+const SwapChainSupportDetails &windowSurfaceSupport(const Renderer &renderer, RenderWindow *window);
+//Every window minimized, nothing to draw until one is restored
+bool renderingPaused(const Renderer &renderer);
+//On demand, whether anything changed in a visible window since the last present; always true when drawing continuously
+bool frameNeeded(Renderer *renderer);
+//In place of drawFrame when no frame is needed: retires finished frames and hands over captures
+void idleFrame(Renderer *renderer);
+
+//Apply one window event on the thread running the frame loop, false on quit
+bool handleRenderEvent(Renderer *renderer, const RenderEvent &renderEvent);
+//True once the --frames limit was presented or --seconds elapsed
+bool frameLimitReached(const Renderer &renderer);
@@ -0,0 +1,375 @@
+#include "SceneMesh.h"
+#include "CommandLine.h"
+#include "HostAllocator.h"
+#include "MeshFormat.h"
+#include "MeshImport.h"
+#include "MeshOptimize.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+MeshOptions parseMeshOptions(int argc, char *argv[]) {
+
+	MeshOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--import-mesh", &value)) {
+			options.importPath = value;
+		}
+		else if (matchOption(arg, "--mesh-out", &value)) {
+			options.outputPath = value;
+		}
+		else if (matchOption(arg, "--mesh", &value)) {
+			options.path = value;
+		}
+	}
+
+	if (!options.importPath.empty() && options.outputPath.empty()) {
+		size_t dot = options.importPath.find_last_of('.');
+		size_t slash = options.importPath.find_last_of("/\\");
+		bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+		options.outputPath = (hasExtension ? options.importPath.substr(0, dot) : options.importPath) + ".vmesh";
+	}
+
+	return options;
+}
+
+static bool isMeshFile(const std::string &path) {
+	return path.size() >= 6 && path.compare(path.size() - 6, 6, ".vmesh") == 0;
+}
+
+static double kibibytes(uint64_t bytes) {
+	return bytes / 1024.0;
+}
+
+static double savedPercent(double before, double after) {
+	return before > 0.0 ? 100.0 * (1.0 - after / before) : 0.0;
+}
+
+//Imports, optimizes and quantizes, then reports against the unoptimized float mesh with 32 bit indices
+static PackedMesh buildPackedMesh(const std::string &path) {
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	ImportedMesh mesh = importMesh(path);
+	double importMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	size_t sourceVertices = mesh.vertices.size();
+	VertexCacheStats before = analyzeVertexCache(mesh.indices, sourceVertices, sizeof(MeshVertex));
+
+	start = Clock::now();
+	optimizeVertexCache(&mesh.indices, mesh.vertices.size());
+	optimizeVertexFetch(&mesh);
+	double optimizeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	QuantizationError error;
+	PackedMesh packed = packMesh(mesh, &error);
+	VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size(), sizeof(PackedVertex));
+
+	uint64_t floatBytes = uint64_t(sourceVertices) * sizeof(MeshVertex) + uint64_t(mesh.indices.size()) * sizeof(uint32_t);
+	uint64_t packedBytes = uint64_t(packed.vertices.size()) * sizeof(PackedVertex) + packed.indices.size();
+	uint64_t fileBytes = packed.header.indexOffset + packed.indices.size();
+
+	std::cout << "Mesh " << path << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles"
+		<< (mesh.vertices.size() < sourceVertices ? " (unreferenced vertices dropped)" : "")
+		<< ", imported in " << importMs << " ms, optimized in " << optimizeMs << " ms" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  memory: " << kibibytes(floatBytes) << " KiB as " << sizeof(MeshVertex) << " B float vertices and 32 bit indices, "
+		<< kibibytes(packedBytes) << " KiB as " << sizeof(PackedVertex) << " B packed vertices and " << packed.header.indexSize * 8
+		<< " bit indices (" << savedPercent(static_cast<double>(floatBytes), static_cast<double>(packedBytes)) << "% saved), "
+		<< kibibytes(fileBytes) << " KiB file" << std::endl;
+	std::cout << std::setprecision(3);
+	std::cout << "  vertex cache (16 entry FIFO): ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	std::cout << "  vertex fetch (64 B lines): overfetch " << before.overfetch << " -> " << after.overfetch << ", "
+		<< std::setprecision(2) << kibibytes(before.fetchedBytes) << " KiB -> " << kibibytes(after.fetchedBytes) << " KiB per draw ("
+		<< savedPercent(static_cast<double>(before.fetchedBytes), static_cast<double>(after.fetchedBytes)) << "% saved)" << std::endl;
+	std::cout << std::setprecision(4) << "  quantization error: position " << error.position << " (" << 100.0 * error.position / packed.header.extent
+		<< "% of the half extent), normal " << error.normalDegrees << " degrees" << std::endl;
+	std::cout << std::defaultfloat;
+
+	return packed;
+}
+
+void runMeshImport(const MeshOptions &options) {
+
+	PackedMesh packed = buildPackedMesh(options.importPath);
+	writeMeshFile(options.outputPath, packed);
+	std::cout << "Mesh written to " << options.outputPath << std::endl;
+}
+
+static uint32_t findMeshMemoryType(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeBits, VkMemoryPropertyFlags flags) {
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags) {
+			return i;
+		}
+	}
+	return UINT32_MAX;
+}
+
+static void createMeshBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer) {
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, vulkanAllocator(), buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create mesh buffer!");
+	}
+}
+
+static void allocateMeshMemory(VkDevice device, VkBuffer buffer, uint32_t memoryType, VkDeviceMemory *memory) {
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(device, &allocInfo, vulkanAllocator(), memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate mesh memory!");
+	}
+	vkBindBufferMemory(device, buffer, *memory, 0);
+}
+
+static void copyMeshData(VkDevice device, VkDeviceMemory memory, VkDeviceSize indexOffset,
+	const void *vertices, size_t vertexBytes, const void *indices, size_t indexBytes) {
+
+	void *mapped;
+	if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map mesh memory!");
+	}
+	std::memcpy(mapped, vertices, vertexBytes);
+	std::memcpy(static_cast<uint8_t*>(mapped) + indexOffset, indices, indexBytes);
+	vkUnmapMemory(device, memory);
+}
+
+//Staging copy recorded into a transient command buffer, submitted and waited for
+static void stagedUpload(SceneMesh *mesh, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkQueue queue,
+	uint32_t queueFamilyIndex, VkDeviceSize size, const void *vertices, size_t vertexBytes, const void *indices, size_t indexBytes) {
+
+	VkDevice device = mesh->device;
+	VkBuffer staging;
+	VkDeviceMemory stagingMemory;
+	createMeshBuffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &staging);
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, staging, &requirements);
+	uint32_t stagingType = findMeshMemoryType(memoryProperties, requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (stagingType == UINT32_MAX) {
+		vkDestroyBuffer(device, staging, vulkanAllocator());
+		throw std::runtime_error("failed to find memory for the mesh staging buffer!");
+	}
+	allocateMeshMemory(device, staging, stagingType, &stagingMemory);
+	copyMeshData(device, stagingMemory, mesh->indexOffset, vertices, vertexBytes, indices, indexBytes);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	VkCommandPool pool;
+	if (vkCreateCommandPool(device, &poolInfo, vulkanAllocator(), &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create mesh upload command pool!");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate mesh upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkBufferCopy region = {};
+	region.size = size;
+	vkCmdCopyBuffer(commandBuffer, staging, mesh->buffer, 1, &region);
+
+	//Made visible to vertex input, the frames read it without any further barrier
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = mesh->buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record mesh upload!");
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	if (vkCreateFence(device, &fenceInfo, vulkanAllocator(), &fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create mesh upload fence!");
+	}
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit mesh upload!");
+	}
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+	vkDestroyFence(device, fence, vulkanAllocator());
+	vkDestroyCommandPool(device, pool, vulkanAllocator());
+	vkDestroyBuffer(device, staging, vulkanAllocator());
+	vkFreeMemory(device, stagingMemory, vulkanAllocator());
+}
+
+static void uploadMesh(SceneMesh *mesh, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkQueue queue, uint32_t queueFamilyIndex,
+	const MeshFileHeader &header, const void *vertices, const void *indices) {
+
+	size_t vertexBytes = size_t(header.vertexCount) * header.vertexStride;
+	size_t indexBytes = size_t(header.indexCount) * header.indexSize;
+	mesh->indexOffset = (vertexBytes + 15) & ~VkDeviceSize(15);
+	VkDeviceSize size = mesh->indexOffset + indexBytes;
+
+	createMeshBuffer(mesh->device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &mesh->buffer);
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(mesh->device, mesh->buffer, &requirements);
+
+	//Integrated GPUs and resizable BAR expose device local memory the CPU writes directly: the file goes
+	//from its mapping to the GPU in one copy. Otherwise through a staging buffer and a transfer.
+	uint32_t memoryType = findMeshMemoryType(memoryProperties, requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	mesh->directUpload = memoryType != UINT32_MAX;
+	if (!mesh->directUpload) {
+		memoryType = findMeshMemoryType(memoryProperties, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+	if (memoryType == UINT32_MAX) {
+		throw std::runtime_error("failed to find memory for the mesh!");
+	}
+	allocateMeshMemory(mesh->device, mesh->buffer, memoryType, &mesh->memory);
+
+	if (mesh->directUpload) {
+		copyMeshData(mesh->device, mesh->memory, mesh->indexOffset, vertices, vertexBytes, indices, indexBytes);
+	}
+	else {
+		stagedUpload(mesh, memoryProperties, queue, queueFamilyIndex, size, vertices, vertexBytes, indices, indexBytes);
+	}
+
+	mesh->vertexCount = header.vertexCount;
+	mesh->indexCount = header.indexCount;
+	mesh->indexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	mesh->loaded = true;
+}
+
+void createSceneMesh(SceneMesh *mesh, VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+	VkQueue queue, uint32_t queueFamilyIndex) {
+
+	mesh->device = device;
+	if (mesh->options.path.empty()) {
+		return;
+	}
+
+	if (isMeshFile(mesh->options.path)) {
+		//Uploaded from the mapping as stored, no parsing nor conversion
+		MappedMeshFile file;
+		mapMeshFile(mesh->options.path, &file);
+		try {
+			uploadMesh(mesh, memoryProperties, queue, queueFamilyIndex, *file.header, file.vertices, file.indices);
+		}
+		catch (...) {
+			unmapMeshFile(&file);
+			throw;
+		}
+		std::cout << "Mesh " << mesh->options.path << ": " << mesh->vertexCount << " vertices, " << mesh->indexCount / 3
+			<< " triangles, " << file.size / 1024.0 << " KiB mapped" << std::endl;
+		unmapMeshFile(&file);
+	}
+	else {
+		PackedMesh packed = buildPackedMesh(mesh->options.path);
+		uploadMesh(mesh, memoryProperties, queue, queueFamilyIndex, packed.header, packed.vertices.data(), packed.indices.data());
+	}
+
+	std::cout << "Mesh upload: " << (mesh->directUpload ? "direct to host visible device local memory" : "staged") << std::endl;
+}
+
+void destroySceneMesh(SceneMesh *mesh) {
+
+	if (mesh->buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(mesh->device, mesh->buffer, vulkanAllocator());
+		vkFreeMemory(mesh->device, mesh->memory, vulkanAllocator());
+	}
+	mesh->buffer = VK_NULL_HANDLE;
+	mesh->memory = VK_NULL_HANDLE;
+	mesh->loaded = false;
+}
+
+void createMeshDrawData(SceneMesh *mesh, const VkPhysicalDeviceMemoryProperties &memoryProperties, BindlessHeap *heap,
+	const MeshDrawData &data) {
+
+	if (!mesh->loaded) {
+		return;
+	}
+
+	createMeshBuffer(mesh->device, sizeof(MeshDrawData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &mesh->drawBuffer);
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(mesh->device, mesh->drawBuffer, &requirements);
+	//Written once, a few bytes: no staging
+	uint32_t memoryType = findMeshMemoryType(memoryProperties, requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (memoryType == UINT32_MAX) {
+		throw std::runtime_error("failed to find memory for the mesh draw data!");
+	}
+	allocateMeshMemory(mesh->device, mesh->drawBuffer, memoryType, &mesh->drawMemory);
+
+	void *mapped;
+	if (vkMapMemory(mesh->device, mesh->drawMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map mesh draw data!");
+	}
+	std::memcpy(mapped, &data, sizeof(MeshDrawData));
+	vkUnmapMemory(mesh->device, mesh->drawMemory);
+	mesh->drawData = data;
+
+	mesh->drawSlot = allocateBufferSlot(heap, mesh->drawBuffer, 0, sizeof(MeshDrawData));
+	if (mesh->drawSlot == BINDLESS_INVALID_SLOT) {
+		std::cout << "Mesh draw data: bindless heap full, drawn without it" << std::endl;
+	}
+}
+
+void releaseMeshDrawData(SceneMesh *mesh, BindlessHeap *heap, FrameSync *sync) {
+
+	if (mesh->drawBuffer == VK_NULL_HANDLE) {
+		return;
+	}
+	if (mesh->drawSlot != BINDLESS_INVALID_SLOT) {
+		freeBindlessSlot(heap, sync, BINDLESS_BUFFER, mesh->drawSlot);
+	}
+	VkDevice device = mesh->device;
+	VkBuffer buffer = mesh->drawBuffer;
+	VkDeviceMemory memory = mesh->drawMemory;
+	releaseAfter(sync, sync->lastSubmitted, [device, buffer, memory]() {
+		vkDestroyBuffer(device, buffer, vulkanAllocator());
+		vkFreeMemory(device, memory, vulkanAllocator());
+	});
+	mesh->drawBuffer = VK_NULL_HANDLE;
+	mesh->drawMemory = VK_NULL_HANDLE;
+	mesh->drawSlot = BINDLESS_INVALID_SLOT;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include "BindlessHeap.h"
+
+//Mesh pipeline, set from the command line:
+//  --import-mesh=FILE  import an .obj, .gltf or .glb file, optimize and quantize it, write a .vmesh, report and exit
+//  --mesh-out=FILE     .vmesh written by --import-mesh, the input with a .vmesh extension by default
+//  --mesh=FILE         draw this mesh instead of the triangle: a .vmesh is mapped and uploaded as stored,
+//                      other formats go through the same import, optimization and quantization at startup
+struct MeshOptions {
+	std::string importPath;
+	std::string outputPath;
+	std::string path;
+};
+
+MeshOptions parseMeshOptions(int argc, char *argv[]);
+
+//Offline step of --import-mesh: import, optimize, quantize, write the .vmesh and report the savings
+void runMeshImport(const MeshOptions &options);
+
+//Per-draw data of the mesh, read by mesh_bindless_vert.spv through the draw's bufferIndex and instanceIndex
+struct MeshDrawData {
+	float placement[4] = { 0.0f, 0.0f, 1.0f, 0.0f }; //clip space x and y offset, scale, unused
+	float tint[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; //multiplies the vertex color, alpha unused
+};
+
+//The drawn mesh: vertices at offset 0 and indices after them, in one device local buffer
+struct SceneMesh {
+	MeshOptions options;
+	bool loaded = false;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize indexOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	//Written through a host visible mapping of device local memory, no staging copy
+	bool directUpload = false;
+
+	//Bindless only: MeshDrawData in a host visible storage buffer, drawSlot of the heap's buffers names it
+	VkBuffer drawBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory drawMemory = VK_NULL_HANDLE;
+	uint32_t drawSlot = BINDLESS_INVALID_SLOT;
+	MeshDrawData drawData; //what drawBuffer holds, the identity without it
+};
+
+//Loads options.path, nothing when it is empty. The upload has completed when this returns:
+//a staging copy is submitted to the queue and waited for.
+void createSceneMesh(SceneMesh *mesh, VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+	VkQueue queue, uint32_t queueFamilyIndex);
+void destroySceneMesh(SceneMesh *mesh);
+
+//Writes the draw data and takes a buffer slot of the heap for it. Nothing when no mesh is loaded,
+//drawSlot stays BINDLESS_INVALID_SLOT when the heap is full and the mesh is drawn without it.
+void createMeshDrawData(SceneMesh *mesh, const VkPhysicalDeviceMemoryProperties &memoryProperties, BindlessHeap *heap,
+	const MeshDrawData &data);
+//The slot and the buffer are released once the frames already submitted completed
+void releaseMeshDrawData(SceneMesh *mesh, BindlessHeap *heap, FrameSync *sync);
@@ -0,0 +1,38 @@
+#include "ShaderVariants.h"
+#include "CommandLine.h"
+#include <sstream>
+
+TriangleVariant parseTriangleVariant(int argc, char *argv[]) {
+
+	TriangleVariant variant;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+
+		if (matchOption(arg, "--scale", &value)) {
+			variant.scale = std::stof(value);
+		}
+		else if (matchFlag(arg, "--grayscale")) {
+			variant.grayscale = VK_TRUE;
+		}
+		else if (matchOption(arg, "--brightness", &value)) {
+			variant.brightness = std::stof(value);
+		}
+	}
+
+	return variant;
+}
+
+bool isDefaultTriangleVariant(const TriangleVariant &variant) {
+
+	TriangleVariant defaults;
+	return variant.scale == defaults.scale && variant.grayscale == defaults.grayscale && variant.brightness == defaults.brightness;
+}
+
+std::string describeTriangleVariant(const TriangleVariant &variant) {
+
+	std::stringstream description;
+	description << "scale " << variant.scale << ", " << (variant.grayscale ? "grayscale" : "color") << ", brightness " << variant.brightness;
+	return description.str();
+}
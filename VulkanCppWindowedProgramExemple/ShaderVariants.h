@@ -0,0 +1,28 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include "SpecializationConstants.h"
+
+//Feature switches of shaders/shader.vert and shaders/shader.frag, one pipeline per value:
+//  --scale=F          triangle size (vertex constant 0)
+//  --grayscale        luminance only output (fragment constant 1)
+//  --brightness=F     output multiplier (fragment constant 2)
+struct TriangleVariant {
+	float scale = 1.0f;
+	VkBool32 grayscale = VK_FALSE;
+	float brightness = 1.0f;
+};
+
+template<>
+struct SpecializationLayout<TriangleVariant> {
+	static constexpr std::array<VkSpecializationMapEntry, 3> entries = { {
+		SPECIALIZATION_CONSTANT(TriangleVariant, 0, scale),
+		SPECIALIZATION_CONSTANT(TriangleVariant, 1, grayscale),
+		SPECIALIZATION_CONSTANT(TriangleVariant, 2, brightness),
+	} };
+};
+
+TriangleVariant parseTriangleVariant(int argc, char *argv[]);
+//The constants the shaders declare, the pipeline needs no specialization
+bool isDefaultTriangleVariant(const TriangleVariant &variant);
+std::string describeTriangleVariant(const TriangleVariant &variant);
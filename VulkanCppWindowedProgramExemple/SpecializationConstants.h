@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+//Shader variants as Vulkan specialization constants, described by a plain C++ struct.
+//The struct lists its constants once, outside the struct so offsetof sees a complete type:
+//
+//  struct Variant { float scale; VkBool32 grayscale; };
+//  template<> struct SpecializationLayout<Variant> {
+//      static constexpr std::array<VkSpecializationMapEntry, 2> entries = { {
+//          SPECIALIZATION_CONSTANT(Variant, 0, scale),
+//          SPECIALIZATION_CONSTANT(Variant, 1, grayscale),
+//      } };
+//  };
+//
+//Each distinct value of the struct is a separate branch-free pipeline built from the same SPIR-V.
+template<typename T>
+struct SpecializationLayout;
+
+//constant_id in the shader <-> member of the constants struct
+#define SPECIALIZATION_CONSTANT(Struct, constantID, member) \
+	VkSpecializationMapEntry{ constantID, static_cast<uint32_t>(offsetof(Struct, member)), sizeof(Struct::member) }
+
+//Checked at compile time: 32 or 64 bit scalars, inside the struct, constant IDs used once
+template<typename T>
+constexpr bool validSpecialization() {
+
+	const auto &entries = SpecializationLayout<T>::entries;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if ((entries[i].size != 4 && entries[i].size != 8) || entries[i].offset + entries[i].size > sizeof(T)) {
+			return false;
+		}
+		for (size_t j = 0; j < i; j++) {
+			if (entries[j].constantID == entries[i].constantID) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//VkSpecializationInfo over a constants value, both must outlive the pipeline creation call
+template<typename T>
+VkSpecializationInfo specializationInfo(const T &constants) {
+
+	static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value, "specialization constants must be a plain struct");
+	static_assert(validSpecialization<T>(), "invalid specialization constant layout");
+
+	VkSpecializationInfo info = {};
+	info.mapEntryCount = static_cast<uint32_t>(SpecializationLayout<T>::entries.size());
+	info.pMapEntries = SpecializationLayout<T>::entries.data();
+	info.dataSize = sizeof(T);
+	info.pData = &constants;
+	return info;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+//Bounded lock-free single producer / single consumer ring.
+//One thread only calls tryPush, one other thread only calls tryPop; Capacity must be a power of two.
+template<typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	bool tryPush(const T &value) {
+
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+
+		items_[tail & (Capacity - 1)] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T *value) {
+
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		*value = items_[head & (Capacity - 1)];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const {
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	//Producer and consumer indices on separate cache lines
+	alignas(64) std::atomic<size_t> head_{ 0 };
+	alignas(64) std::atomic<size_t> tail_{ 0 };
+	alignas(64) std::array<T, Capacity> items_;
+};
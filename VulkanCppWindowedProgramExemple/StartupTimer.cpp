@@ -0,0 +1,37 @@
+#include "StartupTimer.h"
+#include <iomanip>
+#include <iostream>
+
+void beginStartup(StartupTimer *timer) {
+	timer->start = StartupTimer::Clock::now();
+	timer->last = timer->start;
+	timer->steps.clear();
+	timer->reported = false;
+}
+
+void markStartupStep(StartupTimer *timer, const char *name) {
+
+	if (timer->reported) {
+		return;
+	}
+
+	StartupTimer::Clock::time_point now = StartupTimer::Clock::now();
+	timer->steps.push_back({ name, std::chrono::duration<double, std::milli>(now - timer->last).count() });
+	timer->last = now;
+}
+
+void printStartupReport(StartupTimer *timer) {
+
+	if (timer->reported) {
+		return;
+	}
+	timer->reported = true;
+
+	double total = std::chrono::duration<double, std::milli>(timer->last - timer->start).count();
+
+	std::cout << "Startup to first frame: " << std::fixed << std::setprecision(2) << total << " ms" << std::endl;
+	for (const auto &step : timer->steps) {
+		std::cout << "  " << std::left << std::setw(28) << step.name << std::right << std::setw(10) << step.milliseconds << " ms" << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+//Time to first frame, broken down per init step
+struct StartupTimer {
+	typedef std::chrono::steady_clock Clock;
+
+	struct Step {
+		const char *name;
+		double milliseconds;
+	};
+
+	Clock::time_point start;
+	Clock::time_point last;
+	std::vector<Step> steps;
+	bool reported = false;
+};
+
+void beginStartup(StartupTimer *timer);
+//Close the step that started at the previous mark
+void markStartupStep(StartupTimer *timer, const char *name);
+void printStartupReport(StartupTimer *timer);
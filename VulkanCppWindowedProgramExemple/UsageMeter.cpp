@@ -0,0 +1,58 @@
+#include "UsageMeter.h"
+#include <iomanip>
+#include <iostream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//User and kernel time of every thread of the process
+static double processCpuSeconds() {
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+		return 0.0;
+	}
+	ULARGE_INTEGER kernelTicks, userTicks;
+	kernelTicks.LowPart = kernel.dwLowDateTime;
+	kernelTicks.HighPart = kernel.dwHighDateTime;
+	userTicks.LowPart = user.dwLowDateTime;
+	userTicks.HighPart = user.dwHighDateTime;
+	//100 ns units
+	return (kernelTicks.QuadPart + userTicks.QuadPart) * 1e-7;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0.0;
+	}
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+void beginUsage(UsageMeter *meter) {
+	meter->start = UsageMeter::Clock::now();
+	meter->cpuStartSeconds = processCpuSeconds();
+	meter->idleWakeups = 0;
+}
+
+double usageElapsedSeconds(const UsageMeter &meter) {
+	return std::chrono::duration<double>(UsageMeter::Clock::now() - meter.start).count();
+}
+
+void printUsageReport(const UsageMeter &meter, const char *label, uint64_t framesPresented) {
+
+	double wallSeconds = usageElapsedSeconds(meter);
+	double cpuSeconds = processCpuSeconds() - meter.cpuStartSeconds;
+	if (wallSeconds <= 0.0) {
+		return;
+	}
+
+	std::cout << "Usage (" << label << "): " << std::fixed << std::setprecision(1) << cpuSeconds * 100.0 / wallSeconds
+		<< "% of one core over " << wallSeconds << " s, " << framesPresented << " frames presented ("
+		<< framesPresented / wallSeconds << "/s), " << meter.idleWakeups << " idle wakeups, "
+		<< meter.localizedPresents << " window presents with only localized damage" << std::endl;
+	std::cout << std::defaultfloat;
+}
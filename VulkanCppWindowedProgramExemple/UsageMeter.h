@@ -0,0 +1,19 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+//Process CPU time against wall time over the frame loop, printed at exit so runs with and without
+//--on-demand can be compared (with --seconds for equal durations). Presents stand in for GPU work:
+//every one of them runs the whole command buffer.
+struct UsageMeter {
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point start;
+	double cpuStartSeconds = 0.0;
+	uint64_t idleWakeups = 0; //frame loop iterations that found nothing to present
+	uint64_t localizedPresents = 0; //window presents whose changes all lay in damage rectangles
+};
+
+void beginUsage(UsageMeter *meter);
+double usageElapsedSeconds(const UsageMeter &meter);
+void printUsageReport(const UsageMeter &meter, const char *label, uint64_t framesPresented);
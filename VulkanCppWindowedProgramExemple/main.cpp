@@ -41,26 +41,45 @@
 
 
 
-#include <glm/glm.hpp>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_syswm.h>
 #include <SDL2/SDL_vulkan.h>
-#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan.h>
 
 #include <iostream>
+#include <cstring>
 #include <algorithm>
 #include <optional>
 #include <vector>
 #include <string>
 #include <set>
+#include <atomic>
+#include <exception>
+#include <thread>
 #include "ShaderFile.h"
+#include "FramePolicy.h"
+#include "LatencyStats.h"
+#include "DeviceSelection.h"
+#include "QueueFamilies.h"
+#include "DeviceCapabilities.h"
+#include "StartupTimer.h"
+#include "RenderEvents.h"
+#include "JobSystem.h"
+#include "JobBenchmark.h"
+#include "DrawBenchmark.h"
+#include "SceneMesh.h"
+#include "ShaderVariants.h"
+#include "Renderer.h"
+#include "HostAllocator.h"
+#include "DebugMessages.h"
+#include "RegressionCheck.h"
+#include "CommandLine.h"
 
 
 
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -72,7 +91,6 @@ const std::vector<const char*> deviceExtensions = {
 
 
 
-const 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -82,209 +100,352 @@ const bool enableValidationLayers = true;
 
 
 
-struct QueueFamilyIndices {
-	std::optional<uint32_t> graphicsFamily;
-	std::optional<uint32_t> presentFamily;
-
-	bool isComplete() {
-		return graphicsFamily.has_value() && presentFamily.has_value();
-	}
-};
-
-struct SwapChainSupportDetails {
-	VkSurfaceCapabilitiesKHR capabilities;
-	std::vector<VkSurfaceFormatKHR> formats;
-	std::vector<VkPresentModeKHR>presentsModes;
-};
 
 
 //Global
-SDL_Window* window;
+//One per --windows, the first is the primary window: instance extensions, device choice and capture
+std::vector<SDL_Window*> windows;
 VkDebugUtilsMessengerEXT debugMessenger;
-VkFormat swapChainImageFormat;
-VkExtent2D swapChainExtent;
-VkRenderPass renderPass;
-VkPipelineLayout pipelineLayout;
-VkPipeline graphicsPipeline;
-
-//TODO Set local var
-std::vector<VkImageView> swapChainImageViews;
-std::vector<VkFramebuffer> swapChainFramebuffers;
-VkCommandPool commandPool;
-std::vector<VkCommandBuffer> commandBuffers;
-std::vector<VkSemaphore>imageAvailableSemaphores;
-std::vector<VkSemaphore>renderFinishedSemaphores;
-std::vector<VkFence> inFlightFences;
-size_t currentFrame = 0;
-
-
-int initWindow();
-void initVulkan(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkDevice *device, VkQueue *graphicsQueue, VkSurfaceKHR *surface, VkBool32 *presentSupport, VkQueue *presentQueue, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages);
+//Filters, deduplicates and rate limits the layers' messages, printed by its logger thread
+DebugMessenger debugMessages;
+TriangleVariant triangleVariant;
+
+FramePolicy framePolicy;
+DeviceOverride deviceOverride;
+DeviceCapabilities deviceCapabilities;
+StartupTimer startupTimer;
+LatencyTracker latencyTracker;
+JobSystemOptions jobOptions;
+JobSystem jobSystem;
+HostAllocator hostAllocator;
+
+//Golden image and baseline comparison, inactive unless --golden or --baseline was given
+RegressionRun regressionRun;
+
+//SDL stays on the main thread, the render thread only sees its events through this queue
+RenderEventQueue renderEvents;
+RenderWakeup renderWakeup;
+std::atomic<bool> renderThreadRunning(false);
+std::exception_ptr renderThreadError;
+
+
+int initWindow(bool hidden, std::vector<RenderWindow> *renderWindows);
+void initOffscreen(std::vector<RenderWindow> *renderWindows);
+void initVulkan(VkInstance *instance, Renderer *renderer);
 void createInstance(VkInstance *instance);
-void pickPhysicalDevice(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkSurfaceKHR surface, VkBool32 *presentSupport);
-void createLogicalDevice(VkPhysicalDevice *physicalDevice, VkDevice *device, VkQueue *graphicsQueue, VkSurfaceKHR surface, VkBool32 *presentSupport, VkQueue *presentQueue);
-bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface, VkBool32 *presentSupport);
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, VkBool32 *presentSupport);
+void pickPhysicalDevice(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkSurfaceKHR surface);
+void createLogicalDevice(Renderer *renderer);
+bool isDeviceSuitable(const DeviceCapabilities &capabilities);
 std::vector<const char*> getRequiredExtensions();
 bool checkValidationLayerSupport();
-void sdlCleanUp(SDL_Window* window);
-void cleanup(VkDevice device, VkInstance instance, VkSurfaceKHR surface, VkSwapchainKHR swapChain);
+void sdlCleanUp(const std::vector<SDL_Window*> &sdlWindows);
+void cleanup(VkInstance instance, Renderer *renderer);
 VkResult CreateDebugUtilsMessengerEXT(VkInstance *instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
 void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator);
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 void setupDebugMessenger(VkInstance *instance);
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
 int createSurface(SDL_Window* window, VkInstance instance, VkSurfaceKHR *surface);
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
-VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>&availableFormats);
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
-VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
-void createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport, VkDevice device, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages);
-void createImageViews(VkDevice device, std::vector<VkImage> swapChainImages, std::vector<VkImageView> *swapChainImageViews);
-void createGraphicsPipeline(VkDevice device);
-VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
-void createRenderPass(VkDevice device);
-void createFrameBuffers(VkDevice device);
-void createCommandPool(VkPhysicalDevice *physicalDevice, VkDevice *device, VkSurfaceKHR surface, VkBool32 *presentSupport);
-void createCommandeBuffers(VkDevice device);
-void createSyncObjects(VkDevice device);
-void drawFrame(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport,VkSwapchainKHR *swapChain, std::vector<VkImage> swapChainImages, VkQueue graphicsQueue, VkQueue presentQueue);
-void recreateSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport, VkDevice device, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages);
-void cleanupSwapChain( VkDevice device, VkSwapchainKHR *swapChain);
-
-
-int main() {
+bool runLatencySweep(Renderer *renderer);
+void printLatencySummary(const char *label, const LatencySummary &summary);
+void renderLoop(Renderer *renderer);
+void pumpEvents();
+int run(int argc, char* argv[]);
 
-	//Instance Vulkan
-	VkInstance instance;
 
-	//Instance for physicaDevice (GPU)
-	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+//A failure ends the program with its message and EXIT_FAILURE, not an abort: ctest tells a missing
+//device apart from a failed run by the message
+int main(int argc, char* argv[]) {
 
-	//Instance for logical Device
-	VkDevice device = NULL;
+	try {
+		return run(argc, argv);
+	}
+	catch (const std::exception &error) {
+		//Worker and logger threads still running would abort the program as it exits
+		stopJobSystem(&jobSystem);
+		stopDebugMessenger(&debugMessages);
+		std::cerr << error.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
 
-	//Instance of queue for graphics commande 
-	VkQueue graphicsQueue = NULL;
+int run(int argc, char* argv[]) {
 
-	//Init SDL && SDL Window
-	initWindow();
+	//Frames in flight, swap chain images and present mode
+	framePolicy = parseFramePolicy(argc, argv);
+
+	//GPU forced by index, name or UUID
+	deviceOverride = parseDeviceOverride(argc, argv);
+
+	//Shader feature switches, compiled into the pipeline as specialization constants
+	triangleVariant = parseTriangleVariant(argc, argv);
+
+	//Worker threads for probing, asset loading and command recording
+	jobOptions = parseJobSystemOptions(argc, argv);
+
+	//Draw packet sorting and recording, no device needed
+	DrawQueueOptions drawQueueOptions = parseDrawQueueOptions(argc, argv);
+
+	//Offline mesh conversion, or the mesh drawn instead of the triangle
+	MeshOptions meshOptions = parseMeshOptions(argc, argv);
+
+	//Parsed in every build, so the same command line works with and without the validation layers
+	DebugMessageOptions debugMessageOptions = parseDebugMessageOptions(argc, argv);
+	HostAllocatorOptions hostAllocatorOptions = parseHostAllocatorOptions(argc, argv);
+	CaptureOptions captureOptions = parseCaptureOptions(argc, argv);
+	ResolutionOptions resolutionOptions = parseResolutionOptions(argc, argv);
+	RegressionOptions regressionOptions = parseRegressionOptions(argc, argv);
+
+	//Every parser has seen the command line, a misspelled option fails here instead of being ignored
+	rejectUnclaimedOptions(argc, argv);
+
+	if (jobOptions.benchmark) {
+		runJobBenchmarks(jobOptions.workerCount, jobOptions.pinWorkers);
+		return EXIT_SUCCESS;
+	}
 
-	//Instance for window surface 
-	VkSurfaceKHR surface=NULL;
-	VkBool32 presentSupport = false;
+	if (drawQueueOptions.benchmark) {
+		runDrawQueueBenchmarks();
+		return EXIT_SUCCESS;
+	}
 
-	//Instance of queue for graphics commande 
-	VkQueue presentQueue;
+	if (!meshOptions.importPath.empty()) {
+		runMeshImport(meshOptions);
+		return EXIT_SUCCESS;
+	}
+
+	//Validation messages go through the logger thread, started before the instance reports anything
+	if (enableValidationLayers) {
+		startDebugMessenger(&debugMessages, debugMessageOptions);
+	}
 
-	//Instance for swap chain
-	VkSwapchainKHR swapChain; 
-	std::vector<VkImage> swapChainImages;
+	//Host memory of every Vulkan object goes through our callbacks, installed before the instance exists
+	createHostAllocator(&hostAllocator, hostAllocatorOptions);
 
-	//TODO Set Local Var
-	//Instance for image view
-	//std::vector<VkImageView> swapChainImageViews;
+	//Instance Vulkan
+	VkInstance instance;
 
+	//Device, swap chain and frame loop state, the render thread works on it once started
+	Renderer renderer;
+	renderer.windows.resize(framePolicy.windowCount);
+	renderer.capture.options = captureOptions;
+	renderer.resolutionOptions = resolutionOptions;
+	renderer.mesh.options = meshOptions;
+	regressionRun.options = regressionOptions;
+	prepareRegressionRun(&regressionRun, &renderer.capture, framePolicy.frameLimit);
+
+	//Init SDL && SDL Window
+	beginStartup(&startupTimer);
+	startJobSystem(&jobSystem, jobOptions.workerCount, jobOptions.pinWorkers);
+	markStartupStep(&startupTimer, "startJobSystem");
+	if (!framePolicy.offscreen && initWindow(framePolicy.headless, &renderer.windows) != 0) {
+		if (!framePolicy.headless) {
+			return EXIT_FAILURE;
+		}
+		//Headless without a display: same frames, drawn into images of our own
+		std::cout << "Headless: no window, rendering offscreen" << std::endl;
+		sdlCleanUp(windows);
+		windows.clear();
+		framePolicy.offscreen = true;
+	}
+	if (framePolicy.offscreen) {
+		initOffscreen(&renderer.windows);
+	}
+	markStartupStep(&startupTimer, "initWindow");
 
 	//Init Vulkan
-	initVulkan(&instance, &physicalDevice, &device, &graphicsQueue, &surface, &presentSupport,&presentQueue, &swapChain, &swapChainImages);
+	initVulkan(&instance, &renderer);
+	std::cout << "Frame policy: " << describeFramePolicy(renderer.policy) << std::endl;
 
+	resetLatency(&latencyTracker);
+	beginUsage(&renderer.usage);
 	
 	//MainLoop
 	// Poll for user input.
 	bool stillRunning = true;
-	while (stillRunning) {
+	if (framePolicy.latencySweep) {
+		stillRunning = runLatencySweep(&renderer);
+	}
 
-		drawFrame(device, physicalDevice, surface, presentSupport, &swapChain, swapChainImages, graphicsQueue, presentQueue);
-		SDL_Event event;
-		while (SDL_PollEvent(&event)) {
+	if (stillRunning && framePolicy.renderThread) {
 
-			switch (event.type) {
+		//Render thread owns the device and the frame loop from here, this thread only pumps SDL events
+		renderThreadRunning = true;
+		std::thread renderThread(renderLoop, &renderer);
+		pumpEvents();
+		renderThread.join();
 
-			case SDL_QUIT:
-				stillRunning = false;
-				break;
+		if (renderThreadError) {
+			std::rethrow_exception(renderThreadError);
+		}
+	}
 
-			default:
-				// Do nothing.
-				break;
+	while (stillRunning && !framePolicy.renderThread && !frameLimitReached(renderer)) {
+
+		if (renderingPaused(renderer)) {
+			//Nothing to present until a window is restored
+			SDL_WaitEventTimeout(NULL, 10);
+		}
+		else if (!frameNeeded(&renderer)) {
+			//On demand: sleep until an event, or a pipeline compile may have finished
+			idleFrame(&renderer);
+			SDL_WaitEventTimeout(NULL, static_cast<int>(renderer.policy.idleWakeMs));
+		}
+		else {
+			drawFrame(&renderer);
+		}
+
+		SDL_Event event;
+		while (stillRunning && SDL_PollEvent(&event)) {
+			RenderEvent renderEvent;
+			if (translateEvent(event, &renderEvent)) {
+				stillRunning = handleRenderEvent(&renderer, renderEvent);
 			}
 		}
-		vkDeviceWaitIdle(device);
-		SDL_Delay(10);
 	}
 
+	vkDeviceWaitIdle(renderer.device);
+	framesCompleted(&latencyTracker, pollCompletedValue(renderer.device, &renderer.frameSync));
+	LatencySummary latencySummary = summarizeLatency(latencyTracker);
+	printLatencySummary(describeFramePolicy(renderer.policy).c_str(), latencySummary);
+	printUsageReport(renderer.usage, renderer.policy.onDemand ? "on demand" : "continuous", renderer.framesPresented);
 	
-	
-	cleanupSwapChain (device, &swapChain);
-	cleanup(device, instance,surface, swapChain);
-	sdlCleanUp(window);
+	cleanup(instance, &renderer);
+	stopDebugMessenger(&debugMessages);
+	printDebugMessageReport(debugMessages, renderer.framesPresented);
+	sdlCleanUp(windows);
+	stopJobSystem(&jobSystem);
+	printHostAllocationReport(hostAllocator);
+
+	//The golden frame was read back when the renderer was destroyed
+	if (!finishRegressionRun(&regressionRun, latencySummary, startupTimer)) {
+		return EXIT_FAILURE;
+	}
 
 	return EXIT_SUCCESS;
 }
 
 
-int initWindow() {
+//One SDL window per render window, sized by the caller
+int initWindow(bool hidden, std::vector<RenderWindow> *renderWindows) {
 
 
 	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
 		std::cout << "Could not initialize SDL." << std::endl;
 		return 1;
 	}
-	window = SDL_CreateWindow("Vulkan Window", SDL_WINDOWPOS_CENTERED,
-		SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-	if (window == NULL) {
-		std::cout << "Could not create SDL window." << std::endl;
-		return 1;
+
+	for (size_t i = 0; i < renderWindows->size(); i++) {
+		//The primary window is centered, the others cascade from the top left corner
+		std::string title = i == 0 ? "Vulkan Window" : "Vulkan Window " + std::to_string(i + 1);
+		int position = 64 * static_cast<int>(i);
+		SDL_Window *window = SDL_CreateWindow(title.c_str(),
+			i == 0 ? SDL_WINDOWPOS_CENTERED : position, i == 0 ? SDL_WINDOWPOS_CENTERED : position,
+			1280, 720, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | (hidden ? SDL_WINDOW_HIDDEN : 0));
+		if (window == NULL) {
+			std::cout << "Could not create SDL window." << std::endl;
+			return 1;
+		}
+		windows.push_back(window);
+
+		int width, height;
+		SDL_GetWindowSize(window, &width, &height);
+		RenderWindow &renderWindow = (*renderWindows)[i];
+		renderWindow.windowExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+		renderWindow.windowId = SDL_GetWindowID(window);
 	}
 
 	return 0;
 }
 
+//No SDL window nor surface: events only, for quit, and the size a window would have had
+void initOffscreen(std::vector<RenderWindow> *renderWindows) {
+
+	if (SDL_Init(SDL_INIT_EVENTS) != 0) {
+		throw std::runtime_error("could not initialize SDL events!");
+	}
+
+	for (RenderWindow &renderWindow : *renderWindows) {
+		renderWindow.windowExtent = { 1280, 720 };
+	}
+}
+
 //Init Vulkan
-void initVulkan(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkDevice *device, VkQueue *graphicsQueue, VkSurfaceKHR *surface, VkBool32 *presentSupport, VkQueue *presentQueue, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages) {
+void initVulkan(VkInstance *instance, Renderer *renderer) {
 	createInstance(instance);
+	markStartupStep(&startupTimer, "createInstance");
 	setupDebugMessenger(instance);
-	createSurface(window, *instance, surface);
-	pickPhysicalDevice(instance, physicalDevice,*surface,presentSupport);
-	createLogicalDevice(physicalDevice, device, graphicsQueue,*surface, presentSupport, presentQueue);
-	createSwapChain(*physicalDevice, *surface, *presentSupport, *device, swapChain, swapChainImages);
-	createImageViews(*device, *swapChainImages,&swapChainImageViews);
-	createRenderPass(*device);
-	createGraphicsPipeline(*device);
-	createFrameBuffers(*device);
-	createCommandPool(physicalDevice, device, *surface, presentSupport);
-	createCommandeBuffers(*device);
-	createSyncObjects(*device);
+	markStartupStep(&startupTimer, "setupDebugMessenger");
+	for (size_t i = 0; i < windows.size(); i++) {
+		createSurface(windows[i], *instance, &renderer->windows[i].surface);
+	}
+	markStartupStep(&startupTimer, "createSurface");
+	pickPhysicalDevice(instance, &renderer->physicalDevice, renderer->windows[0].surface);
+	//The device is chosen for the primary window, the others present from the same queue (offscreen none presents)
+	for (size_t i = 1; i < renderer->windows.size() && !framePolicy.offscreen; i++) {
+		VkBool32 presentSupport = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(renderer->physicalDevice, deviceCapabilities.queueFamilies.presentFamily.value(), renderer->windows[i].surface, &presentSupport);
+		if (!presentSupport) {
+			throw std::runtime_error("failed to present to every window from one queue!");
+		}
+	}
+	markStartupStep(&startupTimer, "pickPhysicalDevice");
+	createLogicalDevice(renderer);
+	markStartupStep(&startupTimer, "createLogicalDevice");
+
+	renderer->jobSystem = &jobSystem;
+	renderer->capabilities = &deviceCapabilities;
+	renderer->latency = &latencyTracker;
+	renderer->hostAllocator = &hostAllocator;
+	renderer->startupTimer = &startupTimer;
+	renderer->policy = framePolicy;
+	renderer->variant = triangleVariant;
+	createRenderer(renderer);
+
+	if (renderer->frameSync.timeline) {
+		std::cout << "Frame sync: VK_KHR_timeline_semaphore" << std::endl;
+	}
+	else {
+		std::cout << "Frame sync: binary semaphores and fences (timeline semaphore unsupported)" << std::endl;
+	}
+	std::cout << "Rendering: " << (renderer->dynamicRendering ? "VK_KHR_dynamic_rendering" : "render pass and framebuffers") << std::endl;
+	std::cout << "Present: " << (renderer->policy.onDemand ? "on demand" : "continuous");
+	if (renderer->policy.offscreen) {
+		std::cout << ", offscreen (no surface, frames are only read back)" << std::endl;
+	}
+	else {
+		std::cout << (renderer->incrementalPresent ? ", damage rectangles through VK_KHR_incremental_present" : ", whole images (incremental present unsupported)") << std::endl;
+	}
+	if (!renderer->bindless) {
+		std::cout << "Bindless heap: unsupported (VK_EXT_descriptor_indexing), pipelines use an empty layout" << std::endl;
+	}
 }
 
-void sdlCleanUp(SDL_Window* window) {
-	SDL_DestroyWindow(window);
+void sdlCleanUp(const std::vector<SDL_Window*> &sdlWindows) {
+	for (SDL_Window *window : sdlWindows) {
+		SDL_DestroyWindow(window);
+	}
 	SDL_Quit();
 }
 
-void cleanup(VkDevice device, VkInstance instance, VkSurfaceKHR surface, VkSwapchainKHR swapChain) {
-	
-	
-	//Clean up render semaphores
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(device, inFlightFences[i], nullptr);
-	}
+void cleanup(VkInstance instance, Renderer *renderer) {
 	
+	destroyRenderer(renderer);
 
-	vkDestroyCommandPool(device, commandPool, nullptr);
-
-	vkDestroyDevice(device, nullptr);
+	vkDestroyDevice(renderer->device, vulkanAllocator());
 	
 
 	if (enableValidationLayers) {
-		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, vulkanAllocator());
 	}
 
-	vkDestroySurfaceKHR(instance, surface, nullptr);
-	vkDestroyInstance(instance, nullptr);
+	//SDL creates the surface without allocation callbacks, destruction must match.
+	//Offscreen there is none, nor the surface extension.
+	for (const RenderWindow &window : renderer->windows) {
+		if (window.surface != VK_NULL_HANDLE) {
+			vkDestroySurfaceKHR(instance, window.surface, nullptr);
+		}
+	}
+	vkDestroyInstance(instance, vulkanAllocator());
 
 }
 //Set instance Vulkan
@@ -299,7 +460,7 @@ void createInstance(VkInstance *instance) {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_1; //vkGetPhysicalDeviceFeatures2 for optional features
 
 	VkInstanceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -325,13 +486,13 @@ void createInstance(VkInstance *instance) {
 		createInfo.pNext = nullptr;
 	}
 
-	if (vkCreateInstance(&createInfo, nullptr, instance) != VK_SUCCESS) {
+	if (vkCreateInstance(&createInfo, vulkanAllocator(), instance) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create instance!");
 	}
 }
 
 //Select Appropriate Device(GPU compatible)
-void pickPhysicalDevice(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkSurfaceKHR surface, VkBool32 *presentSupport) {
+void pickPhysicalDevice(VkInstance *instance, VkPhysicalDevice *physicalDevice, VkSurfaceKHR surface) {
 	uint32_t deviceCount = 0;
 	vkEnumeratePhysicalDevices(*instance, &deviceCount, nullptr);
 
@@ -342,26 +503,64 @@ void pickPhysicalDevice(VkInstance *instance, VkPhysicalDevice *physicalDevice,
 	std::vector<VkPhysicalDevice> devices(deviceCount);
 	vkEnumeratePhysicalDevices(*instance, &deviceCount, devices.data());
 
-	for (const auto& device : devices) {
-		
-		if (isDeviceSuitable(device,surface, presentSupport)) {
-			*physicalDevice = device;
-			break;
+	//Probe each device once, then rank: type, VRAM, queue families, features and limits
+	std::vector<DeviceCapabilities> capabilities(deviceCount);
+	parallelFor(&jobSystem, deviceCount, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			probeDeviceCapabilities(devices[i], surface, &capabilities[i]);
 		}
+	});
+
+	std::vector<DeviceScore> scores;
+	for (uint32_t i = 0; i < deviceCount; i++) {
+		scores.push_back(scoreDevice(capabilities[i], i, isDeviceSuitable(capabilities[i])));
+		std::cout << formatDeviceScore(scores.back()) << std::endl;
 	}
 
-	if (physicalDevice == VK_NULL_HANDLE) {
+	const DeviceScore *selected = nullptr;
+	std::string reason;
+
+	if (deviceOverride.kind != DeviceOverride::NONE) {
+		for (const auto& score : scores) {
+			if (matchesOverride(score, deviceOverride)) {
+				if (!score.suitable) {
+					throw std::runtime_error("requested GPU is not suitable: " + score.name);
+				}
+				selected = &score;
+				reason = "device override";
+				break;
+			}
+		}
+		if (selected == nullptr) {
+			throw std::runtime_error("no GPU matches the device override!");
+		}
+	}
+	else {
+		for (const auto& score : scores) {
+			if (score.suitable && (selected == nullptr || score.score > selected->score)) {
+				selected = &score;
+			}
+		}
+		reason = "highest score";
+	}
+
+	if (selected == nullptr) {
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
+
+	*physicalDevice = selected->device;
+	deviceCapabilities = std::move(capabilities[selected->index]);
+	std::cout << "Selected GPU " << selected->index << ": " << selected->name << " (" << reason << ", score " << selected->score << ")" << std::endl;
 }
 
 //Create logical Device who take instruction
-void createLogicalDevice(VkPhysicalDevice *physicalDevice, VkDevice *device, VkQueue *graphicsQueue, VkSurfaceKHR surface, VkBool32 *presentSupport, VkQueue *presentQueue) {
-	QueueFamilyIndices indices = findQueueFamilies(*physicalDevice, surface, presentSupport);
-
+void createLogicalDevice(Renderer *renderer) {
+	const QueueFamilyIndices &indices = deviceCapabilities.queueFamilies;
+	printQueueFamilies(indices);
 
+	//One queue per distinct family the renderer submits to
 	std::vector<VkDeviceQueueCreateInfo>queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(),indices.presentFamily.value() };
+	std::vector<uint32_t> uniqueQueueFamilies = indices.uniqueFamilies();
 	
 
 	float queuePriority = 1.0f;
@@ -378,9 +577,70 @@ void createLogicalDevice(VkPhysicalDevice *physicalDevice, VkDevice *device, VkQ
 
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 
+	//Offscreen nothing is presented, no swap chain
+	std::vector<const char*> enabledExtensions;
+	if (!framePolicy.offscreen) {
+		enabledExtensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+	}
+
+	//Timeline semaphore is optional, frame sync falls back to fences
+	renderer->timelineSemaphore = deviceCapabilities.timelineSemaphore;
+
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+
+	//Dynamic rendering is optional, the render pass path stays as fallback
+	renderer->dynamicRendering = deviceCapabilities.dynamicRendering && !framePolicy.renderPassFallback;
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+	//Bindless resources are optional, pipelines then have an empty layout
+	renderer->bindless = deviceCapabilities.bindless;
+
+	//Damage rectangles are only a hint, without the extension whole images are presented
+	renderer->incrementalPresent = deviceCapabilities.incrementalPresent && !framePolicy.offscreen;
+	if (renderer->incrementalPresent) {
+		enabledExtensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
+	if (renderer->bindless) {
+		//Dependency of descriptor indexing, core in 1.1 but still listed by most drivers
+		if (deviceCapabilities.hasExtension(VK_KHR_MAINTENANCE3_EXTENSION_NAME)) {
+			enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		}
+		enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		indexingFeatures.pNext = const_cast<void *>(createInfo.pNext);
+		createInfo.pNext = &indexingFeatures;
+	}
+	if (renderer->timelineSemaphore) {
+		enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineFeatures.pNext = const_cast<void *>(createInfo.pNext);
+		createInfo.pNext = &timelineFeatures;
+	}
+	if (renderer->dynamicRendering) {
+		enabledExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		dynamicRenderingFeatures.pNext = const_cast<void *>(createInfo.pNext);
+		createInfo.pNext = &dynamicRenderingFeatures;
+	}
+
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	
@@ -388,8 +648,8 @@ void createLogicalDevice(VkPhysicalDevice *physicalDevice, VkDevice *device, VkQ
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
 	
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -399,12 +659,16 @@ void createLogicalDevice(VkPhysicalDevice *physicalDevice, VkDevice *device, VkQ
 		createInfo.enabledLayerCount = 0;
 	}
 
-	if (vkCreateDevice(*physicalDevice, &createInfo, nullptr, device) != VK_SUCCESS) {
+	if (vkCreateDevice(renderer->physicalDevice, &createInfo, vulkanAllocator(), &renderer->device) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create logical device!");
 	}
 
-	vkGetDeviceQueue(*device, indices.graphicsFamily.value(), 0, graphicsQueue);
-	vkGetDeviceQueue(*device, indices.graphicsFamily.value(), 0, presentQueue);
+	vkGetDeviceQueue(renderer->device, indices.graphicsFamily.value(), 0, &renderer->graphicsQueue);
+	vkGetDeviceQueue(renderer->device, indices.presentFamily.value(), 0, &renderer->presentQueue);
+
+	renderer->graphicsFamilyIndex = indices.graphicsFamily.value();
+	renderer->presentFamilyIndex = indices.presentFamily.value();
+	renderer->separatePresentQueue = indices.separatePresent();
 }
 
 
@@ -421,212 +685,54 @@ int createSurface(SDL_Window* window, VkInstance instance, VkSurfaceKHR *surface
 
 }
 
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
-{
-	SwapChainSupportDetails details;
-
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-	
-	uint32_t formatCount;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-	if (formatCount != 0) {
-		details.formats.resize(formatCount);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+bool checkDeviceExtensionSupport(const DeviceCapabilities &capabilities) {
 
+	//Offscreen the swap chain extension is not enabled
+	if (framePolicy.offscreen) {
+		return true;
 	}
-
-	uint32_t presentModeCount;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-	if (presentModeCount != 0) {
-		details.presentsModes.resize(presentModeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentsModes.data());
-	}
-
-	return  details;
-}
-
-VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>&availableFormats) {
-
-	for (const auto& availableFormat : availableFormats) {
-		if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-			return availableFormat;
-
-		}
-	}
-
-	return availableFormats[0];
-}
-
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-	
-	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresentMode;
+	for (const char *extension : deviceExtensions) {
+		if (!capabilities.hasExtension(extension)) {
+			return false;
 		}
 	}
-
-	return VK_PRESENT_MODE_FIFO_KHR;
-
-}
-
-VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
-	//if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max()) {
-	if(capabilities.currentExtent.width==WIDTH){
-		return capabilities.currentExtent;
-		
-	}
-	else {
-
-		int width, height;
-		SDL_GetWindowSize(window, &width, &height);
-
-		VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
-		
-		actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
-		actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
-		
-		return actualExtent;
-	}
-
-}
-
-//Create Swap Chain (buffer of rendu "frameBuffer")
-void createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport, VkDevice device, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages) {
-
-	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice, surface);
-	
-	VkSurfaceFormatKHR surfaceFormat=chooseSwapSurfaceFormat(swapChainSupport.formats);
-	VkPresentModeKHR presentMode=chooseSwapPresentMode(swapChainSupport.presentsModes);
-	VkExtent2D extent=chooseSwapExtent(swapChainSupport.capabilities);
-
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	}
-
-	VkSwapchainCreateInfoKHR createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface = surface;
-
-	createInfo.minImageCount = imageCount;
-	createInfo.imageFormat = surfaceFormat.format;
-	createInfo.imageColorSpace = surfaceFormat.colorSpace;
-	createInfo.imageExtent = extent;
-	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice,surface,&presentSupport);
-	uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-
-	if (indices.graphicsFamily != indices.presentFamily) {
-		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		createInfo.queueFamilyIndexCount = 2;
-		createInfo.pQueueFamilyIndices = queueFamilyIndices;
-	}
-	else {
-		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	}
-
-	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
-	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = presentMode;
-	createInfo.clipped = VK_TRUE;
-
-	
-
-	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, swapChain) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create swap chain!");
-	}
-
-	vkGetSwapchainImagesKHR(device, *swapChain, &imageCount, nullptr);
-	swapChainImages->resize(imageCount);
-	vkGetSwapchainImagesKHR(device, *swapChain, &imageCount, swapChainImages->data());
-
-	swapChainImageFormat = surfaceFormat.format;
-	swapChainExtent = extent;
-}
-
-bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
-
-	uint32_t extensionCount;
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-
-	std::vector<VkExtensionProperties> avaibleExtensions(extensionCount);
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, avaibleExtensions.data());
-
-	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-	for (const auto &extension : avaibleExtensions) {
-		requiredExtensions.erase(extension.extensionName);
-	}
-	return requiredExtensions.empty();
+	return true;
 }
 
 //if device is compatible
-bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface, VkBool32 *presentSupport) {
-	QueueFamilyIndices indices = findQueueFamilies(device,surface,presentSupport);
+bool isDeviceSuitable(const DeviceCapabilities &capabilities) {
 
-	bool extensionSupported = checkDeviceExtensionSupport(device);
+	bool extensionSupported = checkDeviceExtensionSupport(capabilities);
 
-	bool swapChainAdequate = false;
-	
 	//test If surface compatible with swap chain extension
-	if (extensionSupported) {
-		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device,surface);
-		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentsModes.empty();
-	}
+	bool swapChainAdequate = extensionSupported && capabilities.swapChainAdequate;
 		
-	return indices.isComplete()&&extensionSupported&&swapChainAdequate;
-}
-
-//Queue of device instruction if compatible
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, VkBool32 *presentSupport) {
-	QueueFamilyIndices indices;
-
-	uint32_t queueFamilyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
-
-	int i = 0;
-	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.graphicsFamily = i;
-		}
-		//provided presentation support
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, presentSupport);
-		if (queueFamily.queueCount > 0 && presentSupport) {
-			indices.presentFamily = i;
-		}
-
-		if (indices.isComplete()) {
-			break;
-		}
-
-		i++;
-	}
-
-	return indices;
+	return capabilities.queueFamilies.isComplete()&&extensionSupported&&swapChainAdequate;
 }
 
 //Get sdl extension for Vulkan Instance
 std::vector<const char*> getRequiredExtensions() {
 	uint32_t extension_count = 0;
 
+	//Offscreen there is no window, and no surface extension
+	std::vector<const char*> extensions;
+	if (windows.empty()) {
+		if (enableValidationLayers) {
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
+		return extensions;
+	}
 
 
-	if (!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, NULL)) {
+	if (!SDL_Vulkan_GetInstanceExtensions(windows[0], &extension_count, NULL)) {
 		std::cout << "Could not get the number of required instance extensions from SDL." << std::endl;
 		exit(1);
 	}
 
 
-	std::vector<const char*> extensions(extension_count);
+	extensions.resize(extension_count);
 
-	if (!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, extensions.data())) {
+	if (!SDL_Vulkan_GetInstanceExtensions(windows[0], &extension_count, extensions.data())) {
 		std::cout << "Could not get the names of required instance extensions from SDL." << std::endl;
 		exit(1);
 	}
@@ -664,345 +770,14 @@ bool checkValidationLayerSupport() {
 	return true;
 }
 
-//Create ImageViews
-void createImageViews(VkDevice device, std::vector<VkImage> swapChainImages, std::vector<VkImageView> *swapChainImageViews) {
-
-	swapChainImageViews->resize(swapChainImages.size());
-
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-
-		VkImageViewCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		createInfo.image = swapChainImages[i];
-		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		createInfo.format = swapChainImageFormat;
-		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		createInfo.subresourceRange.baseMipLevel = 0;
-		createInfo.subresourceRange.levelCount = 1;
-		createInfo.subresourceRange.baseArrayLayer = 0;
-		createInfo.subresourceRange.layerCount = 1;
-
-		if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews->at(i)) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create ImageView");
-		}
-		
-
-	}
-
-}
-
-void createGraphicsPipeline(VkDevice device) {
-	
-	
-	auto vertShaderCode = readfile("shaders/vert.spv");
-	auto fragShaderCode = readfile("shaders/frag.spv");
-
-	
-
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
-
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertShaderModule;
-	vertShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragShaderModule;
-	fragShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swapChainExtent.width;
-	viewport.height = (float)swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
-
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer = {};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-
-	VkPipelineMultisampleStateCreateInfo multisampling = {};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
-
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-	
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create graphics pipeline!");
-	}
-
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-}
-
-void createRenderPass(VkDevice device) {
-
-
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = swapChainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef = {};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-
-	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create render pass!");
-	}
-
-}
-
-void createFrameBuffers(VkDevice device) {
-
-	swapChainFramebuffers.resize(swapChainImageViews.size());
-
-	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-		VkImageView attachments[] = {
-			swapChainImageViews[i]
-		};
-
-		VkFramebufferCreateInfo framebufferInfo = {};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments;
-		framebufferInfo.width = swapChainExtent.width;
-		framebufferInfo.height = swapChainExtent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create framebuffer!");
-		}
-	}
-}
-
-void createCommandPool(VkPhysicalDevice *physicalDevice, VkDevice *device, VkSurfaceKHR surface, VkBool32 *presentSupport) {
-	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(*physicalDevice,surface,presentSupport);
-
-	VkCommandPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-
-	if (vkCreateCommandPool(*device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create command pool!");
-	}
-}
-
-
-void createCommandeBuffers(VkDevice device) {
-
-	commandBuffers.resize(swapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = commandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate command buffers!");
-	}
-
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-
-		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-			throw std::runtime_error("failed to begin recording command buffer!");
-		}
-
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
-
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
-
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-		vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-
-		vkCmdEndRenderPass(commandBuffers[i]);
-
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record command buffer!");
-		}
-	}
-
-}
-//Frames  in flight, max work with 2 frames
-//Synchronisation GPU //CPU work use VkFence //Rename createSemaphores=>createSyncObject
-void createSyncObjects(VkDevice device) {
-
-	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-	VkSemaphoreCreateInfo semaphoreInfo = {};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS||
-			vkCreateFence(device,&fenceInfo,nullptr,&inFlightFences[i])!=VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create semaphores!");
-		}
-
-	}
-	
-}
-
-VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code) {
-
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create shader module");
-	}
-
-	return shaderModule;
-
-}
-
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
-	std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
-	return VK_FALSE;
-}
-
-
-
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
 	createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	//Every type: performance warnings are counted even when not printed, the callback filters the rest
+	createInfo.messageSeverity = debugMessageSubscription(debugMessages);
 	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-	createInfo.pfnUserCallback = debugCallback;
+	createInfo.pfnUserCallback = debugMessageCallback;
+	createInfo.pUserData = &debugMessages;
 }
 
 void setupDebugMessenger(VkInstance *instance) {
@@ -1011,7 +786,7 @@ void setupDebugMessenger(VkInstance *instance) {
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
 	populateDebugMessengerCreateInfo(createInfo);
 
-	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, vulkanAllocator(), &debugMessenger) != VK_SUCCESS) {
 		throw std::runtime_error("failed to set up debug messenger!");
 	}
 }
@@ -1034,104 +809,140 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 }
 
 
-//Drawing
-void drawFrame(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport, VkSwapchainKHR *swapChain, std::vector<VkImage> swapChainImages, VkQueue graphicsQueue, VkQueue presentQueue) {
 
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	
-	
-	uint32_t imageIndex;
-	VkResult result=vkAcquireNextImageKHR(device, *swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-	
-	if(result==VK_ERROR_OUT_OF_DATE_KHR)// The swap chain has become incompatible with the surface and can no longer be used for rendering. Usually happens after a window resize
-	    {
-			recreateSwapChain(physicalDevice,surface,presentSupport,device,swapChain,&swapChainImages);
-			return;
-		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) //The swap chain can still be used to successfully present to the surface, but the surface properties are no longer matched exactly
-		{
-			throw std::runtime_error("Failed to acquire swap chain image!");
-		}
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+void printLatencySummary(const char *label, const LatencySummary &summary) {
+	std::cout << label << ": " << summary.frameRate << " fps, input-to-present mean " << summary.meanMs
+		<< " ms, p50 " << summary.p50Ms << " ms, p99 " << summary.p99Ms << " ms (" << summary.samples << " samples)" << std::endl;
+}
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+//Measure every present mode / frames in flight / image count combination with a synthetic input
+//before each frame, then keep the lowest latency configuration sustaining the target frame rate
+bool runLatencySweep(Renderer *renderer) {
 
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	const uint32_t framesPerConfiguration = 300;
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	const SwapChainSupportDetails &swapChainSupport = windowSurfaceSupport(*renderer, &renderer->windows[0]);
+	const VkSurfaceCapabilitiesKHR &capabilities = swapChainSupport.capabilities;
 
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	FramePolicy requested = renderer->policy;
+	FramePolicy best = requested;
+	LatencySummary bestSummary = {};
+	bool found = false;
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo,inFlightFences[currentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("failed to submit draw command buffer!");
-	}
+	for (VkPresentModeKHR presentMode : swapChainSupport.presentsModes) {
+		for (uint32_t frames = 1; frames <= MAX_FRAMES_IN_FLIGHT; frames++) {
+			for (uint32_t extraImages = 0; extraImages <= 2; extraImages++) {
 
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+				FramePolicy candidate = requested;
+				candidate.presentModes = { presentMode };
+				candidate.framesInFlight = frames;
+				candidate.swapChainImageCount = capabilities.minImageCount + extraImages;
+				if (capabilities.maxImageCount > 0 && candidate.swapChainImageCount > capabilities.maxImageCount) {
+					continue;
+				}
 
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+				applyFramePolicy(renderer, candidate);
+				resetLatency(&latencyTracker);
 
-	VkSwapchainKHR swapChains[] = { *swapChain };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
+				for (uint32_t i = 0; i < framesPerConfiguration; i++) {
+					markInput(&latencyTracker);
+					drawFrame(renderer);
 
-	presentInfo.pImageIndices = &imageIndex;
+					SDL_Event event;
+					while (SDL_PollEvent(&event)) {
+						RenderEvent renderEvent;
+						if (translateEvent(event, &renderEvent) && renderEvent.type == RenderEvent::QUIT) {
+							return false;
+						}
+					}
+				}
 
-	vkQueuePresentKHR(presentQueue, &presentInfo);
+				vkDeviceWaitIdle(renderer->device);
+				framesCompleted(&latencyTracker, pollCompletedValue(renderer->device, &renderer->frameSync));
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		recreateSwapChain(physicalDevice, surface, presentSupport, device, swapChain, &swapChainImages);
+				LatencySummary summary = summarizeLatency(latencyTracker);
+				printLatencySummary(describeFramePolicy(candidate).c_str(), summary);
+
+				if (summary.frameRate >= requested.targetFrameRate && (!found || summary.meanMs < bestSummary.meanMs)) {
+					best = candidate;
+					bestSummary = summary;
+					found = true;
+				}
+			}
+		}
 	}
-	else if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to present swap chain image");
+
+	if (found) {
+		std::cout << "Lowest latency at " << requested.targetFrameRate << " fps: " << describeFramePolicy(best) << std::endl;
+	}
+	else {
+		std::cout << "No configuration sustains " << requested.targetFrameRate << " fps, keeping " << describeFramePolicy(requested) << std::endl;
 	}
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	applyFramePolicy(renderer, best);
+	resetLatency(&latencyTracker);
 
-	
+	return true;
 }
 
-//Swap chain recreation
-void recreateSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkBool32 presentSupport, VkDevice device, VkSwapchainKHR *swapChain, std::vector<VkImage> *swapChainImages) {
+void renderLoop(Renderer *renderer) {
 
-	vkDeviceWaitIdle(device);
-	cleanupSwapChain(device, swapChain);
-	
-	createSwapChain(physicalDevice, surface, presentSupport, device, swapChain, swapChainImages);
-	createImageViews(device, *swapChainImages, &swapChainImageViews);
-	createRenderPass(device);
-	createGraphicsPipeline(device);
-	createFrameBuffers(device);
-	createCommandeBuffers(device);
+	try {
+		bool running = true;
+		while (running && !frameLimitReached(*renderer)) {
 
-}
+			RenderEvent renderEvent;
+			while (running && renderEvents.tryPop(&renderEvent)) {
+				running = handleRenderEvent(renderer, renderEvent);
+			}
+			if (!running) {
+				break;
+			}
 
-void cleanupSwapChain(VkDevice device, VkSwapchainKHR *swapChain) {
+			if (renderingPaused(*renderer)) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
 
-	for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
-		vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
+			if (!frameNeeded(renderer)) {
+				//On demand: sleep until the event thread pushes something, or a pipeline compile may have finished
+				idleFrame(renderer);
+				waitForWakeup(&renderWakeup, std::chrono::milliseconds(renderer->policy.idleWakeMs));
+				continue;
+			}
+
+			drawFrame(renderer);
+		}
+	}
+	catch (...) {
+		renderThreadError = std::current_exception();
 	}
 
-	vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	renderThreadRunning.store(false, std::memory_order_release);
+}
 
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+//Events are timestamped when read here, so the queue hop counts toward input-to-present latency
+void pumpEvents() {
 
-	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-		vkDestroyImageView(device, swapChainImageViews[i], nullptr);
-	}
+	SDL_Event event;
+	while (renderThreadRunning.load(std::memory_order_acquire)) {
 
-	vkDestroySwapchainKHR(device, *swapChain, nullptr);
+		//Timeout so a render thread that stopped on an error is noticed
+		if (SDL_WaitEventTimeout(&event, 10) == 0) {
+			continue;
+		}
 
+		RenderEvent renderEvent;
+		if (!translateEvent(event, &renderEvent)) {
+			continue;
+		}
+		pushRenderEvent(&renderEvents, renderEvent, renderThreadRunning);
+		if (framePolicy.onDemand) {
+			wakeRenderer(&renderWakeup);
+		}
 
-}
\ No newline at end of file
+		if (renderEvent.type == RenderEvent::QUIT) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+//Bindless resources, the shader side of BindlessHeap.h: #include from shaders drawing with the heap
+//and compile with glslangValidator -V (GL_GOOGLE_include_directive).
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform texture2D bindlessTextures[];
+layout(set = 0, binding = 1) readonly buffer BindlessBuffer { uint words[]; } bindlessBuffers[];
+layout(set = 0, binding = 2) uniform sampler bindlessSamplers[];
+
+//BindlessDrawConstants
+layout(push_constant) uniform DrawIndices {
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+    uint instanceIndex;
+} draw;
+
+vec4 sampleBindless(uint textureIndex, uint samplerIndex, vec2 uv) {
+    return texture(sampler2D(bindlessTextures[nonuniformEXT(textureIndex)], bindlessSamplers[nonuniformEXT(samplerIndex)]), uv);
+}
+
+uint loadBindlessWord(uint bufferIndex, uint word) {
+    return bindlessBuffers[nonuniformEXT(bufferIndex)].words[word];
+}
@@ -1,3 +1,5 @@
 C:/VulkanSDK/1.1.106.0/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.1.106.0/Bin32/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.1.106.0/Bin32/glslangValidator.exe -V mesh.vert -o mesh_vert.spv
+C:/VulkanSDK/1.1.106.0/Bin32/glslangValidator.exe -V -DBINDLESS mesh.vert -o mesh_bindless_vert.spv
 pause
\ No newline at end of file
@@ -0,0 +1,48 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+//glslangValidator -V -DBINDLESS: placement and tint from the draw's bindless buffer
+#ifdef BINDLESS
+#extension GL_GOOGLE_include_directive : require
+#include "bindless.glsl"
+#endif
+
+//PackedVertex of MeshFormat.h: unit cube position, octahedral normal, unorm color
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+//Variant switches, fixed when the pipeline is created (TriangleVariant in ShaderVariants.h)
+layout(constant_id = 0) const float SCALE = 1.0;
+
+#ifdef BINDLESS
+//MeshDrawData of SceneMesh.h, 8 words per draw from instanceIndex in the draw's buffer
+float drawData(uint word) {
+    return uintBitsToFloat(loadBindlessWord(draw.bufferIndex, draw.instanceIndex * 8 + word));
+}
+#endif
+
+//Inverse of encodeOctahedral in MeshFormat.cpp
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    //Orthographic view down -Z of the unit cube, Y up; no depth buffer, back face culling hides the far side
+    vec2 xy = vec2(inPosition.x, -inPosition.y) * SCALE;
+    vec3 tint = vec3(1.0);
+#ifdef BINDLESS
+    xy = xy * drawData(2) + vec2(drawData(0), drawData(1));
+    tint = vec3(drawData(4), drawData(5), drawData(6));
+#endif
+    gl_Position = vec4(xy, inPosition.z * -0.5 + 0.5, 1.0);
+
+    vec3 normal = decodeOctahedral(inNormal);
+    float light = 0.3 + 0.7 * max(dot(normal, normalize(vec3(0.4, 0.6, 0.7))), 0.0);
+    fragColor = inColor.rgb * light * tint;
+}
@@ -5,6 +5,14 @@ layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
+//Variant switches, fixed when the pipeline is created (TriangleVariant in ShaderVariants.h)
+layout(constant_id = 1) const bool GRAYSCALE = false;
+layout(constant_id = 2) const float BRIGHTNESS = 1.0;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (GRAYSCALE) {
+        color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+    }
+    outColor = vec4(color * BRIGHTNESS, 1.0);
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 layout(location = 0) out vec3 fragColor;
 
+//Variant switches, fixed when the pipeline is created (TriangleVariant in ShaderVariants.h)
+layout(constant_id = 0) const float SCALE = 1.0;
+
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
     vec2(0.5, 0.5),
@@ -16,6 +19,6 @@ vec3 colors[3] = vec3[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = vec4(positions[gl_VertexIndex] * SCALE, 0.0, 1.0);
     fragColor = colors[gl_VertexIndex];
 }
\ No newline at end of file